@@ -61,6 +61,10 @@ struct BlendMode {
 	{}
 	void disable() { disabled = true; };
 	void enable() { disabled = false; };
+	bool operator==(const BlendMode& p_other) const {
+		return disabled == p_other.disabled && srcRGB == p_other.srcRGB && dstRGB == p_other.dstRGB && srcAlpha == p_other.srcAlpha
+			&& dstAlpha == p_other.dstAlpha && RGBequation == p_other.RGBequation && AlphaEquation == p_other.AlphaEquation;
+	}
 	GLenum srcRGB;
 	GLenum dstRGB;
 	GLenum srcAlpha;
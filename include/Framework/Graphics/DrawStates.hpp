@@ -41,6 +41,16 @@ public:
 
 	void setTexture(size_t p_index, Texture& p_texture);
 
+	// Per-draw uniform values, set on the shader right after it's bound. Use these instead of setting the uniform on the shader
+	// before draw(), since a deferred draw doesn't reach the shader until the surface is flushed.
+	// Setting a location that's already there just replaces the value.
+	void setUniform(GLint p_loc, float p_value);
+	void setUniform(GLint p_loc, glm::vec2 p_value);
+	void setUniform(GLint p_loc, glm::vec3 p_value);
+	void setUniform(GLint p_loc, glm::vec4 p_value);
+	void removeUniform(GLint p_loc);
+	bool hasUniform(GLint p_loc) const;
+
 
 	bool checkIfInit() { 
 		for (auto texture : m_textures) {
@@ -71,5 +81,21 @@ public:
 	// Constructed with default settings.
 	// Not a pointer, because it should only be a local copy.
 	BlendMode m_blendMode;
+
+	// A float, vec2, vec3 or vec4, depending on components.
+	struct UniformValue {
+		GLint loc = -1;
+		GLint components = 1;
+		glm::vec4 value = glm::vec4(0.f);
+		void apply(const Shader& p_shader) const;
+	};
+	std::vector<UniformValue> m_uniforms;
+
+	// Only used by deferred drawing (DrawSurface::beginPass()). Higher layers are drawn after lower ones, whatever the pass's order.
+	uint8_t m_layer = 0;
+	// Only used by state sorted passes, 0 to 1, nearest first. It only decides the order of draws whose state is the same otherwise.
+	float m_depth = 0.f;
+private:
+	void setUniformValue(GLint p_loc, GLint p_components, glm::vec4 p_value);
 };
 #endif
\ No newline at end of file
@@ -8,6 +8,8 @@
 #include "Framework/Graphics/Mesh.hpp"
 #include "Framework/Graphics/GlCheck.hpp"
 #include "Framework/Graphics/GlIDs.hpp"
+#include "Framework/Graphics/GlStateCache.hpp"
+#include "Framework/Graphics/RenderQueue.hpp"
 
 class DrawSurface {
 public:
@@ -18,75 +20,39 @@ public:
 
 	// Detailed generic draw function.
 	// Must be typenamed to T in order to accept any mesh vertex format, but everything that uses the template type is internal to mesh.
+	// Between beginPass() and flush() this only records the draw, see beginPass().
 	template<typename T, typename I = int>
 	void draw(Mesh<T, I>& p_mesh, GLenum p_primitiveType, DrawStates& p_states, bool p_selfBindShader = true) {
 		if (!p_states.checkIfInit()) return;
 
+		if (m_recording) {
+			m_queue.record(p_mesh, p_primitiveType, p_states);
+			return;
+		}
+
 		auto shader = p_states.m_shaderPtr;
 		assert(shader);
 
-		glCheck(glBindVertexArray(p_mesh.VAO->ID));
+		// all of this is skipped when it's the same as the last draw
+		GLStateCache& gl = GLStateCache::Get();
+		gl.bindVertexArray(p_mesh.VAO->ID);
 		if (p_selfBindShader)
 			shader->use();
 
 		// Bind all textures to the correct texture units
 		for (size_t i = 0; i < p_states.m_textures.size(); i++) {
 			CONDITIONAL_LOG(p_states.m_textures.size() > 16, "Warning: Exceeding minimum OpenGL texture unit spec.");
-			glCheck(glActiveTexture(GL_TEXTURE0 + (GLenum)i));
-			glCheck(glBindTexture(p_states.m_textures[i].type, p_states.m_textures[i].glID->ID));
+			gl.bindTexture((GLuint)i, p_states.m_textures[i].type, p_states.m_textures[i].glID->ID);
 		}
 
-		if (p_states.m_blendMode.disabled) {
-			glDisable(GL_BLEND);
-		}
-		else {
-			glEnable(GL_BLEND);
-			glCheck(glBlendFuncSeparate(p_states.m_blendMode.srcRGB, p_states.m_blendMode.dstRGB, p_states.m_blendMode.srcAlpha, p_states.m_blendMode.dstAlpha));
-			glCheck(glBlendEquationSeparate(p_states.m_blendMode.RGBequation, p_states.m_blendMode.AlphaEquation));
-		}
+		gl.setBlend(p_states.m_blendMode);
 
+		for (const DrawStates::UniformValue& uniform : p_states.m_uniforms) uniform.apply(*shader);
 		// We'll assume that every shader uses a transform matrix, because that's pretty much a given.
-		shader->setMat4UniformStatic(shader->getUniformLoc("transform"), p_states.m_transform);
-		if (p_mesh.IBOInitialized) {
-			if (!p_mesh.instancesInitialized)
-				glCheck(glDrawElements(p_primitiveType, (GLsizei)p_mesh.getTotalIBOSize(), GL_UNSIGNED_INT, 0));
-			else
-				glCheck(glDrawElementsInstanced(p_primitiveType, (GLsizei)p_mesh.getTotalIBOSize(), GL_UNSIGNED_INT, 0, (GLsizei)p_mesh.instanceCount()));
-		}
-		else {
-			if (p_mesh.isFeedbackMesh) {
-				// these are the only three things a feedback mesh can be
-				if (!p_mesh.instancesInitialized) {
-					if (p_primitiveType == GL_TRIANGLES)
-						glCheck(glDrawArrays(p_primitiveType, 0, (GLsizei)p_mesh.getCapturedPrimitiveCount() * (GLsizei)3));
-					else if (p_primitiveType == GL_LINES)
-						glCheck(glDrawArrays(p_primitiveType, 0, (GLsizei)p_mesh.getCapturedPrimitiveCount() * (GLsizei)2));
-					else {
-						glCheck(glDrawArrays(p_primitiveType, 0, (GLsizei)p_mesh.getCapturedPrimitiveCount()));
-					}
-				}
-				else {
-					if (p_primitiveType == GL_TRIANGLES)
-						glCheck(glDrawArraysInstanced(p_primitiveType, 0, static_cast<GLsizei>(p_mesh.getCapturedPrimitiveCount() * 3), static_cast<GLsizei>(p_mesh.instanceCount())));
-					else if (p_primitiveType == GL_LINES)
-						glCheck(glDrawArraysInstanced(p_primitiveType, 0, static_cast<GLsizei>(p_mesh.getCapturedPrimitiveCount() * 2), static_cast<GLsizei>(p_mesh.instanceCount())));
-					else 
-						glCheck(glDrawArraysInstanced(p_primitiveType, 0, static_cast<GLsizei>(p_mesh.getCapturedPrimitiveCount()), static_cast<GLsizei>(p_mesh.instanceCount())));
-				}
-
-			}
-			else {
-				if (!p_mesh.instancesInitialized)
-					glCheck(glDrawArrays(p_primitiveType, 0, static_cast<GLsizei>(p_mesh.getTotalVBOSize())));
-				else
-					glCheck(glDrawArraysInstanced(p_primitiveType, 0, static_cast<GLsizei>(p_mesh.getTotalVBOSize()), static_cast<GLsizei>(p_mesh.instanceCount())));
-
-			}
-
-		}
+		shader->setMat4Uniform(shader->getTransformLoc(), p_states.m_transform);
+		RenderQueue::drawMesh<T, I>(&p_mesh, p_primitiveType);
 
-		// Causes a slight performace hitch?
-		glBindVertexArray(0);
+		// The VAO is left bound, the state cache makes the next draw's bind free if it's the same mesh.
 		// Unbind all textures
 		// Causes an exception??? Bro??
 		//for (size_t i = 0; i < p_states.textures.size(); i++) {
@@ -95,11 +61,41 @@ public:
 		//}
 	};
 
+	// Starts deferring draws: from here until flush(), draw() just records into the queue, and flush() sorts them by p_order and draws them all.
+	// Use SubmitOrder::Submission for things that have to overlap in the order they're drawn (GUI), and SubmitOrder::State for
+	// everything else. Only what's in the DrawStates gets recorded, and meshes have to stay alive until the flush.
+	// Draws with p_selfBindShader = false still bind their states' shader when they're flushed.
+	void beginPass(SubmitOrder p_order = SubmitOrder::State) {
+		if (m_recording && !m_queue.empty()) WARNING_LOG("Draw pass started before the last one was flushed, its draws are lost.");
+		m_queue.begin(p_order);
+		m_recording = true;
+	}
+	// Binds the surface and draws everything recorded since beginPass(), then goes back to drawing immediately.
+	void flush() {
+		if (!m_recording) return;
+		m_recording = false;
+		if (!m_queue.empty()) {
+			bind();
+			m_queue.execute();
+		}
+		m_queue.clear();
+	}
+	bool isRecording() const {
+		return m_recording;
+	}
+	// The draws recorded so far this pass, which can be inspected without a GL context.
+	const RenderQueue& getQueue() const {
+		return m_queue;
+	}
+	RenderQueue& getQueue() {
+		return m_queue;
+	}
+
 	void setViewport(int p_x1, int p_y1, int p_x2, int p_y2) {
 		m_viewport = glm::ivec4(p_x1, p_y1, p_x2, p_y2);
 	};
 	void useViewport() {
-		glCheck(glViewport(m_viewport.x, m_viewport.y, m_viewport.z, m_viewport.w));
+		GLStateCache::Get().viewport(m_viewport.x, m_viewport.y, m_viewport.z, m_viewport.w);
 	};
 	void setClearColor(glm::vec4 p_col) {
 		glCheck(glClearColor(p_col.r, p_col.g, p_col.b, p_col.a));
@@ -119,7 +115,7 @@ public:
 	void bind()
 	{
 		useViewport();
-		glCheck(glBindFramebuffer(GL_FRAMEBUFFER, m_frameBuffer->ID));
+		GLStateCache::Get().bindFramebuffer(m_frameBuffer->ID);
 		glCheck(glDrawBuffers(static_cast<GLsizei>(m_DrawBuffers.size()), (const GLenum*)m_DrawBuffers.data()));
 	};
 	glm::ivec4 getViewport() {
@@ -140,6 +136,9 @@ protected:
 	// X, Y, Width, Height
 	glm::ivec4 m_viewport;
 	std::unique_ptr<glFrameBuffer> m_frameBuffer = std::make_unique<glFrameBuffer>();
+
+	RenderQueue m_queue;
+	bool m_recording = false;
 };
 
 #endif
\ No newline at end of file
@@ -30,6 +30,8 @@ public:
 	// Read the pixels directly from the frame buffer into system memory.
 	void getPixels(size_t p_colorBufferIndex, uint8_t p_channels, Array2D<uint8_t>& o_out);
 	void getPixels(size_t p_colorBufferIndex, uint8_t p_channels, StaticArray2D<uint8_t>& o_out);
+	// Reads straight into o_out's own 64 byte aligned rows, no staging buffer. o_out is reallocated to fit, its old contents are dropped.
+	void getPixels(size_t p_colorBufferIndex, uint8_t p_channels, StaticArray2D<uint8_t, AlignedGridAllocator>& o_out, const GridAllocOptions& p_options = GridAllocOptions());
 	void useDepth(bool p_bool);
 	void clearDepthRegion(GLint p_x, GLint p_y, GLsizei p_width, GLsizei p_height);
 private:
@@ -22,6 +22,16 @@ public:
 	Shader imageShader;
 	GLint image_imageTextureUniformLoc = 0;
 	GLint image_opacityUniformLoc = 0;
+	// Image shader for SpriteBatch, everything per sprite comes in as instance attributes.
+	// Attributes to use:
+	// vec2 corner, 0 to 1
+	// mat4 transform (instanced)
+	// vec4 uv rect (instanced)
+	// float opacity (instanced)
+	// Uniforms:
+	// imageTexture: 0
+	Shader spriteBatchShader;
+	GLint spriteBatch_imageTextureUniformLoc = 0;
 	// Basic Solid Color Shader
 	// Fills fragments with a flat color
 	// Attributes to use:
@@ -1,6 +1,7 @@
 #pragma once
 #include "GL/glew.h"
 #include "Framework/Log.hpp"
+#include "Framework/Graphics/GlStateCache.hpp"
 
 // Bringing them out into a struct, such that it can be deleted when all references are gone.
 // I'm not completely certain if this is the best way of doing it, but it insures the associated GL data is purged when not in use.
@@ -10,6 +11,7 @@ struct glBuffer {
 		// Probably unneeded
 		if (ID == 0) return;
 		DELETE_LOG("GL Buffer " << ID << " Deleted.");
+		GLStateCache::Get().forgetBuffer(ID);
 		glDeleteBuffers(1, &ID);
 		ID = 0;
 	}
@@ -21,6 +23,7 @@ struct glVertexArray {
 	~glVertexArray() {
 		if (ID == 0) return;
 		DELETE_LOG("GL Vertex Array " << ID << " Deleted.");
+		GLStateCache::Get().forgetVertexArray(ID);
 		glDeleteVertexArrays(1, &ID);
 	}
 };
@@ -30,6 +33,7 @@ struct glProgram {
 	~glProgram() {
 		if (ID == 0) return;
 		DELETE_LOG("Deleted shader: " << ID);
+		GLStateCache::Get().forgetProgram(ID);
 		glDeleteProgram(ID);
 	}
 };
@@ -39,6 +43,7 @@ struct glFrameBuffer {
 	~glFrameBuffer() {
 		if (ID == 0) return;
 		DELETE_LOG("Deleted framebuffer: " << ID);
+		GLStateCache::Get().forgetFramebuffer(ID);
 		glDeleteFramebuffers(1, &ID);
 	}
 };
@@ -48,6 +53,7 @@ struct glTexture {
 	~glTexture() {
 		if (ID == 0) return;
 		DELETE_LOG("Deleted texture: " << ID);
+		GLStateCache::Get().forgetTexture(ID);
 		glDeleteTextures(1, &ID);
 	}
 };
\ No newline at end of file
@@ -0,0 +1,188 @@
+#pragma once
+#include "GL/glew.h"
+#include <stdint.h>
+#include "Framework/Graphics/BlendMode.hpp"
+#include "Framework/Graphics/GlCheck.hpp"
+
+// Remembers what's bound in the GL context, so binding what's already bound doesn't cost a driver call.
+// Only works if everything goes through it, so the framework's own binds (DrawSurface, Shader, Texture, Mesh, FrameBuffer) all do.
+// Anything that pokes GL state directly has to call invalidate() afterwards, or the cache will skip binds it shouldn't.
+// The GL object wrappers in GlIDs.hpp call the forget functions when they delete something, since GL hands names back out.
+class GLStateCache {
+public:
+	static constexpr GLuint UNKNOWN = 0xFFFFFFFF;
+	static constexpr GLuint MAX_TEXTURE_UNITS = 32;
+
+	static GLStateCache& Get() {
+		static GLStateCache instance;
+		return instance;
+	}
+
+	void useProgram(GLuint p_program) {
+		if (!changed(m_program, p_program)) return;
+		glCheck(glUseProgram(p_program));
+	}
+	void bindVertexArray(GLuint p_VAO) {
+		if (!changed(m_VAO, p_VAO)) return;
+		glCheck(glBindVertexArray(p_VAO));
+	}
+	// Only GL_ARRAY_BUFFER, the element buffer belongs to the VAO so there's nothing global to cache.
+	void bindArrayBuffer(GLuint p_buffer) {
+		if (!changed(m_arrayBuffer, p_buffer)) return;
+		glCheck(glBindBuffer(GL_ARRAY_BUFFER, p_buffer));
+	}
+	void bindFramebuffer(GLuint p_frameBuffer) {
+		if (!changed(m_frameBuffer, p_frameBuffer)) return;
+		glCheck(glBindFramebuffer(GL_FRAMEBUFFER, p_frameBuffer));
+	}
+	void viewport(GLint p_x, GLint p_y, GLsizei p_width, GLsizei p_height) {
+		if (m_viewportValid && m_viewport[0] == p_x && m_viewport[1] == p_y && m_viewport[2] == p_width && m_viewport[3] == p_height) {
+			m_frameStats.skipped++;
+			return;
+		}
+		m_viewport[0] = p_x;
+		m_viewport[1] = p_y;
+		m_viewport[2] = p_width;
+		m_viewport[3] = p_height;
+		m_viewportValid = true;
+		m_frameStats.issued++;
+		glCheck(glViewport(p_x, p_y, p_width, p_height));
+	}
+
+	void activeTexture(GLuint p_unit) {
+		if (!changed(m_activeUnit, p_unit)) return;
+		glCheck(glActiveTexture(GL_TEXTURE0 + p_unit));
+	}
+	// Binds to p_unit, switching the active unit first if it has to.
+	void bindTexture(GLuint p_unit, GLenum p_target, GLuint p_texture) {
+		if (p_unit >= MAX_TEXTURE_UNITS) {
+			glCheck(glActiveTexture(GL_TEXTURE0 + p_unit));
+			glCheck(glBindTexture(p_target, p_texture));
+			m_activeUnit = p_unit;
+			return;
+		}
+		TextureBinding& binding = m_textures[p_unit];
+		if (binding.target == p_target && binding.texture == p_texture) {
+			m_frameStats.skipped++;
+			return;
+		}
+		activeTexture(p_unit);
+		binding.target = p_target;
+		binding.texture = p_texture;
+		m_frameStats.issued++;
+		glCheck(glBindTexture(p_target, p_texture));
+	}
+	// Binds to whichever unit is active, for editing a texture rather than drawing with it.
+	void bindTexture(GLenum p_target, GLuint p_texture) {
+		if (m_activeUnit == UNKNOWN) activeTexture(0);
+		bindTexture(m_activeUnit, p_target, p_texture);
+	}
+
+	void setBlend(const BlendMode& p_mode) {
+		if (p_mode.disabled) {
+			if (!changed(m_blendEnabled, 0)) return;
+			glCheck(glDisable(GL_BLEND));
+			return;
+		}
+		if (changed(m_blendEnabled, 1)) glCheck(glEnable(GL_BLEND));
+		if (m_blendValid && m_blend.srcRGB == p_mode.srcRGB && m_blend.dstRGB == p_mode.dstRGB && m_blend.srcAlpha == p_mode.srcAlpha && m_blend.dstAlpha == p_mode.dstAlpha
+			&& m_blend.RGBequation == p_mode.RGBequation && m_blend.AlphaEquation == p_mode.AlphaEquation) {
+			m_frameStats.skipped++;
+			return;
+		}
+		m_blend = p_mode;
+		m_blendValid = true;
+		m_frameStats.issued++;
+		glCheck(glBlendFuncSeparate(p_mode.srcRGB, p_mode.dstRGB, p_mode.srcAlpha, p_mode.dstAlpha));
+		glCheck(glBlendEquationSeparate(p_mode.RGBequation, p_mode.AlphaEquation));
+	}
+
+	// Forget everything, so the next call of each kind goes through. Needed after a new context, or after code outside the cache touched GL.
+	void invalidate() {
+		m_program = UNKNOWN;
+		m_VAO = UNKNOWN;
+		m_arrayBuffer = UNKNOWN;
+		m_frameBuffer = UNKNOWN;
+		m_activeUnit = UNKNOWN;
+		m_blendEnabled = UNKNOWN;
+		m_viewportValid = false;
+		m_blendValid = false;
+		for (TextureBinding& binding : m_textures) binding = TextureBinding();
+	}
+
+	// GL quietly unbinds whatever gets deleted, and the name can come straight back for the next object made.
+	void forgetProgram(GLuint p_program) {
+		if (m_program == p_program) m_program = UNKNOWN;
+	}
+	void forgetVertexArray(GLuint p_VAO) {
+		if (m_VAO == p_VAO) m_VAO = UNKNOWN;
+	}
+	void forgetBuffer(GLuint p_buffer) {
+		if (m_arrayBuffer == p_buffer) m_arrayBuffer = UNKNOWN;
+	}
+	void forgetFramebuffer(GLuint p_frameBuffer) {
+		if (m_frameBuffer == p_frameBuffer) m_frameBuffer = UNKNOWN;
+	}
+	void forgetTexture(GLuint p_texture) {
+		for (TextureBinding& binding : m_textures) {
+			if (binding.texture == p_texture) binding = TextureBinding();
+		}
+	}
+
+	GLuint boundProgram() const {
+		return m_program;
+	}
+	GLuint boundFramebuffer() const {
+		return m_frameBuffer;
+	}
+
+	struct Stats {
+		uint64_t issued = 0;
+		uint64_t skipped = 0;
+	};
+	// Counts for the last full frame.
+	Stats getStats() const {
+		return m_lastFrameStats;
+	}
+	// Called by GameWindow::displayNewFrame().
+	void endFrame() {
+		m_lastFrameStats = m_frameStats;
+		m_frameStats = Stats();
+	}
+private:
+	GLStateCache() {}
+	GLStateCache(const GLStateCache& other) = delete;
+	GLStateCache& operator=(const GLStateCache& other) = delete;
+
+	struct TextureBinding {
+		GLenum target = 0;
+		GLuint texture = UNKNOWN;
+	};
+
+	// true (and remembers p_value) if the call has to be made
+	bool changed(GLuint& p_cached, GLuint p_value) {
+		if (p_cached == p_value) {
+			m_frameStats.skipped++;
+			return false;
+		}
+		p_cached = p_value;
+		m_frameStats.issued++;
+		return true;
+	}
+
+	GLuint m_program = UNKNOWN;
+	GLuint m_VAO = UNKNOWN;
+	GLuint m_arrayBuffer = UNKNOWN;
+	GLuint m_frameBuffer = UNKNOWN;
+	GLuint m_activeUnit = UNKNOWN;
+	// 0 or 1, or UNKNOWN
+	GLuint m_blendEnabled = UNKNOWN;
+	TextureBinding m_textures[MAX_TEXTURE_UNITS];
+	BlendMode m_blend;
+	bool m_blendValid = false;
+	GLint m_viewport[4] = {};
+	bool m_viewportValid = false;
+
+	Stats m_frameStats;
+	Stats m_lastFrameStats;
+};
@@ -3,9 +3,13 @@
 #include <GL/glew.h>
 #include <vector>
 #include <initializer_list>
+#include <span>
 #include "Framework/Log.hpp"
 #include "GlCheck.hpp"
 #include "GlIDs.hpp"
+#include "GlStateCache.hpp"
+#include "StreamBuffer.hpp"
+#include "util/DirtyRanges.hpp"
 #include <assert.h>
 
 
@@ -141,6 +145,7 @@ public:
         inst_VBO = std::move(p_other.inst_VBO);
         VAO = std::move(p_other.VAO);
         IBO = std::move(p_other.IBO);
+        moveGPUState(p_other);
 
         return *this;
     }
@@ -168,7 +173,7 @@ public:
         inst_VBO = std::move(p_other.inst_VBO);
         VAO = std::move(p_other.VAO);
         IBO = std::move(p_other.IBO);
-
+        moveGPUState(p_other);
     }
     /// Allows you to skip a few memory allocations if you reserve it right off the bat.
     void reserve(size_t p_reserveAmount) { m_verts.reserve(p_reserveAmount); }
@@ -225,37 +230,57 @@ public:
 
     // only use if type T is a struct, or represents a vert with only one attribute
     void pushVertex(T&& p_vert) {
+        m_vertDirty.mark(m_verts.size(), m_verts.size() + 1);
         m_verts.push_back(p_vert);
     }
     // only use if type T is a struct, or represents a vert with only one attribute
     void pushVertex(T& p_vert) {
+        m_vertDirty.mark(m_verts.size(), m_verts.size() + 1);
         m_verts.push_back(p_vert);
     }
     /// Simply adds a vertex of type T to the end of the mesh list.
     // make sure you push a multiple of the total vert size worth of data.
     void pushVertices(const std::initializer_list<T>& p_attribs) {
+        m_vertDirty.mark(m_verts.size(), m_verts.size() + p_attribs.size());
         m_verts.insert(m_verts.end(), p_attribs);
     };
+    /// For changing stored vertices in place. Only this range gets uploaded by the next subCurrentVBOData().
+    std::span<T> editVertices(size_t p_first, size_t p_count) {
+        assert(p_first + p_count <= m_verts.size());
+        m_vertDirty.mark(p_first, p_first + p_count);
+        return { m_verts.data() + p_first, p_count };
+    }
 
     // only use if type T is a struct, or represents a instance with only one attribute
     void pushInstance(I&& p_instance) {
+        m_instDirty.mark(m_instances.size(), m_instances.size() + 1);
         m_instances.push_back(p_instance);
     }
     void setInstance(size_t p_index, I& p_value) {
         assert(p_index < m_instances.size());
+        m_instDirty.mark(p_index, p_index + 1);
         m_instances[p_index] = p_value;
     }
     void setInstance(size_t p_index, I&& p_value) {
         assert(p_index < m_instances.size());
+        m_instDirty.mark(p_index, p_index + 1);
         m_instances[p_index] = p_value;
     }
     void pushInstance(I& p_instance) {
+        m_instDirty.mark(m_instances.size(), m_instances.size() + 1);
         m_instances.push_back(p_instance);
     }
     /// type I must be a complete instance, no attrib splitting
     void pushInstances(const std::initializer_list<I>& p_attribs) {
+        m_instDirty.mark(m_instances.size(), m_instances.size() + p_attribs.size());
         m_instances.insert(m_instances.end(), p_attribs);
     };
+    /// Same as editVertices(), for the next subCurrentInstanceData().
+    std::span<I> editInstances(size_t p_first, size_t p_count) {
+        assert(p_first + p_count <= m_instances.size());
+        m_instDirty.mark(p_first, p_first + p_count);
+        return { m_instances.data() + p_first, p_count };
+    }
 
     void pushIndices(const std::initializer_list<GLuint>& p_attribs) {
         m_indices.insert(m_indices.end(), p_attribs);
@@ -277,18 +302,18 @@ public:
             instancesInitialized = true;
         }
 
-        glBindVertexArray(VAO->ID);
+        GLStateCache::Get().bindVertexArray(VAO->ID);
 
         glGenBuffers(1, &vert_VBO->ID);
         GLGEN_LOG("Generated Vertex Feedback Buffer " << vert_VBO->ID);
         VBOInitialized = true;
 
-        glCheck(glBindBuffer(GL_ARRAY_BUFFER, vert_VBO->ID));
+        GLStateCache::Get().bindArrayBuffer(vert_VBO->ID);
 
         setAttribPointers();
 
         if (usingInstancing) {
-            glCheck(glBindBuffer(GL_ARRAY_BUFFER, inst_VBO->ID));
+            GLStateCache::Get().bindArrayBuffer(inst_VBO->ID);
             glCheck(glBufferData(GL_ARRAY_BUFFER, sizeof(I) * m_instances.size(), m_instances.data(), m_streamType));
 
             setInstancePointers();
@@ -305,7 +330,7 @@ public:
         return capturedPrimitiveCount;
     }
     void startFeedback(GLenum primitiveType) {
-        glBindVertexArray(VAO->ID);
+        GLStateCache::Get().bindVertexArray(VAO->ID);
 
         glCheck(glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, vert_VBO->ID));
 
@@ -314,7 +339,7 @@ public:
         glGenQueries(1, &primitiveQuery);
         glBeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, primitiveQuery);
 
-        glCheck(glBindVertexArray(0));
+        GLStateCache::Get().bindVertexArray(0);
     }
 
     void endFeedback() {
@@ -330,9 +355,14 @@ public:
     size_t getTotalVBOSize() { return m_GPUVertCount; }
     size_t getTotalIBOSize() { return m_GPUIndicesCount; }
     size_t getStoredVertCount() { return m_verts.size(); }
-    size_t instanceCount() { return m_instances.size(); }
+    size_t instanceCount() { return m_instStream ? m_streamedInstances : m_instances.size(); }
     GLuint* getIBOPointer() { return m_indices.data(); }
-    I* getInstancePointer(size_t p_index = 0) { return &m_instances[p_index]; };
+    // Anything from here on could get changed through the pointer, so it's all uploaded next time. Use editInstances() where you can.
+    // Edits made through an old pointer after the next upload aren't seen at all.
+    I* getInstancePointer(size_t p_index = 0) {
+        m_instDirty.mark(p_index, m_instances.size());
+        return &m_instances[p_index];
+    };
 
     void pushVBOToGPU() {
         if (isFeedbackMesh) return;
@@ -341,7 +371,7 @@ public:
             GLGEN_LOG("Generated Vertex Array " << VAO->ID);
             VAOInitialized = true;
         }
-        glBindVertexArray(VAO->ID);
+        GLStateCache::Get().bindVertexArray(VAO->ID);
         if (!VBOInitialized) {
             glGenBuffers(1, &vert_VBO->ID);
             GLGEN_LOG("Generated Vertex Buffer " << vert_VBO->ID);
@@ -351,8 +381,11 @@ public:
             GLGEN_LOG("Re-generated Vertex Buffer " << vert_VBO->ID);
         }
 
-        glCheck(glBindBuffer(GL_ARRAY_BUFFER, vert_VBO->ID));
+        GLStateCache::Get().bindArrayBuffer(vert_VBO->ID);
         glCheck(glBufferData(GL_ARRAY_BUFFER, sizeof(T) * m_verts.size(), m_verts.data(), m_streamType));
+        countUpload(sizeof(T) * m_verts.size(), true);
+        m_GPUVertCapacity = m_verts.size();
+        m_vertDirty.clear();
 
         setAttribPointers();
 
@@ -369,7 +402,7 @@ public:
             GLGEN_LOG("Generated Vertex Array " << VAO->ID);
             VAOInitialized = true;
         }
-        glBindVertexArray(VAO->ID);
+        GLStateCache::Get().bindVertexArray(VAO->ID);
         if (!instancesInitialized && usingInstancing) {
             glGenBuffers(1, &inst_VBO->ID);
             GLGEN_LOG("Generated GPU Instancing Buffer " << inst_VBO->ID);
@@ -380,8 +413,11 @@ public:
         }
 
         if (usingInstancing) {
-            glCheck(glBindBuffer(GL_ARRAY_BUFFER, inst_VBO->ID));
+            GLStateCache::Get().bindArrayBuffer(inst_VBO->ID);
             glCheck(glBufferData(GL_ARRAY_BUFFER, sizeof(I) * m_instances.size(), m_instances.data(), m_streamType));
+            countUpload(sizeof(I) * m_instances.size(), true);
+            m_GPUInstanceCapacity = m_instances.size();
+            m_instDirty.clear();
 
             setInstancePointers();
         }
@@ -396,7 +432,7 @@ public:
             VAOInitialized = true;
         }
         if (m_indices.size() == 0) return;
-        glCheck(glBindVertexArray(VAO->ID));
+        GLStateCache::Get().bindVertexArray(VAO->ID);
         if (!IBOInitialized) {
             glGenBuffers(1, &IBO->ID);
             GLGEN_LOG("Generated Index Buffer " << IBO->ID);
@@ -406,43 +442,49 @@ public:
         glCheck(glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * m_indices.size(), m_indices.data(), m_streamType));
         glEnableVertexAttribArray(GL_NONE);
     }
+    /// Uploads only what changed since the last upload, see editVertices(). If the verts have outgrown the buffer it's a full pushVBOToGPU() instead.
     void subCurrentVBOData() {
         if (isFeedbackMesh) return;
-        glCheck(glBindVertexArray(VAO->ID));
-        if (!VBOInitialized) {
-            glGenBuffers(1, &vert_VBO->ID);
-            GLGEN_LOG("Generated Vertex Buffer " << vert_VBO->ID);
-            VBOInitialized = true;
+        if (!VBOInitialized || m_verts.size() > m_GPUVertCapacity) {
+            pushVBOToGPU();
+            return;
         }
-        glCheck(glBindBuffer(GL_ARRAY_BUFFER, vert_VBO->ID));
-        assert((m_verts.size() * sizeof(T)) / m_singleVertexSize == m_GPUVertCount);
-        glCheck(glBufferSubData(GL_ARRAY_BUFFER, 0, m_verts.size() * sizeof(T), m_verts.data()));
-        glBindVertexArray(0);
+        GLStateCache::Get().bindVertexArray(VAO->ID);
+        GLStateCache::Get().bindArrayBuffer(vert_VBO->ID);
+        uploadDirty(m_vertDirty, m_verts.data(), m_verts.size(), sizeof(T));
+        m_GPUVertCount = uint32_t(m_verts.size() * sizeof(T)) / m_singleVertexSize;
+        GLStateCache::Get().bindVertexArray(0);
     }
     // NOTE: endIndex is not inclusive, so setting start and end to the same value will not affect any data, make sure end is at least one greater than start
     void subVBOData(GLuint p_startIndex, GLuint p_endIndex, T* p_data) {
         if (isFeedbackMesh) return;
-        glCheck(glBindVertexArray(VAO->ID));
+        GLStateCache::Get().bindVertexArray(VAO->ID);
         if (!VBOInitialized) {
             glGenBuffers(1, &vert_VBO->ID);
             GLGEN_LOG("Generated Vertex Buffer " << vert_VBO->ID);
             VBOInitialized = true;
         }
-        glCheck(glBindBuffer(GL_ARRAY_BUFFER, vert_VBO->ID));
+        GLStateCache::Get().bindArrayBuffer(vert_VBO->ID);
         glCheck(glBufferSubData(GL_ARRAY_BUFFER, p_startIndex * sizeof(T), (p_endIndex - p_startIndex) * sizeof(T), p_data));
-        glBindVertexArray(0);
+        countUpload((p_endIndex - p_startIndex) * sizeof(T), false);
+        GLStateCache::Get().bindVertexArray(0);
     }
+    /// Same as subCurrentVBOData(), for the instances.
     void subCurrentInstanceData() {
         if (!instancesInitialized || !usingInstancing) {
             ERROR_LOG("You forgot to give the mesh any instances in the first place.");
             return;
         }
-        glCheck(glBindVertexArray(VAO->ID));
-        glCheck(glBindBuffer(GL_ARRAY_BUFFER, inst_VBO->ID));
+        if (m_instances.size() > m_GPUInstanceCapacity) {
+            pushInstancesToGPU();
+            return;
+        }
+        GLStateCache::Get().bindVertexArray(VAO->ID);
+        GLStateCache::Get().bindArrayBuffer(inst_VBO->ID);
         // I guess make sure that the single instance size is correct
         assert((m_instances.size() * sizeof(I)) / m_singleInstanceSize == instanceCount());
-        glCheck(glBufferSubData(GL_ARRAY_BUFFER, 0, m_instances.size() * sizeof(I), m_instances.data()));
-        glBindVertexArray(0);
+        uploadDirty(m_instDirty, m_instances.data(), m_instances.size(), sizeof(I));
+        GLStateCache::Get().bindVertexArray(0);
     }
     // NOTE: endIndex is not inclusive, so setting start and end to the same value will not affect any data, make sure end is at least one greater than start
     void subInstanceData(GLuint p_startIndex, GLuint p_endIndex, I* p_data) {
@@ -450,9 +492,10 @@ public:
             ERROR_LOG("You forgot to give the mesh any instances in the first place.");
             return;
         }
-        glCheck(glBindVertexArray(VAO->ID));
-        glCheck(glBindBuffer(GL_ARRAY_BUFFER, inst_VBO->ID));
+        GLStateCache::Get().bindVertexArray(VAO->ID);
+        GLStateCache::Get().bindArrayBuffer(inst_VBO->ID);
         glCheck(glBufferSubData(GL_ARRAY_BUFFER, p_startIndex * sizeof(I), (p_endIndex - p_startIndex) * sizeof(I), p_data));
+        countUpload((p_endIndex - p_startIndex) * sizeof(I), false);
     }
 
     void resetGPUCounts() {
@@ -479,16 +522,153 @@ public:
         IBOInitialized = false;
         usingInstancing = false;
         instancesInitialized = false;
+        m_vertStream.reset();
+        m_instStream.reset();
+        m_vertStreamGeneration = 0;
+        m_instStreamGeneration = 0;
+        m_firstVertex = 0;
+        m_baseInstance = 0;
+        m_streamedInstances = 0;
+        m_vertDirty.clear();
+        m_instDirty.clear();
+        m_GPUVertCapacity = 0;
+        m_GPUInstanceCapacity = 0;
     };
 
+    // There's no telling what gets changed through this, so the next subCurrentVBOData() sends everything. Use editVertices() where you can.
     std::vector<T>& getVerts() {
+        m_vertDirty.markAll();
         return m_verts;
     }
+
+    /// If the dirty part of a buffer is more than this fraction of it, the partial uploads send the whole thing in one call instead.
+    void setFullUploadRatio(float p_ratio) { m_fullUploadRatio = p_ratio; }
+    /// Dirty ranges closer than this many bytes get uploaded together.
+    void setDirtyMergeGap(size_t p_bytes) {
+        m_vertDirty.setMergeGap(std::max<size_t>(p_bytes / sizeof(T), 1));
+        m_instDirty.setMergeGap(std::max<size_t>(p_bytes / sizeof(I), 1));
+    }
+    struct UploadStats {
+        uint64_t bytesUploaded = 0;
+        uint64_t uploadCalls = 0;
+        // glBufferData calls, and partial uploads that went over the ratio
+        uint64_t fullUploads = 0;
+    };
+    // Streamed data isn't counted here, see StreamBuffer::getStats() for that.
+    UploadStats getUploadStats() const { return m_uploadStats; }
+    void resetUploadStats() { m_uploadStats = UploadStats(); }
+
+    /// Streaming mode, for geometry that's rewritten every frame. Instead of building up the mesh and pushing it, ask for room
+    /// for p_count values and write them straight into the returned span, which is mapped GPU memory (see StreamBuffer).
+    /// The mesh draws whatever was last streamed, so write everything in one go, then draw as many times as you like.
+    /// Streaming again in the same frame is fine too, each call gets its own memory.
+    /// Don't read from the span, and don't hold onto it past the next stream call.
+    /// Attributes have to be set up first. The CPU side lists aren't touched, so hasData() and the push/sub functions don't apply.
+    std::span<T> streamVertices(size_t p_count) {
+        if (isFeedbackMesh) {
+            ERROR_LOG("Feedback meshes can't be streamed.");
+            return {};
+        }
+        if (!m_vertStream) m_vertStream = std::make_unique<StreamBuffer>();
+        size_t vertCount = (p_count * sizeof(T) + m_singleVertexSize - 1) / m_singleVertexSize;
+        T* memory = static_cast<T*>(m_vertStream->next(vertCount * m_singleVertexSize, m_singleVertexSize));
+        if (m_vertStream->getGeneration() != m_vertStreamGeneration) {
+            // new buffer, so the VAO needs pointing at it
+            bindForStreaming(m_vertStream->getID());
+            setAttribPointers();
+            m_vertStreamGeneration = m_vertStream->getGeneration();
+        }
+        m_firstVertex = GLint(m_vertStream->offset() / m_singleVertexSize);
+        m_GPUVertCount = uint32_t(p_count * sizeof(T) / m_singleVertexSize);
+        VBOInitialized = true;
+        return { memory, p_count };
+    }
+    /// Same as streamVertices(), for the instance attributes. type I must be a complete instance.
+    std::span<I> streamInstances(size_t p_count) {
+        if (!m_instStream) m_instStream = std::make_unique<StreamBuffer>();
+        I* memory = static_cast<I*>(m_instStream->next(p_count * sizeof(I), sizeof(I)));
+        if (m_instStream->getGeneration() != m_instStreamGeneration) {
+            bindForStreaming(m_instStream->getID());
+            setInstancePointers();
+            m_instStreamGeneration = m_instStream->getGeneration();
+        }
+        m_baseInstance = GLuint(m_instStream->offset() / sizeof(I));
+        m_streamedInstances = p_count;
+        instancesInitialized = true;
+        return { memory, p_count };
+    }
+    bool isStreaming() const { return m_vertStream || m_instStream; }
+    // Where the draw starts in the buffers, only ever non-zero for streamed meshes.
+    GLint getFirstVertex() const { return m_firstVertex; }
+    GLuint getBaseInstance() const { return m_baseInstance; }
+    // nullptr if that side isn't being streamed.
+    const StreamBuffer* getVertexStream() const { return m_vertStream.get(); }
+    const StreamBuffer* getInstanceStream() const { return m_instStream.get(); }
+    // For filling instances in place, e.g. resize it then have several threads write their own ranges.
+    // Like getVerts(), this makes the next subCurrentInstanceData() send everything.
+    std::vector<I>& getInstances() {
+        m_instDirty.markAll();
+        return m_instances;
+    }
     bool isFeedbackMesh = false;
     bool feedbackInitDone = false;
 
 private:
 
+    void bindForStreaming(GLuint p_buffer) {
+        if (!VAOInitialized) {
+            glGenVertexArrays(1, &VAO->ID);
+            GLGEN_LOG("Generated Vertex Array " << VAO->ID);
+            VAOInitialized = true;
+        }
+        GLStateCache::Get().bindVertexArray(VAO->ID);
+        GLStateCache::Get().bindArrayBuffer(p_buffer);
+    }
+    void moveGPUState(Mesh& p_other) {
+        m_vertStream = std::move(p_other.m_vertStream);
+        m_instStream = std::move(p_other.m_instStream);
+        m_vertStreamGeneration = p_other.m_vertStreamGeneration;
+        m_instStreamGeneration = p_other.m_instStreamGeneration;
+        m_firstVertex = p_other.m_firstVertex;
+        m_baseInstance = p_other.m_baseInstance;
+        m_streamedInstances = p_other.m_streamedInstances;
+        m_vertDirty = p_other.m_vertDirty;
+        m_instDirty = p_other.m_instDirty;
+        m_GPUVertCapacity = p_other.m_GPUVertCapacity;
+        m_GPUInstanceCapacity = p_other.m_GPUInstanceCapacity;
+        m_fullUploadRatio = p_other.m_fullUploadRatio;
+        m_uploadStats = p_other.m_uploadStats;
+    }
+
+    // expects the buffer to be bound already
+    void uploadDirty(DirtyRanges& p_dirty, const void* p_data, size_t p_count, size_t p_elementSize) {
+        if (p_dirty.empty() || p_count == 0) {
+            p_dirty.clear();
+            return;
+        }
+        const uint8_t* data = static_cast<const uint8_t*>(p_data);
+        std::span<const DirtyRanges::Range> ranges = p_dirty.coalesce(p_count);
+        size_t dirtyCount = 0;
+        for (const DirtyRanges::Range& range : ranges) dirtyCount += range.size();
+
+        if (dirtyCount > p_count * m_fullUploadRatio) {
+            glCheck(glBufferSubData(GL_ARRAY_BUFFER, 0, p_count * p_elementSize, data));
+            countUpload(p_count * p_elementSize, true);
+        }
+        else {
+            for (const DirtyRanges::Range& range : ranges) {
+                glCheck(glBufferSubData(GL_ARRAY_BUFFER, range.begin * p_elementSize, range.size() * p_elementSize, data + range.begin * p_elementSize));
+                countUpload(range.size() * p_elementSize, false);
+            }
+        }
+        p_dirty.clear();
+    }
+    void countUpload(size_t p_bytes, bool p_full) {
+        m_uploadStats.bytesUploaded += p_bytes;
+        m_uploadStats.uploadCalls++;
+        if (p_full) m_uploadStats.fullUploads++;
+    }
+
     void setAttribPointers() {
         uint64_t currentOffset = 0; // Offset that needs to be updated as arbitrary amounts of attributes are added. 
         for (uint32_t i = 0; i < m_attribList.size(); i++) {
@@ -569,6 +749,26 @@ private:
 
     // By default, vbo data is expected not to change. Be sure to set it to dynamic if that is not the case.
     GLenum m_streamType = GL_STATIC_DRAW;
+
+    // streaming mode, only made once something's streamed
+    std::unique_ptr<StreamBuffer> m_vertStream;
+    std::unique_ptr<StreamBuffer> m_instStream;
+    // which version of the stream buffers the VAO's attributes point at
+    uint32_t m_vertStreamGeneration = 0;
+    uint32_t m_instStreamGeneration = 0;
+    GLint m_firstVertex = 0;
+    GLuint m_baseInstance = 0;
+    size_t m_streamedInstances = 0;
+
+    // what's changed since the last upload, in elements of T and I
+    static constexpr size_t DEFAULT_MERGE_GAP_BYTES = 256;
+    DirtyRanges m_vertDirty{ std::max<size_t>(DEFAULT_MERGE_GAP_BYTES / sizeof(T), 1) };
+    DirtyRanges m_instDirty{ std::max<size_t>(DEFAULT_MERGE_GAP_BYTES / sizeof(I), 1) };
+    // how many elements the GPU buffers were last allocated with
+    size_t m_GPUVertCapacity = 0;
+    size_t m_GPUInstanceCapacity = 0;
+    float m_fullUploadRatio = 0.5f;
+    UploadStats m_uploadStats;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,158 @@
+#pragma once
+#include "GL/glew.h"
+#include <vector>
+#include <span>
+#include <unordered_map>
+#include <stdint.h>
+#include "Framework/Graphics/DrawStates.hpp"
+#include "Framework/Graphics/Mesh.hpp"
+#include "Framework/Graphics/GlCheck.hpp"
+
+// How a pass's draws get put in order before they're submitted. Layers always come first either way.
+enum class SubmitOrder {
+	// Exactly the order they were drawn in, for anything that relies on the painter's algorithm, like GUI.
+	Submission,
+	// Grouped by shader, then texture set, then blend mode, then depth, so the state cache gets to skip as much as possible.
+	// Draws with the same key keep the order they were drawn in.
+	State
+};
+
+// Everything a deferred draw needs, copied out of its DrawStates when it's recorded.
+// The mesh is only pointed to, so it has to stay alive (and keep its VAO) until the queue is executed.
+struct RenderCommand {
+	uint64_t key = 0;
+	void* mesh = nullptr;
+	// the draw call itself, for whatever kind of mesh it is
+	void (*submit)(void* p_mesh, GLenum p_primitiveType) = nullptr;
+	GLuint VAO = 0;
+	GLenum primitiveType = GL_TRIANGLES;
+	Shader* shader = nullptr;
+	BlendMode blendMode;
+	// ranges in the queue's texture and uniform arrays
+	uint32_t firstTexture = 0;
+	uint32_t textureCount = 0;
+	uint32_t firstUniform = 0;
+	uint32_t uniformCount = 0;
+	glm::mat4 transform = glm::mat4(1.f);
+};
+
+// Records draws instead of doing them, then sorts and submits the lot in one go. DrawSurface owns one, see DrawSurface::beginPass().
+// Recording never touches GL, so the command stream can be checked without a context: record, then look at sort().
+//
+// The 64 bit sort key, top bits first:
+//   Submission: layer (8) | draw index (56)
+//   State:      layer (8) | shader (12) | texture set (16) | blend mode (8) | depth (20)
+// Shaders, texture sets and blend modes are numbered in the order they're first seen in the pass. Past the limit of a field
+// they all share its last number, which only makes the sort a bit worse, since every command keeps its own state.
+class RenderQueue {
+public:
+	struct TextureRef {
+		GLenum type;
+		GLuint ID;
+	};
+	struct Entry {
+		uint64_t key;
+		uint32_t index;
+	};
+
+	static constexpr int LAYER_SHIFT = 56;
+	static constexpr int SHADER_SHIFT = 44;
+	static constexpr int TEXTURE_SET_SHIFT = 28;
+	static constexpr int BLEND_SHIFT = 20;
+	static constexpr uint32_t MAX_SHADER_ID = (1 << 12) - 1;
+	static constexpr uint32_t MAX_TEXTURE_SET_ID = (1 << 16) - 1;
+	static constexpr uint32_t MAX_BLEND_ID = (1 << 8) - 1;
+	static constexpr uint32_t MAX_DEPTH = (1 << 20) - 1;
+
+	// Throws away anything recorded and starts over with a new order.
+	void begin(SubmitOrder p_order);
+	void clear();
+
+	// Copies the states, so they can be changed or thrown away straight after.
+	template<typename T, typename I>
+	void record(Mesh<T, I>& p_mesh, GLenum p_primitiveType, const DrawStates& p_states) {
+		RenderCommand& command = push(p_states);
+		command.mesh = &p_mesh;
+		command.submit = &drawMesh<T, I>;
+		command.VAO = p_mesh.VAO->ID;
+		command.primitiveType = p_primitiveType;
+	}
+
+	// Radix sorts the recorded commands by key, the result is good until the next record() or clear().
+	std::span<const Entry> sort();
+	// Sorts, then binds and draws every command. Everything goes through the state cache, so consecutive commands
+	// with the same state only cost their uniform uploads and the draw call. Doesn't clear.
+	void execute();
+
+	SubmitOrder getOrder() const {
+		return m_order;
+	}
+	size_t size() const {
+		return m_commands.size();
+	}
+	bool empty() const {
+		return m_commands.empty();
+	}
+	// By the index in an Entry, which is the order they were recorded in.
+	const RenderCommand& operator[](uint32_t p_index) const {
+		return m_commands[p_index];
+	}
+	std::span<const TextureRef> textures(const RenderCommand& p_command) const {
+		return std::span<const TextureRef>(m_textures).subspan(p_command.firstTexture, p_command.textureCount);
+	}
+	std::span<const DrawStates::UniformValue> uniforms(const RenderCommand& p_command) const {
+		return std::span<const DrawStates::UniformValue>(m_uniforms).subspan(p_command.firstUniform, p_command.uniformCount);
+	}
+
+	// The draw call for a mesh that's already bound, shared with DrawSurface's immediate draws.
+	template<typename T, typename I>
+	static void drawMesh(void* p_mesh, GLenum p_primitiveType) {
+		Mesh<T, I>& mesh = *static_cast<Mesh<T, I>*>(p_mesh);
+		// streamed meshes start partway into their buffers, everything else starts at 0
+		GLint firstVertex = mesh.getFirstVertex();
+		GLuint baseInstance = mesh.getBaseInstance();
+		if (mesh.IBOInitialized) {
+			if (!mesh.instancesInitialized)
+				glCheck(glDrawElementsBaseVertex(p_primitiveType, (GLsizei)mesh.getTotalIBOSize(), GL_UNSIGNED_INT, 0, firstVertex));
+			else
+				glCheck(glDrawElementsInstancedBaseVertexBaseInstance(p_primitiveType, (GLsizei)mesh.getTotalIBOSize(), GL_UNSIGNED_INT, 0, (GLsizei)mesh.instanceCount(), firstVertex, baseInstance));
+			return;
+		}
+		GLsizei count;
+		if (mesh.isFeedbackMesh) {
+			// these are the only three things a feedback mesh can be
+			count = (GLsizei)mesh.getCapturedPrimitiveCount();
+			if (p_primitiveType == GL_TRIANGLES) count *= 3;
+			else if (p_primitiveType == GL_LINES) count *= 2;
+		}
+		else {
+			count = static_cast<GLsizei>(mesh.getTotalVBOSize());
+		}
+		if (!mesh.instancesInitialized)
+			glCheck(glDrawArrays(p_primitiveType, firstVertex, count));
+		else
+			glCheck(glDrawArraysInstancedBaseInstance(p_primitiveType, firstVertex, count, static_cast<GLsizei>(mesh.instanceCount()), baseInstance));
+	}
+private:
+	// fills in everything but the mesh
+	RenderCommand& push(const DrawStates& p_states);
+	uint64_t stateKey(const DrawStates& p_states, uint32_t p_firstTexture);
+
+	uint32_t shaderID(const Shader* p_shader);
+	uint32_t textureSetID(uint32_t p_firstTexture, uint32_t p_count);
+	uint32_t blendID(const BlendMode& p_mode);
+
+	SubmitOrder m_order = SubmitOrder::State;
+	std::vector<RenderCommand> m_commands;
+	std::vector<TextureRef> m_textures;
+	std::vector<DrawStates::UniformValue> m_uniforms;
+	std::vector<Entry> m_entries;
+	std::vector<Entry> m_scratch;
+	// the entries are already in key order, which submission order passes without layers always are
+	bool m_sorted = true;
+
+	// numbering for the key, per pass
+	std::vector<const Shader*> m_shaders;
+	std::unordered_map<uint64_t, uint32_t> m_textureSets;
+	std::vector<BlendMode> m_blendModes;
+};
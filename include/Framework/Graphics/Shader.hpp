@@ -6,11 +6,52 @@
 #include <vector>
 #include <string>
 #include <string_view>
+#include <memory>
+#include <stdint.h>
 #include "Framework/Log.hpp"
 #include "Framework/Graphics/Uniform.hpp"
 #include "GlIDs.hpp"
 
+/// Every active uniform in a linked program, looked up once at link time so finding a location never has to ask the driver.
+/// Also remembers the last value sent to each one, so setting a uniform to what it already is can skip the GL call.
+/// Shared between copies of a Shader, the same way the program is.
+struct UniformTable
+{
+	struct Entry {
+		std::string name;
+		uint32_t hash = 0;
+		GLint location = -1;
+		GLenum type = 0;
+		GLint arraySize = 0;
+		// last value sent, only meaningful while shadowValid is set
+		bool shadowValid = false;
+		alignas(16) unsigned char shadow[sizeof(glm::mat4)] = {};
+	};
+
+	/// Reads every active uniform out of a linked program, replacing whatever was there.
+	void reflect(GLuint p_programID);
+	/// -1 if the program has no active uniform by that name. "name[0]" and "name" both find an array.
+	GLint find(std::string_view p_name) const;
+	/// Records p_value as the uniform's value. Returns false if that's what it already was, meaning the upload can be skipped.
+	/// Locations the table doesn't know about always return true.
+	bool update(GLint p_loc, const void* p_value, size_t p_size);
+	/// Forgets the value at p_loc, so the next update() there goes through.
+	void invalidate(GLint p_loc);
+
+	std::vector<Entry> entries;
+	GLint transformLoc = -1;
+
+	static uint32_t hashName(std::string_view p_name);
+private:
+	// open addressing, power of two sized, holds index + 1 into entries, 0 for empty
+	std::vector<uint32_t> m_slots;
+	// location -> index + 1 into entries
+	std::vector<uint32_t> m_byLocation;
+};
+
 /// A wrapper for an OpenGL shader program, allows simple compilation and uniform setting.
+/// The set*Uniform functions only talk to GL when the value actually changed. The static ones can't know which program they're
+/// setting, so they always upload, and just make sure the last Shader to use() doesn't think it still knows the value.
 class Shader
 {
 public:
@@ -97,11 +138,34 @@ public:
 	// Only works with strings, no locations.
 	//void setUniforms(std::vector<Uniform> p_uniforms);
 
+	/// Looks the name up in the uniforms reflected at link time, no driver call involved.
 	GLuint getUniformLoc(std::string_view uniformName);
+	/// Location of "transform", which pretty much every shader has. Saves even the hash lookup on every draw.
+	GLint getTransformLoc() const;
 	GLuint getUniformBlockIndex(std::string_view uniformBlockName);
 	std::shared_ptr<glProgram> program = std::make_shared<glProgram>();
+
+	/// Uniform uploads across every shader, reset by endFrame().
+	struct UniformStats {
+		uint64_t uploaded = 0;
+		uint64_t skipped = 0;
+	};
+	/// Counts for the last full frame.
+	static UniformStats getUniformStats();
+	/// Called by GameWindow::displayNewFrame().
+	static void endFrame();
 private:
+	// Returns true if the value at p_loc changed and needs uploading, and counts it either way.
+	bool shadowUniform(GLint p_loc, const void* p_value, size_t p_size) const;
+	static void invalidateCurrent(GLint p_loc);
+
 	std::vector<Uniform> m_uniforms;
+	std::shared_ptr<UniformTable> m_uniformTable = std::make_shared<UniformTable>();
+
+	// table of whichever Shader last called use(), so the static setters know what they're overwriting
+	static std::weak_ptr<UniformTable> s_currentTable;
+	static UniformStats s_frameStats;
+	static UniformStats s_lastFrameStats;
 };
 
 #endif
\ No newline at end of file
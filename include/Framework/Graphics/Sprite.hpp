@@ -24,6 +24,8 @@ public:
 	void attachShader(Shader* p_shader);
 	void attachTexture(Texture p_texture);
 	Texture& getTexture();
+	// nullptr until the first draw() if nothing was attached, which then picks the image shader.
+	Shader* getShader();
 	void draw(DrawSurface& p_target, const DrawStates& p_drawStates);
 
 	// We don't want to override the setorigin class of the inherited class, so we name it something different
@@ -32,11 +34,18 @@ public:
 
 	// only works with the basic image shader, unless uniform 2 is bound to opacity.
 	void setOpacity(float p_opacity);
+	float getOpacity() const;
+
+	// The part of the texture to show, in texture coordinates from the top left. Defaults to all of it.
+	void setUVRect(Rect p_uvRect);
+	const Rect& getUVRect() const;
 
 	Rect bounds;
 private:
 	void initForDraw(); // manual init in cases where gpu stuff can't be done right off the bat
+	void pushQuad();
 	float opacity = 0.f;
+	Rect m_uvRect = Rect(0.f, 0.f, 1.f, 1.f);
 
 	Mesh<GLfloat> m_spriteMesh{NO_VAO_INIT};
 	// Optional attachments directly to the sprite, so you don't have to worry about setting your drawStates properly before draw().
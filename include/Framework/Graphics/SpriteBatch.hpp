@@ -0,0 +1,92 @@
+#pragma once
+#include "GL/glew.h"
+#include <vector>
+#include <span>
+#include <stdint.h>
+#include "Framework/Graphics/Sprite.hpp"
+#include "Framework/Graphics/DrawStates.hpp"
+#include "Framework/Graphics/Mesh.hpp"
+#include "Framework/Graphics/RenderQueue.hpp"
+
+class ThreadPool;
+
+// What each sprite turns into in the batch's instance buffer.
+struct SpriteInstance {
+	// states transform * sprite transform * bounds, so the unit quad lands where the sprite's own mesh would.
+	glm::mat4 transform;
+	// x, y, width, height in texture coordinates
+	glm::vec4 uvRect;
+	float opacity;
+};
+
+// Draws a lot of sprites with a handful of draw calls. Sprites are grouped by shader, texture and blend mode, every sprite
+// becomes one instance in a single stream buffer that's written in place once per draw(), and each group is one instanced draw.
+// None of the sprites' own meshes are touched, so a sprite can be drawn either way.
+//
+// Use it like: add() every sprite for the frame, then draw(), which draws them all into whatever's bound and starts over.
+// Sprites are only pointed to, so they have to stay alive until draw(). It always draws immediately, even if the
+// surface is in a deferred pass.
+// Sprites with the default image shader get drawn with GenericShaders::spriteBatchShader. Any other shader attached
+// to a sprite has to take the same attributes: vec2 corner at 0, then instanced mat4 transform at 1-4, vec4 uv rect at 5,
+// and float opacity at 6, plus the usual transform uniform, which gets the identity.
+//
+// The instances can be built across a thread pool. Each sprite updates its own transform when it's built, so with a pool,
+// don't add the same sprite twice in one batch.
+class SpriteBatch {
+public:
+	// SubmitOrder::State groups every sprite with the same state together, no matter what was added in between, which is
+	// the fewest draws but only looks right if the sprites don't overlap or the depth test sorts them out.
+	// SubmitOrder::Submission only groups runs of sprites with the same state, so they're drawn in the order they were added.
+	SpriteBatch(SubmitOrder p_order = SubmitOrder::State) : m_order(p_order) {}
+
+	// The states give the parent transform, the blend mode, and the texture for sprites that don't have their own.
+	// Like Sprite::draw(), the shader is always the sprite's.
+	void add(Sprite& p_sprite, const DrawStates& p_states);
+	void add(std::span<Sprite* const> p_sprites, const DrawStates& p_states);
+
+	// Builds the instances (across p_pool if there is one), uploads them and draws every batch, then clears.
+	void draw(ThreadPool* p_pool = nullptr);
+	void clear();
+
+	size_t spriteCount() const {
+		return m_entries.size();
+	}
+	size_t batchCount() const {
+		return m_batches.size();
+	}
+	// How many draws the last draw() took.
+	size_t getLastDrawCalls() const {
+		return m_lastDrawCalls;
+	}
+private:
+	struct Batch {
+		Shader* shader;
+		GLenum textureType;
+		GLuint texture;
+		BlendMode blendMode;
+		uint32_t first;
+		uint32_t count;
+	};
+	struct Entry {
+		Sprite* sprite;
+		uint32_t batch;
+		// position within its batch
+		uint32_t rank;
+		uint32_t parent;
+	};
+
+	uint32_t findBatch(Shader* p_shader, const Texture* p_texture, const BlendMode& p_blendMode);
+	void build(std::span<SpriteInstance> o_instances, ThreadPool* p_pool);
+	void initForDraw();
+
+	SubmitOrder m_order;
+	std::vector<Entry> m_entries;
+	std::vector<Batch> m_batches;
+	// the states transforms sprites were added with, usually just the one
+	std::vector<glm::mat4> m_parents;
+
+	Mesh<GLfloat, SpriteInstance> m_mesh{ NO_VAO_INIT };
+	glm::mat4 m_identity = glm::mat4(1.f);
+	bool m_drawReady = false;
+	size_t m_lastDrawCalls = 0;
+};
@@ -0,0 +1,151 @@
+#pragma once
+#include "GL/glew.h"
+#include <memory>
+#include <algorithm>
+#include <stdint.h>
+#include "Framework/Log.hpp"
+#include "Framework/Graphics/GlCheck.hpp"
+#include "Framework/Graphics/GlIDs.hpp"
+#include "Framework/Graphics/GlStateCache.hpp"
+
+// A GL buffer that's mapped once and stays mapped, split into SECTIONS equal pieces, one per frame, used round robin.
+// Each write goes straight into the mapped memory, nothing gets staged on the CPU and nothing gets reallocated by the driver.
+// Every next() in a frame gets its own piece of that frame's section, so streaming the same thing several times a frame
+// (say a SpriteBatch drawn for the world, the GUI and an offscreen target) never waits on anything.
+// The first next() of a new frame puts a fence in behind whatever was drawn from the last section and moves on, and a
+// section isn't handed out again until its fence has passed. With three sections the GPU can be a couple of frames
+// behind before anything waits. If a frame needs more than a section holds, the buffer is replaced with a bigger one.
+// The mapping is coherent, so there's nothing to flush: write, then draw.
+// Used by Mesh's streaming mode, see Mesh::streamVertices(). Frames are counted by endFrame(), which GameWindow calls.
+class StreamBuffer {
+public:
+	static constexpr uint32_t SECTIONS = 3;
+	static constexpr size_t MIN_SECTION_SIZE = size_t(64) << 10;
+
+	StreamBuffer() {}
+	StreamBuffer(const StreamBuffer& other) = delete;
+	StreamBuffer& operator=(const StreamBuffer& other) = delete;
+	~StreamBuffer() {
+		deleteFences();
+	}
+
+	// Returns room for p_bytes in this frame's section, after anything already handed out this frame.
+	// Everything is kept a multiple of p_stride, so offset() is always a whole number of elements in.
+	// If it doesn't fit, the whole buffer is replaced with one that fits the frame so far, which bumps getGeneration().
+	void* next(size_t p_bytes, size_t p_stride) {
+		if (m_memory && p_stride == m_stride) {
+			if (m_frame != s_frame) {
+				// whatever was going to be drawn from the last section has been queued by now
+				m_fences[m_section] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+				m_section = (m_section + 1) % SECTIONS;
+				m_sectionUsed = 0;
+				wait(m_section);
+			}
+			if (m_sectionUsed + p_bytes > m_sectionSize) allocate(m_sectionUsed + p_bytes, p_stride);
+		}
+		else {
+			allocate(p_bytes, p_stride);
+		}
+		m_frame = s_frame;
+		m_offset = m_section * m_sectionSize + m_sectionUsed;
+		m_sectionUsed += (p_bytes + p_stride - 1) / p_stride * p_stride;
+		m_stats.bytesWritten += p_bytes;
+		return m_memory + m_offset;
+	}
+
+	// Called by GameWindow::displayNewFrame(), so the next next() on every stream buffer moves on to a new section.
+	static void endFrame() {
+		s_frame++;
+	}
+
+	GLuint getID() const {
+		return m_buffer ? m_buffer->ID : 0;
+	}
+	// Goes up every time the buffer is replaced, so anything pointing at it (like a VAO) knows to update.
+	// The ID can't be used for that, since GL is free to hand the old name straight back out.
+	uint32_t getGeneration() const {
+		return m_generation;
+	}
+	// Byte offset of the memory last returned by next().
+	size_t offset() const {
+		return m_offset;
+	}
+	size_t sectionSize() const {
+		return m_sectionSize;
+	}
+
+	struct Stats {
+		uint64_t bytesWritten = 0;
+		// times next() had to wait on the GPU, which only happens if it's SECTIONS frames behind
+		uint64_t stalls = 0;
+		uint64_t reallocations = 0;
+	};
+	Stats getStats() const {
+		return m_stats;
+	}
+private:
+	void allocate(size_t p_bytes, size_t p_stride) {
+		deleteFences();
+		// some headroom, so something that grows a little every frame doesn't reallocate every frame
+		size_t size = std::max({ p_bytes + p_bytes / 2, m_sectionSize, MIN_SECTION_SIZE });
+		size = (size + p_stride - 1) / p_stride * p_stride;
+		if (m_memory) m_stats.reallocations++;
+
+		// GL keeps the old one alive until the draws using it are done
+		m_buffer = std::make_unique<glBuffer>();
+		glGenBuffers(1, &m_buffer->ID);
+		GLGEN_LOG("Generated Stream Buffer " << m_buffer->ID << " with " << SECTIONS << " sections of " << size << " bytes");
+		GLStateCache::Get().bindArrayBuffer(m_buffer->ID);
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glCheck(glBufferStorage(GL_ARRAY_BUFFER, size * SECTIONS, nullptr, flags));
+		m_memory = static_cast<uint8_t*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, size * SECTIONS, flags));
+		if (!m_memory) {
+			ERROR_LOG("Failed to map a " << size * SECTIONS << " byte stream buffer.");
+			throw std::runtime_error("Stream buffer mapping failed");
+		}
+		m_sectionSize = size;
+		m_stride = p_stride;
+		m_section = 0;
+		m_sectionUsed = 0;
+		m_generation++;
+	}
+	void wait(uint32_t p_section) {
+		GLsync& fence = m_fences[p_section];
+		if (!fence) return;
+		GLenum result = glClientWaitSync(fence, 0, 0);
+		if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) {
+			m_stats.stalls++;
+			// the GPU is a whole ring behind, so there's nothing for it but to wait
+			while (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) {
+				if (result == GL_WAIT_FAILED) {
+					ERROR_LOG("Waiting on a stream buffer fence failed.");
+					break;
+				}
+				result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+			}
+		}
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+	void deleteFences() {
+		for (GLsync& fence : m_fences) {
+			if (fence) glDeleteSync(fence);
+			fence = nullptr;
+		}
+	}
+
+	std::unique_ptr<glBuffer> m_buffer;
+	uint8_t* m_memory = nullptr;
+	size_t m_sectionSize = 0;
+	size_t m_stride = 1;
+	uint32_t m_section = 0;
+	// how much of the current section this frame has taken
+	size_t m_sectionUsed = 0;
+	size_t m_offset = 0;
+	uint64_t m_frame = 0;
+	uint32_t m_generation = 0;
+	GLsync m_fences[SECTIONS] = {};
+	Stats m_stats;
+
+	static inline uint64_t s_frame = 0;
+};
@@ -57,7 +57,7 @@ private:
 	bool m_atlasInitialized = false;
 	bool m_sizeSet = false;
 	uint8_t m_maxGlyphCount = 255;
-	StaticArray2D<uint8_t> m_atlas;
+	StaticArray2D<uint8_t, AlignedGridAllocator> m_atlas;
 	Texture m_atlasTexture;
 };
 
@@ -25,7 +25,8 @@ public:
 	void setType(GLenum p_type);
 	void setChannels(GLenum p_channels);
 
-	void fromByteData(uint32_t p_width, uint32_t p_height, unsigned char* p_data);
+	// p_rowLength is how many pixels apart rows are in p_data, for padded rows. 0 means they're packed.
+	void fromByteData(uint32_t p_width, uint32_t p_height, unsigned char* p_data, uint32_t p_rowLength = 0);
 	void fromVec4Data(uint32_t p_width, uint32_t p_height, glm::vec4* p_data);
 
 	void useMipmaps(int p_count);
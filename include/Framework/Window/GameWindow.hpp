@@ -41,7 +41,7 @@ public:
 
 	// Used to enable and disable the framerate limit.
 	void setVSync(bool p_enabled);
-	// Swaps the doublebuffer, and shows the new frame.
+	// Swaps the doublebuffer, and shows the new frame. Also ends the frame for every FrameArena and StreamBuffer.
 	void displayNewFrame();
 
 	void toggleFullscreen();
@@ -3,27 +3,31 @@
 #include <vector>
 #include "Framework/Log.hpp"
 #include <algorithm>
-template<class T>
+#include <type_traits>
+#include "ArrayLayout.hpp"
+#include "ArrayOps.hpp"
+template<class T, class Layout = RowMajorLayout>
+// Layout decides how cells sit in memory, see ArrayLayout.hpp. Anything but row major pads the storage out to whole tiles.
 class Array2D {
 public:
 	Array2D() { width = 0; height = 0; data = std::vector<T>(); }
 	Array2D(uint32_t p_width, uint32_t p_height) {
-		data.resize(p_width * p_height, T());
+		data.resize(Layout::storageSize2D(p_width, p_height), T());
 
 		width = p_width;
 		height = p_height;
 	}
-	Array2D(const Array2D<T>& other) {
+	Array2D(const Array2D<T, Layout>& other) {
 		data = other.data;
 		width = other.width;
 		height = other.height;
 	}
-	Array2D(Array2D<T>&& other) noexcept {
+	Array2D(Array2D<T, Layout>&& other) noexcept {
 		data = std::move(other.data);
 		width = other.width;
 		height = other.height;
 	}
-	Array2D<T> operator=(const Array2D<T>& other) {
+	Array2D<T, Layout> operator=(const Array2D<T, Layout>& other) {
 		data = other.data;
 		width = other.width;
 		height = other.height;
@@ -36,7 +40,7 @@ public:
 			throw std::out_of_range("2D Array index out of bounds.");
 		}
 #endif
-		return data[((y * width) + x)];
+		return data[Layout::index2D(x, y, width, height)];
 	}
 
 	T operator()(int x, int y) const {
@@ -45,21 +49,115 @@ public:
 			throw std::out_of_range("2D Array index out of bounds.");
 		}
 #endif
-		return data[((y * width) + x)];
+		return data[Layout::index2D(x, y, width, height)];
 	}
 
-	void fill(T p_fillValue) {
-		for (size_t i = 0; i < width * height; i++) {
-			data[i] = p_fillValue;
+	// The bulk operations below take an optional pool to split big arrays across, see ArrayOps.
+	void fill(T p_fillValue, ThreadPool* p_pool = nullptr) {
+		if constexpr (std::is_same_v<T, bool>) {
+			std::fill(data.begin(), data.end(), p_fillValue);
+		}
+		else {
+			ArrayOps::fill(data.data(), data.size(), p_fillValue, p_pool);
+		}
+	}
+	// Replaces every cell with p_fn(const T&).
+	template<typename F>
+	void transform(F&& p_fn, ThreadPool* p_pool = nullptr) {
+		ArrayOps::transform(data.data(), data.size(), std::forward<F>(p_fn), p_pool);
+	}
+	// Reductions only look at real cells, never the padding a tiled layout adds. Those layouts also don't get the SIMD paths.
+	template<typename F>
+	T reduce(T p_init, F&& p_fn, ThreadPool* p_pool = nullptr) const {
+		if constexpr (std::is_same_v<Layout, RowMajorLayout>) {
+			return ArrayOps::reduce(data.data(), data.size(), p_init, std::forward<F>(p_fn), p_pool);
+		}
+		else {
+			T acc = p_init;
+			Layout::forEachIndex2D(width, height, [&](size_t, size_t, size_t p_index) { acc = p_fn(std::move(acc), data[p_index]); });
+			return acc;
+		}
+	}
+	T min(ThreadPool* p_pool = nullptr) const {
+		if constexpr (std::is_same_v<Layout, RowMajorLayout>) return ArrayOps::min(data.data(), data.size(), p_pool);
+		else return data.empty() ? T() : reduce((*this)(0, 0), [](const T& a, const T& b) { return b < a ? b : a; });
+	}
+	T max(ThreadPool* p_pool = nullptr) const {
+		if constexpr (std::is_same_v<Layout, RowMajorLayout>) return ArrayOps::max(data.data(), data.size(), p_pool);
+		else return data.empty() ? T() : reduce((*this)(0, 0), [](const T& a, const T& b) { return a < b ? b : a; });
+	}
+	ArraySumType<T> sum(ThreadPool* p_pool = nullptr) const {
+		if constexpr (std::is_same_v<Layout, RowMajorLayout>) {
+			return ArrayOps::sum(data.data(), data.size(), p_pool);
+		}
+		else {
+			ArraySumType<T> acc = ArraySumType<T>();
+			Layout::forEachIndex2D(width, height, [&](size_t, size_t, size_t p_index) { acc += ArraySumType<T>(data[p_index]); });
+			return acc;
+		}
+	}
+	template<typename Pred>
+	size_t countIf(Pred&& p_pred, ThreadPool* p_pool = nullptr) const {
+		if constexpr (std::is_same_v<Layout, RowMajorLayout>) {
+			return ArrayOps::countIf(data.data(), data.size(), std::forward<Pred>(p_pred), p_pool);
+		}
+		else {
+			size_t count = 0;
+			Layout::forEachIndex2D(width, height, [&](size_t, size_t, size_t p_index) { count += p_pred(data[p_index]) ? 1 : 0; });
+			return count;
+		}
+	}
+	// Copies the p_width x p_height block at (p_srcX, p_srcY) in p_src to (p_dstX, p_dstY) here.
+	// Whatever hangs off the edge of either array is clipped. p_src can't be this array.
+	template<class SrcLayout>
+	void copyRegion(const Array2D<T, SrcLayout>& p_src, size_t p_srcX, size_t p_srcY, size_t p_width, size_t p_height, size_t p_dstX, size_t p_dstY, ThreadPool* p_pool = nullptr) {
+		if (p_srcX >= p_src.width || p_srcY >= p_src.height || p_dstX >= width || p_dstY >= height) return;
+		p_width = std::min({ p_width, p_src.width - p_srcX, width - p_dstX });
+		p_height = std::min({ p_height, p_src.height - p_srcY, height - p_dstY });
+		if constexpr (std::is_same_v<Layout, RowMajorLayout> && std::is_same_v<SrcLayout, RowMajorLayout>) {
+			ArrayOps::copy2D(p_src.getData().data() + p_srcY * p_src.width + p_srcX, p_src.width, data.data() + p_dstY * width + p_dstX, width, p_width, p_height, p_pool);
+		}
+		else {
+			for (size_t y = 0; y < p_height; y++) for (size_t x = 0; x < p_width; x++) {
+				data[Layout::index2D(p_dstX + x, p_dstY + y, width, height)] = p_src(int(p_srcX + x), int(p_srcY + y));
+			}
+		}
+	}
+
+	// Calls p_fn(x, y, T&) for every cell, in memory order rather than row by row.
+	template<typename F>
+	void forEachCell(F&& p_fn) {
+		Layout::forEachIndex2D(width, height, [&](size_t x, size_t y, size_t p_index) { p_fn(x, y, data[p_index]); });
+	}
+	// Calls p_fn(T&, dx, dy) for every cell within p_radius of (x, y), the center included. Cells past the edge are skipped.
+	// When the whole neighborhood sits in one tile (or the layout is row major) it's walked with fixed strides and no index math.
+	template<typename F>
+	void forEachNeighbor(int x, int y, F&& p_fn, int p_radius = 1) {
+		size_t x0 = std::max(x - p_radius, 0), y0 = std::max(y - p_radius, 0);
+		size_t x1 = std::min<size_t>(x + p_radius, width - 1), y1 = std::min<size_t>(y + p_radius, height - 1);
+		size_t base, strideY;
+		if (Layout::stridedBlock2D(x0, y0, x1, y1, width, height, base, strideY)) {
+			for (size_t ny = y0; ny <= y1; ny++) {
+				T* row = &data[base + (ny - y0) * strideY];
+				for (size_t nx = x0; nx <= x1; nx++) p_fn(row[nx - x0], int(nx) - x, int(ny) - y);
+			}
+			return;
+		}
+		for (size_t ny = y0; ny <= y1; ny++) for (size_t nx = x0; nx <= x1; nx++) {
+			p_fn(data[Layout::index2D(nx, ny, width, height)], int(nx) - x, int(ny) - y);
 		}
 	}
 	std::vector<T>& getData() {
 		return data;
 	}
+	const std::vector<T>& getData() const {
+		return data;
+	}
 
 	// a somewhat unsafe operation
 	// scratch that, super unsafe lol
 	void setData(T* p_data) {
+		static_assert(std::is_same_v<Layout, RowMajorLayout>, "setData expects row major data");
 		data.assign(p_data, p_data + width * height);
 	}
 
@@ -67,14 +165,16 @@ public:
 		if (x >= 0 && x < width && y >= 0 && y < height) return true;
 		return false;
 	}
+	// With a tiled layout cells don't keep their coordinates through a resize, only row major does for changes in height.
 	void resize(uint32_t p_width, uint32_t p_height) {
-		data.resize(p_width * p_height, T());
+		data.resize(Layout::storageSize2D(p_width, p_height), T());
 
 		width = p_width;
 		height = p_height;
 	}
 
 	void append(T* p_data, size_t p_size) {
+		static_assert(std::is_same_v<Layout, RowMajorLayout>, "append only works on row major arrays");
 		if (p_size == 0) return;
 		if (p_size % width != 0) {
 			ERROR_LOG("Tried to append data of invalid size to existing 2d array. Make sure the width of what you're appending matches the destination.");
@@ -85,6 +185,7 @@ public:
 		height += p_size / width;
 	}
 	void prepend(T* p_data, size_t p_size) {
+		static_assert(std::is_same_v<Layout, RowMajorLayout>, "prepend only works on row major arrays");
 		if (p_size == 0) return;
 		if (p_size % width != 0) {
 			ERROR_LOG("Tried to prepend data of invalid size to existing 2d array. Make sure the width of what you're prepending matches the destination.");
@@ -103,7 +204,7 @@ public:
 		data.reserve(p_amt);
 	}
 	void reserve(size_t p_width, size_t p_height) {
-		data.reserve(p_width * p_height);
+		data.reserve(Layout::storageSize2D(p_width, p_height));
 		width = p_width;
 		height = p_height;
 	}
@@ -5,30 +5,34 @@
 #include <vector>
 #include "Framework/Log.hpp"
 #include <algorithm>
-template<class T>
+#include <type_traits>
+#include "ArrayLayout.hpp"
+#include "ArrayOps.hpp"
+template<class T, class Layout = RowMajorLayout>
 // fake baby 3d array
+// Layout decides how cells sit in memory, see ArrayLayout.hpp. Anything but row major pads the storage out to whole tiles.
 class Array3D {
 public:
 	Array3D() { width = 0; height = 0; depth = 0; data = std::vector<T>(); }
 	Array3D(uint32_t p_width, uint32_t p_height, uint32_t p_depth) {
-		data.resize(p_width * p_height * p_depth, T());
+		data.resize(Layout::storageSize3D(p_width, p_height, p_depth), T());
 		width = p_width;
 		height = p_height;
 		depth = p_depth;
 	}
-	Array3D(const Array3D<T>& other) {
+	Array3D(const Array3D<T, Layout>& other) {
 		data = other.data;
 		width = other.width;
 		height = other.height;
 		depth = other.depth;
 	}
-	Array3D(Array3D<T>&& other) noexcept {
+	Array3D(Array3D<T, Layout>&& other) noexcept {
 		data = std::move(other.data);
 		width = other.width;
 		height = other.height;
 		depth = other.depth;
 	}
-	Array3D<T> operator=(const Array3D<T>& other) {
+	Array3D<T, Layout> operator=(const Array3D<T, Layout>& other) {
 		data = other.data;
 		width = other.width;
 		height = other.height;
@@ -43,9 +47,9 @@ public:
 		}
 #endif
 		if (!invertDepth) {
-			return data[(z * width * height) + ((y * width) + x)];
+			return data[Layout::index3D(x, y, z, width, height, depth)];
 		} else {
-			return data[((depth - 1 - z) * width * height) + ((y * width) + x)];
+			return data[Layout::index3D(x, y, depth - 1 - z, width, height, depth)];
 		}
 
 	}
@@ -56,28 +60,138 @@ public:
 		}
 #endif
 		if (!invertDepth) {
-			return data[((size_t)z * width * height) + (((size_t)y * width) + (size_t)x)];
+			return data[Layout::index3D((size_t)x, (size_t)y, (size_t)z, width, height, depth)];
 		}
 		else {
-			return data[((depth - 1 - (size_t)z) * width * height) + (((size_t)y * width) + (size_t)x)];
+			return data[Layout::index3D((size_t)x, (size_t)y, depth - 1 - (size_t)z, width, height, depth)];
 		}
 
 	}
-	void fill(T p_fillValue) {
-		for (size_t i = 0; i < width * height * depth; i++) {
-			data[i] = p_fillValue;
+	// Where (x, y, z) lives in getData(), with invertDepth applied.
+	size_t storageIndex(size_t x, size_t y, size_t z) const {
+		return Layout::index3D(x, y, invertDepth ? depth - 1 - z : z, width, height, depth);
+	}
+
+	// The bulk operations below take an optional pool to split big arrays across, see ArrayOps.
+	void fill(T p_fillValue, ThreadPool* p_pool = nullptr) {
+		if constexpr (std::is_same_v<T, bool>) {
+			std::fill(data.begin(), data.end(), p_fillValue);
+		}
+		else {
+			ArrayOps::fill(data.data(), data.size(), p_fillValue, p_pool);
+		}
+	}
+	// Replaces every cell with p_fn(const T&).
+	template<typename F>
+	void transform(F&& p_fn, ThreadPool* p_pool = nullptr) {
+		ArrayOps::transform(data.data(), data.size(), std::forward<F>(p_fn), p_pool);
+	}
+	// Reductions only look at real cells, never the padding a tiled layout adds. Those layouts also don't get the SIMD paths.
+	template<typename F>
+	T reduce(T p_init, F&& p_fn, ThreadPool* p_pool = nullptr) const {
+		if constexpr (std::is_same_v<Layout, RowMajorLayout>) {
+			return ArrayOps::reduce(data.data(), data.size(), p_init, std::forward<F>(p_fn), p_pool);
+		}
+		else {
+			T acc = p_init;
+			Layout::forEachIndex3D(width, height, depth, [&](size_t, size_t, size_t, size_t p_index) { acc = p_fn(std::move(acc), data[p_index]); });
+			return acc;
+		}
+	}
+	T min(ThreadPool* p_pool = nullptr) const {
+		if constexpr (std::is_same_v<Layout, RowMajorLayout>) return ArrayOps::min(data.data(), data.size(), p_pool);
+		else return data.empty() ? T() : reduce(data[0], [](const T& a, const T& b) { return b < a ? b : a; });
+	}
+	T max(ThreadPool* p_pool = nullptr) const {
+		if constexpr (std::is_same_v<Layout, RowMajorLayout>) return ArrayOps::max(data.data(), data.size(), p_pool);
+		else return data.empty() ? T() : reduce(data[0], [](const T& a, const T& b) { return a < b ? b : a; });
+	}
+	ArraySumType<T> sum(ThreadPool* p_pool = nullptr) const {
+		if constexpr (std::is_same_v<Layout, RowMajorLayout>) {
+			return ArrayOps::sum(data.data(), data.size(), p_pool);
+		}
+		else {
+			ArraySumType<T> acc = ArraySumType<T>();
+			Layout::forEachIndex3D(width, height, depth, [&](size_t, size_t, size_t, size_t p_index) { acc += ArraySumType<T>(data[p_index]); });
+			return acc;
+		}
+	}
+	template<typename Pred>
+	size_t countIf(Pred&& p_pred, ThreadPool* p_pool = nullptr) const {
+		if constexpr (std::is_same_v<Layout, RowMajorLayout>) {
+			return ArrayOps::countIf(data.data(), data.size(), std::forward<Pred>(p_pred), p_pool);
+		}
+		else {
+			size_t count = 0;
+			Layout::forEachIndex3D(width, height, depth, [&](size_t, size_t, size_t, size_t p_index) { count += p_pred(data[p_index]) ? 1 : 0; });
+			return count;
+		}
+	}
+	// Copies the p_width x p_height x p_depth box at (p_srcX, p_srcY, p_srcZ) in p_src to (p_dstX, p_dstY, p_dstZ) here.
+	// Whatever hangs off the edge of either array is clipped. p_src can't be this array. Both sides respect invertDepth.
+	template<class SrcLayout>
+	void copyRegion(const Array3D<T, SrcLayout>& p_src, size_t p_srcX, size_t p_srcY, size_t p_srcZ, size_t p_width, size_t p_height, size_t p_depth,
+		size_t p_dstX, size_t p_dstY, size_t p_dstZ, ThreadPool* p_pool = nullptr) {
+		if (p_srcX >= p_src.width || p_srcY >= p_src.height || p_srcZ >= p_src.depth || p_dstX >= width || p_dstY >= height || p_dstZ >= depth) return;
+		p_width = std::min({ p_width, p_src.width - p_srcX, width - p_dstX });
+		p_height = std::min({ p_height, p_src.height - p_srcY, height - p_dstY });
+		p_depth = std::min({ p_depth, p_src.depth - p_srcZ, depth - p_dstZ });
+		const std::vector<T>& srcData = p_src.getData();
+		if constexpr (std::is_same_v<Layout, RowMajorLayout> && std::is_same_v<SrcLayout, RowMajorLayout>) {
+			// rows inside a slice are contiguous either way, invertDepth only moves whole slices around
+			for (size_t z = 0; z < p_depth; z++) {
+				ArrayOps::copy2D(srcData.data() + p_src.storageIndex(p_srcX, p_srcY, p_srcZ + z), p_src.width,
+					data.data() + storageIndex(p_dstX, p_dstY, p_dstZ + z), width, p_width, p_height, p_pool);
+			}
+		}
+		else {
+			for (size_t z = 0; z < p_depth; z++) for (size_t y = 0; y < p_height; y++) for (size_t x = 0; x < p_width; x++) {
+				data[storageIndex(p_dstX + x, p_dstY + y, p_dstZ + z)] = srcData[p_src.storageIndex(p_srcX + x, p_srcY + y, p_srcZ + z)];
+			}
+		}
+	}
+
+	// Calls p_fn(x, y, z, T&) for every cell, in memory order rather than row by row.
+	// A sweep that reads neighbors should go through this, so it stays inside one tile for as long as it can.
+	template<typename F>
+	void forEachCell(F&& p_fn) {
+		Layout::forEachIndex3D(width, height, depth, [&](size_t x, size_t y, size_t z, size_t p_index) {
+			p_fn(x, y, invertDepth ? depth - 1 - z : z, data[p_index]);
+		});
+	}
+	// Calls p_fn(T&, dx, dy, dz) for every cell within p_radius of (x, y, z), the center included. Cells past the edge are skipped.
+	// When the whole neighborhood sits in one tile (or the layout is row major) it's walked with fixed strides and no index math.
+	template<typename F>
+	void forEachNeighbor(int x, int y, int z, F&& p_fn, int p_radius = 1) {
+		int storageZ = invertDepth ? int(depth) - 1 - z : z;
+		int flipZ = invertDepth ? -1 : 1;
+		size_t x0 = std::max(x - p_radius, 0), y0 = std::max(y - p_radius, 0), z0 = std::max(storageZ - p_radius, 0);
+		size_t x1 = std::min<size_t>(x + p_radius, width - 1), y1 = std::min<size_t>(y + p_radius, height - 1), z1 = std::min<size_t>(storageZ + p_radius, depth - 1);
+		size_t base, strideY, strideZ;
+		if (Layout::stridedBlock3D(x0, y0, z0, x1, y1, z1, width, height, depth, base, strideY, strideZ)) {
+			for (size_t nz = z0; nz <= z1; nz++) for (size_t ny = y0; ny <= y1; ny++) {
+				T* row = &data[base + (nz - z0) * strideZ + (ny - y0) * strideY];
+				for (size_t nx = x0; nx <= x1; nx++) p_fn(row[nx - x0], int(nx) - x, int(ny) - y, (int(nz) - storageZ) * flipZ);
+			}
+			return;
+		}
+		for (size_t nz = z0; nz <= z1; nz++) for (size_t ny = y0; ny <= y1; ny++) for (size_t nx = x0; nx <= x1; nx++) {
+			p_fn(data[Layout::index3D(nx, ny, nz, width, height, depth)], int(nx) - x, int(ny) - y, (int(nz) - storageZ) * flipZ);
 		}
 	}
 	std::vector<T>& getData() {
 		return data;
 	}
+	const std::vector<T>& getData() const {
+		return data;
+	}
 
 	bool bounded(int x, int y, int z) {
 		if (x >= 0 && x < width && y >= 0 && y < height && z >= 0 && z < depth) return true;
 		return false;
 	}
 	void resize(uint32_t p_width, uint32_t p_height, uint32_t p_depth) {
-		data.resize(p_width * p_height * p_depth, T());
+		data.resize(Layout::storageSize3D(p_width, p_height, p_depth), T());
 		width = p_width;
 		height = p_height;
 		depth = p_depth;
@@ -91,7 +205,7 @@ public:
 		data.reserve(p_amt);
 	}
 	void reserve(uint32_t p_width, uint32_t p_height, uint32_t p_depth) {
-		data.reserve(p_width * p_height * p_depth);
+		data.reserve(Layout::storageSize3D(p_width, p_height, p_depth));
 		width = p_width;
 		height = p_height;
 		depth = p_depth;
@@ -0,0 +1,274 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <algorithm>
+#if defined(__BMI2__) || (defined(_MSC_VER) && defined(__AVX2__))
+#include <immintrin.h>
+#define DERG_MORTON_BMI2 1
+#endif
+
+// Memory layouts for Array2D and Array3D, picked with their second template parameter.
+// Row major is the default and what everything expected before. The other two keep cells that are close together in
+// every direction close together in memory too, so stepping in y or z doesn't land on a new cache line every time.
+// Both of those pad the array up to whole tiles, so getData() is bigger than width * height and in layout order.
+//
+// Every layout gives:
+//  storageSize2D/3D - how many elements the backing vector needs
+//  index2D/3D - where a cell lives
+//  stridedBlock2D/3D - whether a block of cells can be reached as base + x + y * strideY + z * strideZ
+//  forEachIndex2D/3D - walks every cell in memory order, calling p_fn(x, y, (z,) index)
+
+// Z-order encoding. Interleaves the bits of each coordinate, x lowest.
+// Uses pdep/pext when the compiler is allowed BMI2 (-mbmi2, or /arch:AVX2 on MSVC), magic bit tricks otherwise.
+// 2D takes 16 bits per coordinate, 3D takes 10.
+struct Morton {
+	static uint32_t encode2D(uint32_t x, uint32_t y) {
+#ifdef DERG_MORTON_BMI2
+		return _pdep_u32(x, 0x55555555u) | _pdep_u32(y, 0xAAAAAAAAu);
+#else
+		return spread1(x) | (spread1(y) << 1);
+#endif
+	}
+	static void decode2D(uint32_t p_code, uint32_t& x, uint32_t& y) {
+#ifdef DERG_MORTON_BMI2
+		x = _pext_u32(p_code, 0x55555555u);
+		y = _pext_u32(p_code, 0xAAAAAAAAu);
+#else
+		x = compact1(p_code);
+		y = compact1(p_code >> 1);
+#endif
+	}
+	static uint32_t encode3D(uint32_t x, uint32_t y, uint32_t z) {
+#ifdef DERG_MORTON_BMI2
+		return _pdep_u32(x, 0x09249249u) | _pdep_u32(y, 0x12492492u) | _pdep_u32(z, 0x24924924u);
+#else
+		return spread2(x) | (spread2(y) << 1) | (spread2(z) << 2);
+#endif
+	}
+	static void decode3D(uint32_t p_code, uint32_t& x, uint32_t& y, uint32_t& z) {
+#ifdef DERG_MORTON_BMI2
+		x = _pext_u32(p_code, 0x09249249u);
+		y = _pext_u32(p_code, 0x12492492u);
+		z = _pext_u32(p_code, 0x24924924u);
+#else
+		x = compact2(p_code);
+		y = compact2(p_code >> 1);
+		z = compact2(p_code >> 2);
+#endif
+	}
+
+	// puts a 0 between each of the low 16 bits
+	static uint32_t spread1(uint32_t p_value) {
+		p_value &= 0x0000FFFF;
+		p_value = (p_value | (p_value << 8)) & 0x00FF00FF;
+		p_value = (p_value | (p_value << 4)) & 0x0F0F0F0F;
+		p_value = (p_value | (p_value << 2)) & 0x33333333;
+		p_value = (p_value | (p_value << 1)) & 0x55555555;
+		return p_value;
+	}
+	static uint32_t compact1(uint32_t p_value) {
+		p_value &= 0x55555555;
+		p_value = (p_value | (p_value >> 1)) & 0x33333333;
+		p_value = (p_value | (p_value >> 2)) & 0x0F0F0F0F;
+		p_value = (p_value | (p_value >> 4)) & 0x00FF00FF;
+		p_value = (p_value | (p_value >> 8)) & 0x0000FFFF;
+		return p_value;
+	}
+	// puts two 0s between each of the low 10 bits
+	static uint32_t spread2(uint32_t p_value) {
+		p_value &= 0x000003FF;
+		p_value = (p_value | (p_value << 16)) & 0x030000FF;
+		p_value = (p_value | (p_value << 8)) & 0x0300F00F;
+		p_value = (p_value | (p_value << 4)) & 0x030C30C3;
+		p_value = (p_value | (p_value << 2)) & 0x09249249;
+		return p_value;
+	}
+	static uint32_t compact2(uint32_t p_value) {
+		p_value &= 0x09249249;
+		p_value = (p_value | (p_value >> 2)) & 0x030C30C3;
+		p_value = (p_value | (p_value >> 4)) & 0x0300F00F;
+		p_value = (p_value | (p_value >> 8)) & 0xFF0000FF;
+		p_value = (p_value | (p_value >> 16)) & 0x000003FF;
+		return p_value;
+	}
+};
+
+// Plain x fastest, then y, then z.
+struct RowMajorLayout {
+	static size_t storageSize2D(size_t p_width, size_t p_height) {
+		return p_width * p_height;
+	}
+	static size_t index2D(size_t x, size_t y, size_t p_width, size_t /*p_height*/) {
+		return (y * p_width) + x;
+	}
+	static size_t storageSize3D(size_t p_width, size_t p_height, size_t p_depth) {
+		return p_width * p_height * p_depth;
+	}
+	static size_t index3D(size_t x, size_t y, size_t z, size_t p_width, size_t p_height, size_t /*p_depth*/) {
+		return (z * p_width * p_height) + (y * p_width) + x;
+	}
+
+	// block corners are inclusive and must be inside the array
+	static bool stridedBlock2D(size_t x0, size_t y0, size_t /*x1*/, size_t /*y1*/, size_t p_width, size_t p_height, size_t& o_base, size_t& o_strideY) {
+		o_base = index2D(x0, y0, p_width, p_height);
+		o_strideY = p_width;
+		return true;
+	}
+	static bool stridedBlock3D(size_t x0, size_t y0, size_t z0, size_t /*x1*/, size_t /*y1*/, size_t /*z1*/, size_t p_width, size_t p_height, size_t p_depth,
+		size_t& o_base, size_t& o_strideY, size_t& o_strideZ) {
+		o_base = index3D(x0, y0, z0, p_width, p_height, p_depth);
+		o_strideY = p_width;
+		o_strideZ = p_width * p_height;
+		return true;
+	}
+
+	template<typename F>
+	static void forEachIndex2D(size_t p_width, size_t p_height, F&& p_fn) {
+		size_t index = 0;
+		for (size_t y = 0; y < p_height; y++) for (size_t x = 0; x < p_width; x++) p_fn(x, y, index++);
+	}
+	template<typename F>
+	static void forEachIndex3D(size_t p_width, size_t p_height, size_t p_depth, F&& p_fn) {
+		size_t index = 0;
+		for (size_t z = 0; z < p_depth; z++) for (size_t y = 0; y < p_height; y++) for (size_t x = 0; x < p_width; x++) p_fn(x, y, z, index++);
+	}
+};
+
+template<uint32_t N = 8>
+// Cuts the array into N x N (x N) tiles, row major inside each tile and tiles row major after each other.
+// Dimensions get padded up to a multiple of N. N has to be a power of two so the tile math is all shifts and masks.
+struct TiledLayout {
+	static_assert(N > 0 && (N & (N - 1)) == 0, "Tile size has to be a power of two");
+	static constexpr size_t TILE_SIZE = N;
+	static constexpr size_t TILE_AREA = size_t(N) * N;
+	static constexpr size_t TILE_VOLUME = TILE_AREA * N;
+
+	static size_t tileCount(size_t p_length) {
+		return (p_length + N - 1) / N;
+	}
+
+	static size_t storageSize2D(size_t p_width, size_t p_height) {
+		return tileCount(p_width) * tileCount(p_height) * TILE_AREA;
+	}
+	static size_t index2D(size_t x, size_t y, size_t p_width, size_t /*p_height*/) {
+		size_t tile = (y / N) * tileCount(p_width) + (x / N);
+		return tile * TILE_AREA + (y % N) * N + (x % N);
+	}
+	static size_t storageSize3D(size_t p_width, size_t p_height, size_t p_depth) {
+		return tileCount(p_width) * tileCount(p_height) * tileCount(p_depth) * TILE_VOLUME;
+	}
+	static size_t index3D(size_t x, size_t y, size_t z, size_t p_width, size_t p_height, size_t /*p_depth*/) {
+		size_t tile = ((z / N) * tileCount(p_height) + (y / N)) * tileCount(p_width) + (x / N);
+		return tile * TILE_VOLUME + ((z % N) * N + (y % N)) * N + (x % N);
+	}
+
+	// only strided if the whole block sits in one tile
+	static bool stridedBlock2D(size_t x0, size_t y0, size_t x1, size_t y1, size_t p_width, size_t p_height, size_t& o_base, size_t& o_strideY) {
+		if (x0 / N != x1 / N || y0 / N != y1 / N) return false;
+		o_base = index2D(x0, y0, p_width, p_height);
+		o_strideY = N;
+		return true;
+	}
+	static bool stridedBlock3D(size_t x0, size_t y0, size_t z0, size_t x1, size_t y1, size_t z1, size_t p_width, size_t p_height, size_t p_depth,
+		size_t& o_base, size_t& o_strideY, size_t& o_strideZ) {
+		if (x0 / N != x1 / N || y0 / N != y1 / N || z0 / N != z1 / N) return false;
+		o_base = index3D(x0, y0, z0, p_width, p_height, p_depth);
+		o_strideY = N;
+		o_strideZ = TILE_AREA;
+		return true;
+	}
+
+	template<typename F>
+	static void forEachIndex2D(size_t p_width, size_t p_height, F&& p_fn) {
+		size_t tile = 0;
+		for (size_t ty = 0; ty < p_height; ty += N) for (size_t tx = 0; tx < p_width; tx += N) {
+			size_t endX = std::min<size_t>(N, p_width - tx), endY = std::min<size_t>(N, p_height - ty);
+			for (size_t y = 0; y < endY; y++) for (size_t x = 0; x < endX; x++) {
+				p_fn(tx + x, ty + y, tile * TILE_AREA + y * N + x);
+			}
+			tile++;
+		}
+	}
+	template<typename F>
+	static void forEachIndex3D(size_t p_width, size_t p_height, size_t p_depth, F&& p_fn) {
+		size_t tile = 0;
+		for (size_t tz = 0; tz < p_depth; tz += N) for (size_t ty = 0; ty < p_height; ty += N) for (size_t tx = 0; tx < p_width; tx += N) {
+			size_t endX = std::min<size_t>(N, p_width - tx), endY = std::min<size_t>(N, p_height - ty), endZ = std::min<size_t>(N, p_depth - tz);
+			for (size_t z = 0; z < endZ; z++) for (size_t y = 0; y < endY; y++) for (size_t x = 0; x < endX; x++) {
+				p_fn(tx + x, ty + y, tz + z, tile * TILE_VOLUME + (z * N + y) * N + x);
+			}
+			tile++;
+		}
+	}
+};
+
+template<uint32_t BrickBits = 5>
+// Z-order inside (1 << BrickBits) sized bricks, bricks row major after each other.
+// Plain Z-order over the whole array would have to pad every side up to the biggest power of two, which for a wide flat
+// grid is a huge waste, so bricks keep the padding down to a multiple of the brick size like TiledLayout.
+// For a square power of two array with a brick as big as the array, this is Z-order over the whole thing.
+// Neighbors aren't at a fixed stride in Z-order, so stridedBlock always says no and neighbor walks encode each cell.
+struct MortonLayout {
+	static_assert(BrickBits > 0 && BrickBits <= 10, "Morton bricks are limited to 10 bits per side, so 3D codes fit in 32 bits");
+	static constexpr size_t TILE_SIZE = size_t(1) << BrickBits;
+	static constexpr size_t TILE_AREA = TILE_SIZE * TILE_SIZE;
+	static constexpr size_t TILE_VOLUME = TILE_AREA * TILE_SIZE;
+	static constexpr uint32_t BRICK_MASK = uint32_t(TILE_SIZE - 1);
+
+	static size_t tileCount(size_t p_length) {
+		return (p_length + TILE_SIZE - 1) >> BrickBits;
+	}
+
+	static size_t storageSize2D(size_t p_width, size_t p_height) {
+		return tileCount(p_width) * tileCount(p_height) * TILE_AREA;
+	}
+	static size_t index2D(size_t x, size_t y, size_t p_width, size_t /*p_height*/) {
+		size_t tile = (y >> BrickBits) * tileCount(p_width) + (x >> BrickBits);
+		return tile * TILE_AREA + Morton::encode2D(uint32_t(x) & BRICK_MASK, uint32_t(y) & BRICK_MASK);
+	}
+	static size_t storageSize3D(size_t p_width, size_t p_height, size_t p_depth) {
+		return tileCount(p_width) * tileCount(p_height) * tileCount(p_depth) * TILE_VOLUME;
+	}
+	static size_t index3D(size_t x, size_t y, size_t z, size_t p_width, size_t p_height, size_t /*p_depth*/) {
+		size_t tile = ((z >> BrickBits) * tileCount(p_height) + (y >> BrickBits)) * tileCount(p_width) + (x >> BrickBits);
+		return tile * TILE_VOLUME + Morton::encode3D(uint32_t(x) & BRICK_MASK, uint32_t(y) & BRICK_MASK, uint32_t(z) & BRICK_MASK);
+	}
+
+	static bool stridedBlock2D(size_t /*x0*/, size_t /*y0*/, size_t /*x1*/, size_t /*y1*/, size_t /*p_width*/, size_t /*p_height*/, size_t& /*o_base*/, size_t& /*o_strideY*/) {
+		return false;
+	}
+	static bool stridedBlock3D(size_t /*x0*/, size_t /*y0*/, size_t /*z0*/, size_t /*x1*/, size_t /*y1*/, size_t /*z1*/, size_t /*p_width*/, size_t /*p_height*/, size_t /*p_depth*/,
+		size_t& /*o_base*/, size_t& /*o_strideY*/, size_t& /*o_strideZ*/) {
+		return false;
+	}
+
+	// Cells in the padding past the edge of the array get skipped.
+	template<typename F>
+	static void forEachIndex2D(size_t p_width, size_t p_height, F&& p_fn) {
+		size_t tile = 0;
+		for (size_t ty = 0; ty < p_height; ty += TILE_SIZE) for (size_t tx = 0; tx < p_width; tx += TILE_SIZE) {
+			bool partial = tx + TILE_SIZE > p_width || ty + TILE_SIZE > p_height;
+			for (uint32_t code = 0; code < TILE_AREA; code++) {
+				uint32_t x, y;
+				Morton::decode2D(code, x, y);
+				if (partial && (tx + x >= p_width || ty + y >= p_height)) continue;
+				p_fn(tx + x, ty + y, tile * TILE_AREA + code);
+			}
+			tile++;
+		}
+	}
+	template<typename F>
+	static void forEachIndex3D(size_t p_width, size_t p_height, size_t p_depth, F&& p_fn) {
+		size_t tile = 0;
+		for (size_t tz = 0; tz < p_depth; tz += TILE_SIZE) for (size_t ty = 0; ty < p_height; ty += TILE_SIZE) for (size_t tx = 0; tx < p_width; tx += TILE_SIZE) {
+			bool partial = tx + TILE_SIZE > p_width || ty + TILE_SIZE > p_height || tz + TILE_SIZE > p_depth;
+			for (uint32_t code = 0; code < TILE_VOLUME; code++) {
+				uint32_t x, y, z;
+				Morton::decode3D(code, x, y, z);
+				if (partial && (tx + x >= p_width || ty + y >= p_height || tz + z >= p_depth)) continue;
+				p_fn(tx + x, ty + y, tz + z, tile * TILE_VOLUME + code);
+			}
+			tile++;
+		}
+	}
+};
@@ -0,0 +1,496 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include "Threadpool.hpp"
+#include "Framework/Log.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define DERG_SIMD_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+// MSVC lets any function use AVX2 intrinsics
+#define DERG_TARGET_AVX2
+#else
+#define DERG_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define DERG_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+enum class SimdLevel {
+	SCALAR,
+	SSE2,
+	AVX2,
+	NEON
+};
+
+// What sum() hands back, wide enough that adding up a big grid doesn't overflow or lose all its precision.
+template<typename T>
+using ArraySumType = std::conditional_t<std::is_floating_point_v<T>, double,
+	std::conditional_t<std::is_integral_v<T>, std::conditional_t<std::is_signed_v<T>, int64_t, uint64_t>, T>>;
+
+// Bulk operations over plain runs of elements, used by Array2D, Array3D and StaticArray2D.
+// fill, min, max and sum have hand written SSE2/AVX2/NEON paths for the element types that show up in grids
+// (float, int32_t and uint8_t, and fill works on anything trivially copyable that's 1, 2, 4 or 8 bytes).
+// The instruction set is picked at runtime, so the same build runs on machines without AVX2.
+// transform, countIf and reduce take arbitrary callables, so they're plain loops written so the compiler can vectorize them.
+// Passing a ThreadPool splits anything over PARALLEL_MIN_BYTES across it, smaller runs aren't worth the handoff.
+struct ArrayOps {
+	static constexpr size_t PARALLEL_MIN_BYTES = size_t(1) << 20;
+	// bytes per pool task
+	static constexpr size_t PARALLEL_GRAIN_BYTES = size_t(256) << 10;
+	// fills bigger than this skip the cache, since the start would be evicted by the end anyway
+	static constexpr size_t STREAMING_FILL_BYTES = size_t(8) << 20;
+
+	static SimdLevel detectedSimdLevel() {
+		static const SimdLevel level = detect();
+		return level;
+	}
+	static SimdLevel simdLevel() {
+		return (SimdLevel)activeLevel().load(std::memory_order_relaxed);
+	}
+	// Drops to a lower level, mostly for checking a SIMD path against the scalar one. Can't go above what the CPU has.
+	static void setSimdLevel(SimdLevel p_level) {
+		SimdLevel detected = detectedSimdLevel();
+		bool supported = p_level == SimdLevel::SCALAR || p_level == detected || (p_level == SimdLevel::SSE2 && detected == SimdLevel::AVX2);
+		if (!supported) {
+			WARNING_LOG("Tried to use a SIMD level this CPU doesn't support, ignoring it.");
+			return;
+		}
+		activeLevel().store((int)p_level, std::memory_order_relaxed);
+	}
+
+	template<typename T>
+	static void fill(T* p_data, size_t p_count, const T& p_value, ThreadPool* p_pool = nullptr) {
+		bool streaming = p_count * sizeof(T) >= STREAMING_FILL_BYTES;
+		forChunks<T>(p_pool, p_count, [&](size_t p_begin, size_t p_end) {
+			fillSpan(p_data + p_begin, p_end - p_begin, p_value, streaming);
+		});
+	}
+	// p_data[i] = p_fn(p_data[i]) for every element.
+	template<typename T, typename F>
+	static void transform(T* p_data, size_t p_count, F&& p_fn, ThreadPool* p_pool = nullptr) {
+		forChunks<T>(p_pool, p_count, [&](size_t p_begin, size_t p_end) {
+			for (size_t i = p_begin; i < p_end; i++) p_data[i] = p_fn(p_data[i]);
+		});
+	}
+	template<typename T, typename Pred>
+	static size_t countIf(const T* p_data, size_t p_count, Pred&& p_pred, ThreadPool* p_pool = nullptr) {
+		return reduceChunks<T, size_t>(p_pool, p_count, 0, [&](size_t p_begin, size_t p_end) {
+			size_t count = 0;
+			// no branch, so it vectorizes when the predicate is simple
+			for (size_t i = p_begin; i < p_end; i++) count += p_pred(p_data[i]) ? 1 : 0;
+			return count;
+		}, [](size_t a, size_t b) { return a + b; });
+	}
+	// Folds every element into p_init with p_fn(T, const T&), in order. p_init goes in exactly once, pool or not, so it
+	// doesn't have to be an identity. With a pool the chunks are folded separately and then combined in order, so p_fn
+	// should be associative.
+	template<typename T, typename F>
+	static T reduce(const T* p_data, size_t p_count, T p_init, F&& p_fn, ThreadPool* p_pool = nullptr) {
+		return reduceChunks<T, T>(p_pool, p_count, p_init, [&](size_t p_begin, size_t p_end) {
+			// chunks start from their own first element, p_init only gets combined in at the end
+			T acc = p_data[p_begin];
+			for (size_t i = p_begin + 1; i < p_end; i++) acc = p_fn(std::move(acc), p_data[i]);
+			return acc;
+		}, p_fn);
+	}
+
+	// min, max and sum of nothing are T().
+	// Float min and max don't promise anything about where NaNs end up.
+	template<typename T>
+	static T min(const T* p_data, size_t p_count, ThreadPool* p_pool = nullptr) {
+		if (p_count == 0) return T();
+		return reduceChunks<T, T>(p_pool, p_count, p_data[0], [&](size_t p_begin, size_t p_end) {
+			return minMaxSpan<false>(p_data + p_begin, p_end - p_begin);
+		}, [](const T& a, const T& b) { return b < a ? b : a; });
+	}
+	template<typename T>
+	static T max(const T* p_data, size_t p_count, ThreadPool* p_pool = nullptr) {
+		if (p_count == 0) return T();
+		return reduceChunks<T, T>(p_pool, p_count, p_data[0], [&](size_t p_begin, size_t p_end) {
+			return minMaxSpan<true>(p_data + p_begin, p_end - p_begin);
+		}, [](const T& a, const T& b) { return a < b ? b : a; });
+	}
+	template<typename T>
+	static ArraySumType<T> sum(const T* p_data, size_t p_count, ThreadPool* p_pool = nullptr) {
+		using S = ArraySumType<T>;
+		return reduceChunks<T, S>(p_pool, p_count, S(), [&](size_t p_begin, size_t p_end) {
+			return sumSpan(p_data + p_begin, p_end - p_begin);
+		}, [](const S& a, const S& b) { return a + b; });
+	}
+
+	// Copies a p_width x p_height block between two row major buffers. The rows can't overlap.
+	template<typename T>
+	static void copy2D(const T* p_src, size_t p_srcPitch, T* p_dst, size_t p_dstPitch, size_t p_width, size_t p_height, ThreadPool* p_pool = nullptr) {
+		if (p_width == 0 || p_height == 0) return;
+		auto copyRows = [&](size_t p_begin, size_t p_end) {
+			for (size_t y = p_begin; y < p_end; y++) std::copy_n(p_src + y * p_srcPitch, p_width, p_dst + y * p_dstPitch);
+		};
+		if (!p_pool || p_width * p_height * sizeof(T) < PARALLEL_MIN_BYTES) {
+			copyRows(0, p_height);
+			return;
+		}
+		size_t rowsPerTask = std::max<size_t>(1, PARALLEL_GRAIN_BYTES / (p_width * sizeof(T)));
+		p_pool->parallelFor(0, p_height, rowsPerTask, copyRows);
+	}
+private:
+	static SimdLevel detect() {
+#if defined(DERG_SIMD_X86)
+#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 1);
+		bool sse2 = info[3] & (1 << 26);
+		bool osxsave = info[2] & (1 << 27);
+		bool avx = info[2] & (1 << 28);
+		bool avx2 = false;
+		// the OS has to save the ymm registers too, not just the CPU support them
+		if (osxsave && avx && (_xgetbv(0) & 6) == 6) {
+			__cpuidex(info, 7, 0);
+			avx2 = info[1] & (1 << 5);
+		}
+#else
+		__builtin_cpu_init();
+		bool sse2 = __builtin_cpu_supports("sse2");
+		bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+		if (avx2) return SimdLevel::AVX2;
+		if (sse2) return SimdLevel::SSE2;
+		return SimdLevel::SCALAR;
+#elif defined(DERG_SIMD_NEON)
+		return SimdLevel::NEON;
+#else
+		return SimdLevel::SCALAR;
+#endif
+	}
+	static std::atomic<int>& activeLevel() {
+		static std::atomic<int> level{ (int)detectedSimdLevel() };
+		return level;
+	}
+
+	template<typename T, typename F>
+	static void forChunks(ThreadPool* p_pool, size_t p_count, F&& p_fn) {
+		if (!p_pool || p_count * sizeof(T) < PARALLEL_MIN_BYTES) {
+			p_fn(0, p_count);
+			return;
+		}
+		p_pool->parallelFor(0, p_count, grain<T>(), p_fn);
+	}
+	// Each chunk gets its own slot, combined in order afterwards so the result doesn't depend on scheduling.
+	// p_init is combined in once at the front, p_chunk shouldn't fold it in again itself.
+	template<typename T, typename R, typename ChunkF, typename CombineF>
+	static R reduceChunks(ThreadPool* p_pool, size_t p_count, R p_init, ChunkF&& p_chunk, CombineF&& p_combine) {
+		if (p_count == 0) return p_init;
+		if (!p_pool || p_count * sizeof(T) < PARALLEL_MIN_BYTES) return p_combine(p_init, p_chunk(0, p_count));
+		size_t chunkSize = grain<T>();
+		// p_init is only a placeholder here, every slot gets overwritten
+		std::vector<R> partials((p_count + chunkSize - 1) / chunkSize, p_init);
+		p_pool->parallelFor(0, p_count, chunkSize, [&](size_t p_begin, size_t p_end) {
+			partials[p_begin / chunkSize] = p_chunk(p_begin, p_end);
+		});
+		R out = p_init;
+		for (R& partial : partials) out = p_combine(std::move(out), std::move(partial));
+		return out;
+	}
+	template<typename T>
+	static size_t grain() {
+		return std::max<size_t>(64, PARALLEL_GRAIN_BYTES / sizeof(T));
+	}
+
+	template<typename T>
+	static constexpr bool hasSimdReduce = std::is_same_v<T, float> || std::is_same_v<T, int32_t> || std::is_same_v<T, uint8_t>;
+
+	template<typename T>
+	static void fillSpan(T* p_data, size_t p_count, const T& p_value, bool p_streaming) {
+		size_t done = 0;
+		if constexpr (std::is_trivially_copyable_v<T> && (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8)) {
+			// the value repeated across 8 bytes, so it can be splatted into a register whatever its type
+			unsigned char bytes[8];
+			for (size_t i = 0; i < 8; i += sizeof(T)) memcpy(bytes + i, &p_value, sizeof(T));
+			uint64_t pattern;
+			memcpy(&pattern, bytes, 8);
+			unsigned char* dst = reinterpret_cast<unsigned char*>(p_data);
+			switch (simdLevel()) {
+#if defined(DERG_SIMD_X86)
+			case SimdLevel::AVX2: done = fillAvx2(dst, p_count * sizeof(T), pattern, sizeof(T), p_streaming) / sizeof(T); break;
+			case SimdLevel::SSE2: done = fillSse2(dst, p_count * sizeof(T), pattern, sizeof(T), p_streaming) / sizeof(T); break;
+#elif defined(DERG_SIMD_NEON)
+			case SimdLevel::NEON: done = fillNeon(dst, p_count * sizeof(T), pattern) / sizeof(T); break;
+#endif
+			default: break;
+			}
+		}
+		std::fill(p_data + done, p_data + p_count, p_value);
+	}
+
+	template<bool Max, typename T>
+	static T minMaxSpan(const T* p_data, size_t p_count) {
+		if constexpr (hasSimdReduce<T>) {
+			switch (simdLevel()) {
+#if defined(DERG_SIMD_X86)
+			case SimdLevel::AVX2: return minMaxAvx2<Max>(p_data, p_count);
+			case SimdLevel::SSE2:
+				// SSE2 has no 32 bit integer min or max
+				if constexpr (!std::is_same_v<T, int32_t>) return minMaxSse2<Max>(p_data, p_count);
+				break;
+#elif defined(DERG_SIMD_NEON)
+			case SimdLevel::NEON: return minMaxNeon<Max>(p_data, p_count);
+#endif
+			default: break;
+			}
+		}
+		return minMaxScalar<Max>(p_data, p_data[0], 0, p_count);
+	}
+	template<bool Max, typename T>
+	static T minMaxScalar(const T* p_data, T p_acc, size_t p_begin, size_t p_end) {
+		for (size_t i = p_begin; i < p_end; i++) {
+			if constexpr (Max) p_acc = p_acc < p_data[i] ? p_data[i] : p_acc;
+			else p_acc = p_data[i] < p_acc ? p_data[i] : p_acc;
+		}
+		return p_acc;
+	}
+
+	template<typename T>
+	static ArraySumType<T> sumSpan(const T* p_data, size_t p_count) {
+		if constexpr (hasSimdReduce<T>) {
+			switch (simdLevel()) {
+#if defined(DERG_SIMD_X86)
+			case SimdLevel::AVX2: return sumAvx2(p_data, p_count);
+			case SimdLevel::SSE2:
+				// widening 32 bit integers needs SSE4.1
+				if constexpr (!std::is_same_v<T, int32_t>) return sumSse2(p_data, p_count);
+				break;
+#elif defined(DERG_SIMD_NEON)
+			case SimdLevel::NEON: return sumNeon(p_data, p_count);
+#endif
+			default: break;
+			}
+		}
+		return sumScalar(p_data, ArraySumType<T>(), 0, p_count);
+	}
+	template<typename T>
+	static ArraySumType<T> sumScalar(const T* p_data, ArraySumType<T> p_acc, size_t p_begin, size_t p_end) {
+		for (size_t i = p_begin; i < p_end; i++) p_acc += ArraySumType<T>(p_data[i]);
+		return p_acc;
+	}
+
+#if defined(DERG_SIMD_X86)
+	// These return how many bytes they filled, always a whole number of elements. The caller does the rest.
+	DERG_TARGET_AVX2 static size_t fillAvx2(unsigned char* p_dst, size_t p_bytes, uint64_t p_pattern, size_t p_elementSize, bool p_streaming) {
+		__m256i value = _mm256_set1_epi64x((long long)p_pattern);
+		size_t i = 0;
+		// streaming stores need 32 byte alignment, and getting there can't split an element
+		size_t head = (32 - (reinterpret_cast<uintptr_t>(p_dst) & 31)) & 31;
+		if (p_streaming && head % p_elementSize == 0 && p_bytes >= head + 32) {
+			for (; i < head; i += p_elementSize) memcpy(p_dst + i, &p_pattern, p_elementSize);
+			for (; i + 32 <= p_bytes; i += 32) _mm256_stream_si256(reinterpret_cast<__m256i*>(p_dst + i), value);
+			_mm_sfence();
+			return i;
+		}
+		for (; i + 32 <= p_bytes; i += 32) _mm256_storeu_si256(reinterpret_cast<__m256i*>(p_dst + i), value);
+		return i;
+	}
+	static size_t fillSse2(unsigned char* p_dst, size_t p_bytes, uint64_t p_pattern, size_t p_elementSize, bool p_streaming) {
+		__m128i value = _mm_set1_epi64x((long long)p_pattern);
+		size_t i = 0;
+		size_t head = (16 - (reinterpret_cast<uintptr_t>(p_dst) & 15)) & 15;
+		if (p_streaming && head % p_elementSize == 0 && p_bytes >= head + 16) {
+			for (; i < head; i += p_elementSize) memcpy(p_dst + i, &p_pattern, p_elementSize);
+			for (; i + 16 <= p_bytes; i += 16) _mm_stream_si128(reinterpret_cast<__m128i*>(p_dst + i), value);
+			_mm_sfence();
+			return i;
+		}
+		for (; i + 16 <= p_bytes; i += 16) _mm_storeu_si128(reinterpret_cast<__m128i*>(p_dst + i), value);
+		return i;
+	}
+
+	template<bool Max>
+	DERG_TARGET_AVX2 static float minMaxAvx2(const float* p_data, size_t p_count) {
+		__m256 acc = _mm256_set1_ps(p_data[0]);
+		size_t i = 0;
+		for (; i + 8 <= p_count; i += 8) {
+			__m256 v = _mm256_loadu_ps(p_data + i);
+			acc = Max ? _mm256_max_ps(acc, v) : _mm256_min_ps(acc, v);
+		}
+		float lanes[8];
+		_mm256_storeu_ps(lanes, acc);
+		return minMaxScalar<Max>(p_data, minMaxScalar<Max>(lanes, lanes[0], 1, 8), i, p_count);
+	}
+	template<bool Max>
+	DERG_TARGET_AVX2 static int32_t minMaxAvx2(const int32_t* p_data, size_t p_count) {
+		__m256i acc = _mm256_set1_epi32(p_data[0]);
+		size_t i = 0;
+		for (; i + 8 <= p_count; i += 8) {
+			__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p_data + i));
+			acc = Max ? _mm256_max_epi32(acc, v) : _mm256_min_epi32(acc, v);
+		}
+		int32_t lanes[8];
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), acc);
+		return minMaxScalar<Max>(p_data, minMaxScalar<Max>(lanes, lanes[0], 1, 8), i, p_count);
+	}
+	template<bool Max>
+	DERG_TARGET_AVX2 static uint8_t minMaxAvx2(const uint8_t* p_data, size_t p_count) {
+		__m256i acc = _mm256_set1_epi8((char)p_data[0]);
+		size_t i = 0;
+		for (; i + 32 <= p_count; i += 32) {
+			__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p_data + i));
+			acc = Max ? _mm256_max_epu8(acc, v) : _mm256_min_epu8(acc, v);
+		}
+		uint8_t lanes[32];
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), acc);
+		return minMaxScalar<Max>(p_data, minMaxScalar<Max>(lanes, lanes[0], 1, 32), i, p_count);
+	}
+	template<bool Max>
+	static float minMaxSse2(const float* p_data, size_t p_count) {
+		__m128 acc = _mm_set1_ps(p_data[0]);
+		size_t i = 0;
+		for (; i + 4 <= p_count; i += 4) {
+			__m128 v = _mm_loadu_ps(p_data + i);
+			acc = Max ? _mm_max_ps(acc, v) : _mm_min_ps(acc, v);
+		}
+		float lanes[4];
+		_mm_storeu_ps(lanes, acc);
+		return minMaxScalar<Max>(p_data, minMaxScalar<Max>(lanes, lanes[0], 1, 4), i, p_count);
+	}
+	template<bool Max>
+	static uint8_t minMaxSse2(const uint8_t* p_data, size_t p_count) {
+		__m128i acc = _mm_set1_epi8((char)p_data[0]);
+		size_t i = 0;
+		for (; i + 16 <= p_count; i += 16) {
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p_data + i));
+			acc = Max ? _mm_max_epu8(acc, v) : _mm_min_epu8(acc, v);
+		}
+		uint8_t lanes[16];
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), acc);
+		return minMaxScalar<Max>(p_data, minMaxScalar<Max>(lanes, lanes[0], 1, 16), i, p_count);
+	}
+
+	// float sums are kept in doubles, otherwise a few million cells in the total stops moving
+	DERG_TARGET_AVX2 static double sumAvx2(const float* p_data, size_t p_count) {
+		__m256d lo = _mm256_setzero_pd(), hi = _mm256_setzero_pd();
+		size_t i = 0;
+		for (; i + 8 <= p_count; i += 8) {
+			__m256 v = _mm256_loadu_ps(p_data + i);
+			lo = _mm256_add_pd(lo, _mm256_cvtps_pd(_mm256_castps256_ps128(v)));
+			hi = _mm256_add_pd(hi, _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)));
+		}
+		double lanes[4];
+		_mm256_storeu_pd(lanes, _mm256_add_pd(lo, hi));
+		return sumScalar(p_data, lanes[0] + lanes[1] + lanes[2] + lanes[3], i, p_count);
+	}
+	DERG_TARGET_AVX2 static int64_t sumAvx2(const int32_t* p_data, size_t p_count) {
+		__m256i lo = _mm256_setzero_si256(), hi = _mm256_setzero_si256();
+		size_t i = 0;
+		for (; i + 8 <= p_count; i += 8) {
+			__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p_data + i));
+			lo = _mm256_add_epi64(lo, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+			hi = _mm256_add_epi64(hi, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+		}
+		int64_t lanes[4];
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), _mm256_add_epi64(lo, hi));
+		return sumScalar(p_data, lanes[0] + lanes[1] + lanes[2] + lanes[3], i, p_count);
+	}
+	DERG_TARGET_AVX2 static uint64_t sumAvx2(const uint8_t* p_data, size_t p_count) {
+		// sad against zero adds up each group of 8 bytes into a 64 bit lane
+		__m256i acc = _mm256_setzero_si256(), zero = _mm256_setzero_si256();
+		size_t i = 0;
+		for (; i + 32 <= p_count; i += 32) {
+			__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p_data + i));
+			acc = _mm256_add_epi64(acc, _mm256_sad_epu8(v, zero));
+		}
+		uint64_t lanes[4];
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), acc);
+		return sumScalar(p_data, lanes[0] + lanes[1] + lanes[2] + lanes[3], i, p_count);
+	}
+	static double sumSse2(const float* p_data, size_t p_count) {
+		__m128d lo = _mm_setzero_pd(), hi = _mm_setzero_pd();
+		size_t i = 0;
+		for (; i + 4 <= p_count; i += 4) {
+			__m128 v = _mm_loadu_ps(p_data + i);
+			lo = _mm_add_pd(lo, _mm_cvtps_pd(v));
+			hi = _mm_add_pd(hi, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+		}
+		double lanes[2];
+		_mm_storeu_pd(lanes, _mm_add_pd(lo, hi));
+		return sumScalar(p_data, lanes[0] + lanes[1], i, p_count);
+	}
+	static uint64_t sumSse2(const uint8_t* p_data, size_t p_count) {
+		__m128i acc = _mm_setzero_si128(), zero = _mm_setzero_si128();
+		size_t i = 0;
+		for (; i + 16 <= p_count; i += 16) {
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p_data + i));
+			acc = _mm_add_epi64(acc, _mm_sad_epu8(v, zero));
+		}
+		uint64_t lanes[2];
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), acc);
+		return sumScalar(p_data, lanes[0] + lanes[1], i, p_count);
+	}
+#elif defined(DERG_SIMD_NEON)
+	static size_t fillNeon(unsigned char* p_dst, size_t p_bytes, uint64_t p_pattern) {
+		uint8x16_t value = vreinterpretq_u8_u64(vdupq_n_u64(p_pattern));
+		size_t i = 0;
+		for (; i + 16 <= p_bytes; i += 16) vst1q_u8(p_dst + i, value);
+		return i;
+	}
+
+	template<bool Max>
+	static float minMaxNeon(const float* p_data, size_t p_count) {
+		float32x4_t acc = vdupq_n_f32(p_data[0]);
+		size_t i = 0;
+		for (; i + 4 <= p_count; i += 4) {
+			float32x4_t v = vld1q_f32(p_data + i);
+			acc = Max ? vmaxq_f32(acc, v) : vminq_f32(acc, v);
+		}
+		return minMaxScalar<Max>(p_data, Max ? vmaxvq_f32(acc) : vminvq_f32(acc), i, p_count);
+	}
+	template<bool Max>
+	static int32_t minMaxNeon(const int32_t* p_data, size_t p_count) {
+		int32x4_t acc = vdupq_n_s32(p_data[0]);
+		size_t i = 0;
+		for (; i + 4 <= p_count; i += 4) {
+			int32x4_t v = vld1q_s32(p_data + i);
+			acc = Max ? vmaxq_s32(acc, v) : vminq_s32(acc, v);
+		}
+		return minMaxScalar<Max>(p_data, Max ? vmaxvq_s32(acc) : vminvq_s32(acc), i, p_count);
+	}
+	template<bool Max>
+	static uint8_t minMaxNeon(const uint8_t* p_data, size_t p_count) {
+		uint8x16_t acc = vdupq_n_u8(p_data[0]);
+		size_t i = 0;
+		for (; i + 16 <= p_count; i += 16) {
+			uint8x16_t v = vld1q_u8(p_data + i);
+			acc = Max ? vmaxq_u8(acc, v) : vminq_u8(acc, v);
+		}
+		return minMaxScalar<Max>(p_data, Max ? vmaxvq_u8(acc) : vminvq_u8(acc), i, p_count);
+	}
+
+	static double sumNeon(const float* p_data, size_t p_count) {
+		float64x2_t lo = vdupq_n_f64(0.0), hi = vdupq_n_f64(0.0);
+		size_t i = 0;
+		for (; i + 4 <= p_count; i += 4) {
+			float32x4_t v = vld1q_f32(p_data + i);
+			lo = vaddq_f64(lo, vcvt_f64_f32(vget_low_f32(v)));
+			hi = vaddq_f64(hi, vcvt_high_f64_f32(v));
+		}
+		return sumScalar(p_data, vaddvq_f64(vaddq_f64(lo, hi)), i, p_count);
+	}
+	static int64_t sumNeon(const int32_t* p_data, size_t p_count) {
+		int64x2_t acc = vdupq_n_s64(0);
+		size_t i = 0;
+		for (; i + 4 <= p_count; i += 4) acc = vpadalq_s32(acc, vld1q_s32(p_data + i));
+		return sumScalar(p_data, (int64_t)vaddvq_s64(acc), i, p_count);
+	}
+	static uint64_t sumNeon(const uint8_t* p_data, size_t p_count) {
+		uint64x2_t acc = vdupq_n_u64(0);
+		size_t i = 0;
+		for (; i + 16 <= p_count; i += 16) acc = vaddq_u64(acc, vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(vld1q_u8(p_data + i)))));
+		return sumScalar(p_data, (uint64_t)vaddvq_u64(acc), i, p_count);
+	}
+#endif
+};
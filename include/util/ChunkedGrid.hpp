@@ -0,0 +1,229 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+#include <stdint.h>
+#include "Framework/Log.hpp"
+#include "Array3D.hpp"
+
+template<class T, uint32_t ChunkBits = 5>
+// Sparse stand-in for Array3D, for big worlds that are mostly empty.
+// The grid is cut into (1 << ChunkBits)^3 chunks, kept in an Array3D of their own so finding one is a single index.
+// A chunk where every cell is the same only stores that one value, and cells only get real storage once something
+// different is written into them. Freed chunk buffers are kept around
+// and handed back out, so painting and clearing doesn't keep hitting the allocator.
+// operator() works like it does on Array3D, including invertDepth, but since it hands out a reference it has to give
+// the chunk real storage. Use get() and set() when you can, they leave uniform chunks alone where possible.
+class ChunkedGrid {
+public:
+	static constexpr uint32_t CHUNK_SIZE = 1u << ChunkBits;
+	static constexpr uint32_t CHUNK_MASK = CHUNK_SIZE - 1;
+	static constexpr size_t CHUNK_VOLUME = size_t(CHUNK_SIZE) * CHUNK_SIZE * CHUNK_SIZE;
+
+	ChunkedGrid() { width = 0; height = 0; depth = 0; }
+	ChunkedGrid(uint32_t p_width, uint32_t p_height, uint32_t p_depth, T p_emptyValue = T()) : m_emptyValue(p_emptyValue) {
+		resize(p_width, p_height, p_depth);
+	}
+	ChunkedGrid(const ChunkedGrid<T, ChunkBits>& other) = delete;
+	ChunkedGrid<T, ChunkBits>& operator=(const ChunkedGrid<T, ChunkBits>& other) = delete;
+	ChunkedGrid(ChunkedGrid<T, ChunkBits>&& other) noexcept : ChunkedGrid() {
+		swap(other);
+	}
+	ChunkedGrid<T, ChunkBits>& operator=(ChunkedGrid<T, ChunkBits>&& other) noexcept {
+		swap(other);
+		return *this;
+	}
+	~ChunkedGrid() {
+		for (Chunk& chunk : m_chunks.getData()) release(chunk);
+		shrinkPool();
+	}
+	void swap(ChunkedGrid<T, ChunkBits>& other) noexcept {
+		std::swap(width, other.width);
+		std::swap(height, other.height);
+		std::swap(depth, other.depth);
+		std::swap(invertDepth, other.invertDepth);
+		std::swap(m_emptyValue, other.m_emptyValue);
+		// Array3D has no move assignment, so swap its guts instead of copying it
+		std::swap(m_chunks.getData(), other.m_chunks.getData());
+		std::swap(m_chunks.width, other.m_chunks.width);
+		std::swap(m_chunks.height, other.m_chunks.height);
+		std::swap(m_chunks.depth, other.m_chunks.depth);
+		std::swap(m_pool, other.m_pool);
+		std::swap(m_allocatedCount, other.m_allocatedCount);
+	}
+
+	T& operator()(size_t x, size_t y, size_t z) {
+#ifdef _DEBUG
+		if (!bounded((int)x, (int)y, (int)z)) {
+			throw std::out_of_range("Chunked grid index out of bounds.");
+		}
+#endif
+		if (invertDepth) z = depth - 1 - z;
+		Chunk& chunk = chunkAt(x, y, z);
+		if (!chunk.cells) materialize(chunk);
+		return chunk.cells[cellIndex(x, y, z)];
+	}
+	T& operator()(int x, int y, int z) {
+		return (*this)((size_t)x, (size_t)y, (size_t)z);
+	}
+
+	T get(size_t x, size_t y, size_t z) const {
+#ifdef _DEBUG
+		if (!bounded((int)x, (int)y, (int)z)) {
+			throw std::out_of_range("Chunked grid index out of bounds.");
+		}
+#endif
+		if (invertDepth) z = depth - 1 - z;
+		const Chunk& chunk = chunkAt(x, y, z);
+		return chunk.cells ? chunk.cells[cellIndex(x, y, z)] : chunk.uniform;
+	}
+	// Writing the value a uniform chunk already holds doesn't allocate anything.
+	void set(size_t x, size_t y, size_t z, const T& p_value) {
+#ifdef _DEBUG
+		if (!bounded((int)x, (int)y, (int)z)) {
+			throw std::out_of_range("Chunked grid index out of bounds.");
+		}
+#endif
+		if (invertDepth) z = depth - 1 - z;
+		Chunk& chunk = chunkAt(x, y, z);
+		if (!chunk.cells) {
+			if (chunk.uniform == p_value) return;
+			materialize(chunk);
+		}
+		chunk.cells[cellIndex(x, y, z)] = p_value;
+	}
+
+	bool bounded(int x, int y, int z) const {
+		if (x >= 0 && x < width && y >= 0 && y < height && z >= 0 && z < depth) return true;
+		return false;
+	}
+
+	// Every chunk collapses to p_fillValue, and all their storage goes back to the pool.
+	void fill(T p_fillValue) {
+		for (Chunk& chunk : m_chunks.getData()) {
+			release(chunk);
+			chunk.uniform = p_fillValue;
+		}
+	}
+	// Clears the grid to the empty value.
+	void resize(uint32_t p_width, uint32_t p_height, uint32_t p_depth) {
+		for (Chunk& chunk : m_chunks.getData()) release(chunk);
+		width = p_width;
+		height = p_height;
+		depth = p_depth;
+		m_chunks.clear();
+		m_chunks.resize((p_width + CHUNK_MASK) >> ChunkBits, (p_height + CHUNK_MASK) >> ChunkBits, (p_depth + CHUNK_MASK) >> ChunkBits);
+		m_chunks.fill(Chunk{ nullptr, m_emptyValue });
+	}
+
+	// Looks through every chunk with storage and collapses the ones that ended up all one value.
+	// Worth calling after a big edit, like an explosion clearing out a region. Returns how many chunks it freed.
+	size_t collapseUniform() {
+		size_t freed = 0;
+		for (Chunk& chunk : m_chunks.getData()) {
+			if (!chunk.cells) continue;
+			const T& first = chunk.cells[0];
+			if (!std::all_of(chunk.cells + 1, chunk.cells + CHUNK_VOLUME, [&](const T& p_cell) { return p_cell == first; })) continue;
+			T value = first;
+			release(chunk);
+			chunk.uniform = value;
+			freed++;
+		}
+		return freed;
+	}
+	// Drops the pooled buffers that aren't in use.
+	void shrinkPool() {
+		for (T* buffer : m_pool) delete[] buffer;
+		m_pool.clear();
+		m_pool.shrink_to_fit();
+	}
+
+	// Calls p_fn(x, y, z, T&) for every cell in chunks that have storage, chunk by chunk.
+	// Uniform chunks are skipped, even ones that aren't empty, so check forEachChunk() if those matter.
+	// Coordinates are in storage order, so they ignore invertDepth.
+	template<typename F>
+	void forEachCell(F&& p_fn) {
+		for (size_t cz = 0; cz < m_chunks.depth; cz++) for (size_t cy = 0; cy < m_chunks.height; cy++) for (size_t cx = 0; cx < m_chunks.width; cx++) {
+			Chunk& chunk = m_chunks(cx, cy, cz);
+			if (!chunk.cells) continue;
+			size_t baseX = cx << ChunkBits, baseY = cy << ChunkBits, baseZ = cz << ChunkBits;
+			size_t endX = std::min<size_t>(CHUNK_SIZE, width - baseX);
+			size_t endY = std::min<size_t>(CHUNK_SIZE, height - baseY);
+			size_t endZ = std::min<size_t>(CHUNK_SIZE, depth - baseZ);
+			for (size_t z = 0; z < endZ; z++) for (size_t y = 0; y < endY; y++) for (size_t x = 0; x < endX; x++) {
+				p_fn(baseX + x, baseY + y, baseZ + z, chunk.cells[(z << (ChunkBits * 2)) | (y << ChunkBits) | x]);
+			}
+		}
+	}
+	// Calls p_fn(chunkX, chunkY, chunkZ, T* cells, const T& uniform) for every chunk that isn't uniformly empty.
+	// cells is nullptr for uniform chunks, otherwise it points at CHUNK_VOLUME values laid out x fastest, then y, then z.
+	template<typename F>
+	void forEachChunk(F&& p_fn) {
+		for (size_t cz = 0; cz < m_chunks.depth; cz++) for (size_t cy = 0; cy < m_chunks.height; cy++) for (size_t cx = 0; cx < m_chunks.width; cx++) {
+			Chunk& chunk = m_chunks(cx, cy, cz);
+			if (!chunk.cells && chunk.uniform == m_emptyValue) continue;
+			p_fn(cx, cy, cz, chunk.cells, chunk.uniform);
+		}
+	}
+
+	size_t allocatedChunkCount() const {
+		return m_allocatedCount;
+	}
+	size_t chunkCount() const {
+		return m_chunks.width * m_chunks.height * m_chunks.depth;
+	}
+	// Roughly what the grid is costing, chunk table plus cell storage, pooled buffers included.
+	size_t memoryUsage() const {
+		return chunkCount() * sizeof(Chunk) + (m_allocatedCount + m_pool.size()) * CHUNK_VOLUME * sizeof(T);
+	}
+	const T& emptyValue() const {
+		return m_emptyValue;
+	}
+
+	size_t width;
+	size_t height;
+	size_t depth;
+	bool invertDepth = false;
+private:
+	struct Chunk {
+		// owned by the grid, comes from and goes back to m_pool
+		T* cells = nullptr;
+		// what every cell holds while cells is null
+		T uniform = T();
+	};
+
+	Chunk& chunkAt(size_t x, size_t y, size_t z) {
+		return m_chunks(x >> ChunkBits, y >> ChunkBits, z >> ChunkBits);
+	}
+	const Chunk& chunkAt(size_t x, size_t y, size_t z) const {
+		// Array3D has no const accessor
+		return const_cast<Array3D<Chunk>&>(m_chunks)(x >> ChunkBits, y >> ChunkBits, z >> ChunkBits);
+	}
+	static size_t cellIndex(size_t x, size_t y, size_t z) {
+		return ((z & CHUNK_MASK) << (ChunkBits * 2)) | ((y & CHUNK_MASK) << ChunkBits) | (x & CHUNK_MASK);
+	}
+
+	void materialize(Chunk& p_chunk) {
+		if (!m_pool.empty()) {
+			p_chunk.cells = m_pool.back();
+			m_pool.pop_back();
+		}
+		else {
+			p_chunk.cells = new T[CHUNK_VOLUME];
+		}
+		std::fill(p_chunk.cells, p_chunk.cells + CHUNK_VOLUME, p_chunk.uniform);
+		m_allocatedCount++;
+	}
+	void release(Chunk& p_chunk) {
+		if (!p_chunk.cells) return;
+		m_pool.push_back(p_chunk.cells);
+		p_chunk.cells = nullptr;
+		m_allocatedCount--;
+	}
+
+	T m_emptyValue = T();
+	Array3D<Chunk> m_chunks;
+	std::vector<T*> m_pool;
+	size_t m_allocatedCount = 0;
+};
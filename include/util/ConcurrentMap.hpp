@@ -0,0 +1,260 @@
+#pragma once
+#include <vector>
+#include <optional>
+#include <utility>
+#include <tuple>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <stdint.h>
+
+template<typename Kty, typename Ty, typename Hasher = std::hash<Kty>, size_t ShardCount = 16>
+// Threadsafe hash map split into ShardCount independently locked shards, so threads working on different keys
+// almost never wait on each other. Each shard is a flat open addressing table with linear probing.
+// Nothing ever hands out a reference or iterator that outlives the shard lock. Use visit()/cvisit() to work on a value
+// in place, or find() to get a copy (so Ty is usually something cheap to copy, like a handle or a shared_ptr).
+class ConcurrentMap {
+	static_assert(ShardCount > 0 && (ShardCount & (ShardCount - 1)) == 0, "ShardCount has to be a power of two");
+public:
+	ConcurrentMap() {}
+	ConcurrentMap(const ConcurrentMap& other) = delete;
+	ConcurrentMap& operator=(const ConcurrentMap& other) = delete;
+
+	// Returns a copy of the value stored under p_key, constructing it from p_args first if it isn't there.
+	// The bool is true if this call did the inserting. p_args are left alone if the key was already there.
+	template<typename... Args>
+	std::pair<Ty, bool> find_or_emplace(const Kty& p_key, Args&&... p_args) {
+		size_t hash = hashOf(p_key);
+		Shard& shard = shardFor(hash);
+		{
+			std::shared_lock<std::shared_mutex> lock(shard.mutex);
+			size_t index = shard.find(p_key, hash);
+			if (index != NOT_FOUND) return { shard.slots[index].entry->second, false };
+		}
+		std::unique_lock<std::shared_mutex> lock(shard.mutex);
+		// someone else might have beaten us to it while the lock was released
+		size_t index = shard.find(p_key, hash);
+		if (index != NOT_FOUND) return { shard.slots[index].entry->second, false };
+		index = shard.emplace(hash, p_key, std::forward<Args>(p_args)...);
+		return { shard.slots[index].entry->second, true };
+	}
+
+	// Returns false and leaves the map alone if p_key is already there.
+	bool insert(const Kty& p_key, Ty p_value) {
+		size_t hash = hashOf(p_key);
+		Shard& shard = shardFor(hash);
+		std::unique_lock<std::shared_mutex> lock(shard.mutex);
+		if (shard.find(p_key, hash) != NOT_FOUND) return false;
+		shard.emplace(hash, p_key, std::move(p_value));
+		return true;
+	}
+	// Returns true if p_key was new.
+	bool insert_or_assign(const Kty& p_key, Ty p_value) {
+		size_t hash = hashOf(p_key);
+		Shard& shard = shardFor(hash);
+		std::unique_lock<std::shared_mutex> lock(shard.mutex);
+		size_t index = shard.find(p_key, hash);
+		if (index != NOT_FOUND) {
+			shard.slots[index].entry->second = std::move(p_value);
+			return false;
+		}
+		shard.emplace(hash, p_key, std::move(p_value));
+		return true;
+	}
+
+	bool erase(const Kty& p_key) {
+		size_t hash = hashOf(p_key);
+		Shard& shard = shardFor(hash);
+		std::unique_lock<std::shared_mutex> lock(shard.mutex);
+		size_t index = shard.find(p_key, hash);
+		if (index == NOT_FOUND) return false;
+		shard.erase(index);
+		return true;
+	}
+
+	std::optional<Ty> find(const Kty& p_key) const {
+		size_t hash = hashOf(p_key);
+		const Shard& shard = shardFor(hash);
+		std::shared_lock<std::shared_mutex> lock(shard.mutex);
+		size_t index = shard.find(p_key, hash);
+		if (index == NOT_FOUND) return std::nullopt;
+		return shard.slots[index].entry->second;
+	}
+	bool contains(const Kty& p_key) const {
+		size_t hash = hashOf(p_key);
+		const Shard& shard = shardFor(hash);
+		std::shared_lock<std::shared_mutex> lock(shard.mutex);
+		return shard.find(p_key, hash) != NOT_FOUND;
+	}
+
+	// Calls p_fn(Ty&) on the value under p_key while holding its shard exclusively. Returns false if there's no such key.
+	// Don't touch the map from inside p_fn, the shard is still locked.
+	template<typename F>
+	bool visit(const Kty& p_key, F&& p_fn) {
+		size_t hash = hashOf(p_key);
+		Shard& shard = shardFor(hash);
+		std::unique_lock<std::shared_mutex> lock(shard.mutex);
+		size_t index = shard.find(p_key, hash);
+		if (index == NOT_FOUND) return false;
+		p_fn(shard.slots[index].entry->second);
+		return true;
+	}
+	// Same as visit() but read only, so other readers of the same shard aren't held up.
+	template<typename F>
+	bool cvisit(const Kty& p_key, F&& p_fn) const {
+		size_t hash = hashOf(p_key);
+		const Shard& shard = shardFor(hash);
+		std::shared_lock<std::shared_mutex> lock(shard.mutex);
+		size_t index = shard.find(p_key, hash);
+		if (index == NOT_FOUND) return false;
+		p_fn(std::as_const(shard.slots[index].entry->second));
+		return true;
+	}
+
+	// Calls p_fn(const Kty&, const Ty&) on every entry. Every shard is read locked for the whole walk,
+	// so it sees the map as it was at one instant, but writers are held up until it's done. Keep p_fn short,
+	// or use snapshot() and walk the copy instead.
+	template<typename F>
+	void forEach(F&& p_fn) const {
+		std::vector<std::shared_lock<std::shared_mutex>> locks;
+		locks.reserve(ShardCount);
+		// always taken in the same order so two walkers can't deadlock
+		for (const Shard& shard : m_shards) locks.emplace_back(shard.mutex);
+		for (const Shard& shard : m_shards) {
+			for (const Slot& slot : shard.slots) {
+				if (slot.entry) p_fn(std::as_const(slot.entry->first), std::as_const(slot.entry->second));
+			}
+		}
+	}
+	// Consistent copy of every entry.
+	std::vector<std::pair<Kty, Ty>> snapshot() const {
+		std::vector<std::pair<Kty, Ty>> out;
+		forEach([&](const Kty& p_key, const Ty& p_value) { out.emplace_back(p_key, p_value); });
+		return out;
+	}
+
+	size_t size() const {
+		size_t total = 0;
+		for (const Shard& shard : m_shards) {
+			std::shared_lock<std::shared_mutex> lock(shard.mutex);
+			total += shard.count;
+		}
+		return total;
+	}
+	void clear() {
+		for (Shard& shard : m_shards) {
+			std::unique_lock<std::shared_mutex> lock(shard.mutex);
+			shard.slots.clear();
+			shard.count = 0;
+		}
+	}
+	// Spreads p_reserveAmount evenly over the shards, assuming the hash does too.
+	void reserve(size_t p_reserveAmount) {
+		for (Shard& shard : m_shards) {
+			std::unique_lock<std::shared_mutex> lock(shard.mutex);
+			shard.reserve(p_reserveAmount / ShardCount + 1);
+		}
+	}
+
+	static ConcurrentMap<Kty, Ty, Hasher, ShardCount>& Get() {
+		static ConcurrentMap<Kty, Ty, Hasher, ShardCount> instance;
+		return instance;
+	}
+private:
+	static constexpr size_t NOT_FOUND = SIZE_MAX;
+	static constexpr size_t MIN_SHARD_CAPACITY = 16;
+
+	struct Slot {
+		std::optional<std::pair<Kty, Ty>> entry;
+		size_t hash = 0;
+	};
+
+	// Padded out so two shards' locks never share a cache line.
+	struct alignas(64) Shard {
+		mutable std::shared_mutex mutex;
+		std::vector<Slot> slots;
+		size_t count = 0;
+
+		size_t mask() const {
+			return slots.size() - 1;
+		}
+
+		size_t find(const Kty& p_key, size_t p_hash) const {
+			if (slots.empty()) return NOT_FOUND;
+			for (size_t i = p_hash & mask();; i = (i + 1) & mask()) {
+				const Slot& slot = slots[i];
+				if (!slot.entry) return NOT_FOUND;
+				if (slot.hash == p_hash && slot.entry->first == p_key) return i;
+			}
+		}
+
+		// Key must not be in the table yet.
+		template<typename... Args>
+		size_t emplace(size_t p_hash, const Kty& p_key, Args&&... p_args) {
+			// kept under 3/4 full, linear probing falls apart past that
+			if ((count + 1) * 4 > slots.size() * 3) reserve(count + 1);
+			size_t i = p_hash & mask();
+			while (slots[i].entry) i = (i + 1) & mask();
+			slots[i].entry.emplace(std::piecewise_construct, std::forward_as_tuple(p_key), std::forward_as_tuple(std::forward<Args>(p_args)...));
+			slots[i].hash = p_hash;
+			count++;
+			return i;
+		}
+
+		// Shifts the rest of the probe run back into the hole, so there are no tombstones to clean up later.
+		void erase(size_t p_index) {
+			slots[p_index].entry.reset();
+			count--;
+			size_t hole = p_index;
+			for (size_t i = (hole + 1) & mask(); slots[i].entry; i = (i + 1) & mask()) {
+				size_t home = slots[i].hash & mask();
+				// only move it if the hole is between its home slot and where it is now
+				if (((i - home) & mask()) >= ((i - hole) & mask())) {
+					slots[hole] = std::move(slots[i]);
+					slots[i].entry.reset();
+					hole = i;
+				}
+			}
+		}
+
+		void reserve(size_t p_entries) {
+			size_t capacity = MIN_SHARD_CAPACITY;
+			while (capacity * 3 < p_entries * 4) capacity <<= 1;
+			if (capacity <= slots.size()) return;
+
+			std::vector<Slot> old = std::move(slots);
+			slots = std::vector<Slot>(capacity);
+			for (Slot& slot : old) {
+				if (!slot.entry) continue;
+				size_t i = slot.hash & mask();
+				while (slots[i].entry) i = (i + 1) & mask();
+				slots[i] = std::move(slot);
+			}
+		}
+	};
+
+	// Hashers like std::hash<int> hand back the key as is, so mix it before splitting it into a shard and a slot.
+	static size_t hashOf(const Kty& p_key) {
+		uint64_t hash = (uint64_t)Hasher{}(p_key);
+		hash ^= hash >> 33;
+		hash *= 0xFF51AFD7ED558CCDull;
+		hash ^= hash >> 33;
+		return (size_t)hash;
+	}
+	// top bits pick the shard, the table index comes from the bottom bits
+	Shard& shardFor(size_t p_hash) {
+		return m_shards[(p_hash >> (sizeof(size_t) * 8 - SHARD_BITS)) & (ShardCount - 1)];
+	}
+	const Shard& shardFor(size_t p_hash) const {
+		return m_shards[(p_hash >> (sizeof(size_t) * 8 - SHARD_BITS)) & (ShardCount - 1)];
+	}
+
+	static constexpr size_t shardBits() {
+		size_t bits = 0;
+		while ((size_t(1) << bits) < ShardCount) bits++;
+		return bits;
+	}
+	static constexpr size_t SHARD_BITS = shardBits() == 0 ? 1 : shardBits();
+
+	Shard m_shards[ShardCount];
+};
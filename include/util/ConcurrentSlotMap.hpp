@@ -0,0 +1,201 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <optional>
+#include <utility>
+#include "SlotMap.hpp"
+#include "EpochDomain.hpp"
+
+template<typename T>
+// SlotMap that any number of threads can read from while others insert and erase.
+// Reads never lock: they pin the epoch domain, check the slot's generation, and follow its pointer.
+// Writers take a mutex between themselves. Each value lives in its own allocation so it never moves, and erased or
+// replaced values are retired to the epoch domain rather than deleted, so a reader never sees one freed under it.
+// The trade off is that values aren't packed together, so for walking every entry each frame prefer a plain SlotMap.
+class ConcurrentSlotMap {
+public:
+	ConcurrentSlotMap(EpochDomain& p_domain = EpochDomain::Get()) : m_domain(p_domain) {
+		m_directory.store(new Directory(), std::memory_order_release);
+	}
+	ConcurrentSlotMap(const ConcurrentSlotMap& other) = delete;
+	ConcurrentSlotMap& operator=(const ConcurrentSlotMap& other) = delete;
+	// Nobody can be reading by now.
+	~ConcurrentSlotMap() {
+		Directory* directory = m_directory.load(std::memory_order_acquire);
+		for (auto& chunk : m_chunks) {
+			for (Slot& slot : chunk->slots) delete slot.value.load(std::memory_order_relaxed);
+		}
+		delete directory;
+	}
+
+	template<typename... Args>
+	SlotHandle emplace(Args&&... p_args) {
+		// owned here until it's in a slot, in case growing the slots throws
+		std::unique_ptr<T> value = std::make_unique<T>(std::forward<Args>(p_args)...);
+		std::unique_lock<std::mutex> lock(m_writeMutex);
+		uint32_t slotIndex = acquireSlot();
+		Slot& slot = slotAt(slotIndex);
+		uint32_t generation = slot.generation.load(std::memory_order_relaxed) + 1;
+		// value first, then the generation that makes it visible
+		slot.value.store(value.release(), std::memory_order_release);
+		slot.generation.store(generation, std::memory_order_release);
+		m_size.fetch_add(1, std::memory_order_relaxed);
+		return { slotIndex, generation };
+	}
+	SlotHandle insert(const T& p_value) {
+		return emplace(p_value);
+	}
+	SlotHandle insert(T&& p_value) {
+		return emplace(std::move(p_value));
+	}
+
+	bool erase(SlotHandle p_handle) {
+		std::unique_lock<std::mutex> lock(m_writeMutex);
+		if (!liveLocked(p_handle)) return false;
+		Slot& slot = slotAt(p_handle.index);
+		// generation first, so readers stop trusting the pointer before it changes
+		slot.generation.store(p_handle.generation + 1, std::memory_order_release);
+		T* old = slot.value.exchange(nullptr, std::memory_order_acq_rel);
+		releaseSlot(p_handle.index);
+		m_size.fetch_sub(1, std::memory_order_relaxed);
+		lock.unlock();
+		m_domain.retire(old);
+		return true;
+	}
+
+	// Swaps in a new value under the same handle. Readers see either the old one or the new one, never a mix.
+	bool replace(SlotHandle p_handle, T p_value) {
+		T* value = new T(std::move(p_value));
+		std::unique_lock<std::mutex> lock(m_writeMutex);
+		if (!liveLocked(p_handle)) {
+			delete value;
+			return false;
+		}
+		T* old = slotAt(p_handle.index).value.exchange(value, std::memory_order_acq_rel);
+		lock.unlock();
+		m_domain.retire(old);
+		return true;
+	}
+
+	// Calls p_fn(const T&) if the handle is live. Lock free, the value stays valid for the whole call even if
+	// another thread erases it meanwhile.
+	template<typename F>
+	bool visit(SlotHandle p_handle, F&& p_fn) const {
+		EpochDomain::Guard guard(m_domain);
+		const T* value = lookup(p_handle);
+		if (!value) return false;
+		p_fn(*value);
+		return true;
+	}
+	std::optional<T> get(SlotHandle p_handle) const {
+		EpochDomain::Guard guard(m_domain);
+		const T* value = lookup(p_handle);
+		if (!value) return std::nullopt;
+		return *value;
+	}
+	bool contains(SlotHandle p_handle) const {
+		EpochDomain::Guard guard(m_domain);
+		return lookup(p_handle) != nullptr;
+	}
+
+	// Calls p_fn(SlotHandle, const T&) on every live value. Anything inserted or erased during the walk may or may not show up.
+	template<typename F>
+	void forEach(F&& p_fn) const {
+		EpochDomain::Guard guard(m_domain);
+		const Directory* directory = m_directory.load(std::memory_order_acquire);
+		for (size_t c = 0; c < directory->chunks.size(); c++) {
+			const Chunk& chunk = *directory->chunks[c];
+			for (uint32_t i = 0; i < CHUNK_SIZE; i++) {
+				const Slot& slot = chunk.slots[i];
+				uint32_t generation = slot.generation.load(std::memory_order_acquire);
+				if (!(generation & 1)) continue;
+				const T* value = slot.value.load(std::memory_order_acquire);
+				if (!value || slot.generation.load(std::memory_order_acquire) != generation) continue;
+				p_fn(SlotHandle{ uint32_t(c * CHUNK_SIZE + i), generation }, *value);
+			}
+		}
+	}
+
+	size_t size() const {
+		return m_size.load(std::memory_order_relaxed);
+	}
+private:
+	static constexpr uint32_t CHUNK_SIZE = 1024;
+	static constexpr uint32_t NO_FREE_SLOT = UINT32_MAX;
+
+	struct Slot {
+		// odd while live, even while free
+		std::atomic<uint32_t> generation{ 0 };
+		std::atomic<T*> value{ nullptr };
+		// only touched by writers
+		uint32_t nextFree = NO_FREE_SLOT;
+	};
+	// Slots live in fixed chunks that never move once made, so growing never invalidates what a reader is looking at.
+	struct Chunk {
+		Slot slots[CHUNK_SIZE];
+	};
+	// The list of chunks readers go through. Copied and swapped when a chunk gets added.
+	struct Directory {
+		std::vector<Chunk*> chunks;
+	};
+
+	const T* lookup(SlotHandle p_handle) const {
+		if (!(p_handle.generation & 1)) return nullptr;
+		const Directory* directory = m_directory.load(std::memory_order_acquire);
+		size_t chunkIndex = p_handle.index / CHUNK_SIZE;
+		if (chunkIndex >= directory->chunks.size()) return nullptr;
+		const Slot& slot = directory->chunks[chunkIndex]->slots[p_handle.index % CHUNK_SIZE];
+		if (slot.generation.load(std::memory_order_acquire) != p_handle.generation) return nullptr;
+		const T* value = slot.value.load(std::memory_order_acquire);
+		// if it got erased in between, the generation moved first
+		if (slot.generation.load(std::memory_order_acquire) != p_handle.generation) return nullptr;
+		return value;
+	}
+
+	// must hold m_writeMutex
+	Slot& slotAt(uint32_t p_slotIndex) {
+		return m_chunks[p_slotIndex / CHUNK_SIZE]->slots[p_slotIndex % CHUNK_SIZE];
+	}
+	// must hold m_writeMutex
+	bool liveLocked(SlotHandle p_handle) {
+		return (p_handle.generation & 1) && p_handle.index < m_slotCount && slotAt(p_handle.index).generation.load(std::memory_order_relaxed) == p_handle.generation;
+	}
+	// must hold m_writeMutex
+	uint32_t acquireSlot() {
+		if (m_freeHead != NO_FREE_SLOT) {
+			uint32_t slotIndex = m_freeHead;
+			m_freeHead = slotAt(slotIndex).nextFree;
+			return slotIndex;
+		}
+		if (m_slotCount == m_chunks.size() * CHUNK_SIZE) addChunk();
+		return m_slotCount++;
+	}
+	// must hold m_writeMutex
+	void releaseSlot(uint32_t p_slotIndex) {
+		Slot& slot = slotAt(p_slotIndex);
+		// a slot whose generation is about to wrap around is never reused, or an ancient handle could match it again
+		if (slot.generation.load(std::memory_order_relaxed) >= UINT32_MAX - 1) return;
+		slot.nextFree = m_freeHead;
+		m_freeHead = p_slotIndex;
+	}
+	// must hold m_writeMutex
+	void addChunk() {
+		m_chunks.emplace_back(std::make_unique<Chunk>());
+		Directory* next = new Directory(*m_directory.load(std::memory_order_relaxed));
+		next->chunks.push_back(m_chunks.back().get());
+		const Directory* old = m_directory.exchange(next, std::memory_order_seq_cst);
+		m_domain.retire(old);
+	}
+
+	EpochDomain& m_domain;
+	std::atomic<Directory*> m_directory;
+	std::atomic<size_t> m_size{ 0 };
+
+	std::mutex m_writeMutex;
+	// owns the chunks, readers only ever see them through m_directory
+	std::vector<std::unique_ptr<Chunk>> m_chunks;
+	uint32_t m_slotCount = 0;
+	uint32_t m_freeHead = NO_FREE_SLOT;
+};
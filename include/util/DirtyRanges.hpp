@@ -0,0 +1,95 @@
+#pragma once
+#include <vector>
+#include <span>
+#include <algorithm>
+#include <stddef.h>
+#include <stdint.h>
+
+// Keeps track of which parts of an array changed since they were last sent somewhere, so only those parts get sent.
+// Ranges are [begin, end) element indices. Ranges less than the merge gap apart get joined, since one slightly bigger
+// copy is usually cheaper than two separate ones.
+// Marking is cheap when edits come in order, which is the usual case: it just grows the last range.
+class DirtyRanges {
+public:
+	struct Range {
+		size_t begin;
+		size_t end;
+		size_t size() const {
+			return end - begin;
+		}
+	};
+	// Past this many, out of order marks get merged early, and whatever's left after merging is just one big range.
+	static constexpr size_t MAX_RANGES = 64;
+
+	DirtyRanges(size_t p_mergeGap = 0) : m_mergeGap(p_mergeGap) {}
+
+	void mark(size_t p_begin, size_t p_end) {
+		if (p_end <= p_begin || m_all) return;
+		if (!m_ranges.empty()) {
+			Range& last = m_ranges.back();
+			if (p_begin <= last.end + m_mergeGap && p_end + m_mergeGap >= last.begin) {
+				last.begin = std::min(last.begin, p_begin);
+				last.end = std::max(last.end, p_end);
+				return;
+			}
+		}
+		m_ranges.push_back({ p_begin, p_end });
+		if (m_ranges.size() > MAX_RANGES * 2) merge(SIZE_MAX);
+	}
+	// For when something got changed that couldn't be tracked.
+	void markAll() {
+		m_all = true;
+		m_ranges.clear();
+	}
+	void clear() {
+		m_all = false;
+		m_ranges.clear();
+	}
+	bool empty() const {
+		return !m_all && m_ranges.empty();
+	}
+
+	void setMergeGap(size_t p_mergeGap) {
+		m_mergeGap = p_mergeGap;
+	}
+	size_t getMergeGap() const {
+		return m_mergeGap;
+	}
+
+	// Sorted, merged and clipped to an array of p_size elements. Good until the next mark().
+	std::span<const Range> coalesce(size_t p_size) {
+		if (m_all) {
+			m_ranges.assign(1, { 0, p_size });
+			m_all = false;
+		}
+		merge(p_size);
+		return m_ranges;
+	}
+	// Elements covered by coalesce(p_size).
+	size_t dirtyCount(size_t p_size) {
+		size_t count = 0;
+		for (const Range& range : coalesce(p_size)) count += range.size();
+		return count;
+	}
+private:
+	void merge(size_t p_size) {
+		std::sort(m_ranges.begin(), m_ranges.end(), [](const Range& a, const Range& b) { return a.begin < b.begin; });
+		size_t out = 0;
+		for (size_t i = 0; i < m_ranges.size(); i++) {
+			Range range = m_ranges[i];
+			range.end = std::min(range.end, p_size);
+			if (range.begin >= range.end) continue;
+			if (out > 0 && range.begin <= m_ranges[out - 1].end + m_mergeGap) {
+				m_ranges[out - 1].end = std::max(m_ranges[out - 1].end, range.end);
+				continue;
+			}
+			m_ranges[out++] = range;
+		}
+		m_ranges.resize(out);
+		if (m_ranges.size() > MAX_RANGES) m_ranges.assign(1, { m_ranges.front().begin, m_ranges.back().end });
+	}
+
+	std::vector<Range> m_ranges;
+	size_t m_mergeGap;
+	bool m_all = false;
+};
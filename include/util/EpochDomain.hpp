@@ -0,0 +1,157 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <stdexcept>
+#include <stdint.h>
+#include "Framework/Log.hpp"
+
+// Epoch based reclamation, for data structures where readers must never wait on or write to anything shared.
+// A reader pins itself before touching shared pointers and unpins after. Pinning only writes to a slot owned by the
+// calling thread, so readers on different cores never fight over a cache line.
+// Writers retire old objects instead of deleting them, and a retired object is only freed once every reader that was
+// pinned when it got retired has unpinned again.
+// A domain has to outlive every thread that has read through it, which is easiest if you just use Get().
+class EpochDomain {
+public:
+	static constexpr size_t MAX_READER_THREADS = 256;
+
+	EpochDomain() {}
+	EpochDomain(const EpochDomain& other) = delete;
+	EpochDomain& operator=(const EpochDomain& other) = delete;
+	~EpochDomain() {
+		// nobody can be reading anymore
+		for (auto& retired : m_retired) retired.deleter();
+	}
+
+	// Keeps everything retired from here on alive until it goes out of scope. Nests fine.
+	class Guard {
+	public:
+		Guard(EpochDomain& p_domain) : m_domain(p_domain) {
+			m_domain.pin();
+		}
+		Guard(const Guard& other) = delete;
+		Guard& operator=(const Guard& other) = delete;
+		~Guard() {
+			m_domain.unpin();
+		}
+	private:
+		EpochDomain& m_domain;
+	};
+
+	void pin() {
+		ThreadSlot& local = localSlot();
+		if (local.depth++ > 0) return;
+		Slot& slot = m_slots[local.index];
+		slot.epoch.store(m_globalEpoch.load(std::memory_order_acquire), std::memory_order_relaxed);
+		// pairs with the fence in collect(), either the writer sees us pinned or we see its new pointer
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+	}
+	void unpin() {
+		ThreadSlot& local = localSlot();
+		if (--local.depth > 0) return;
+		m_slots[local.index].epoch.store(0, std::memory_order_release);
+	}
+
+	// Hands p_deleter over to be called once no reader could still be looking at whatever it frees.
+	// Call it after the object has been unlinked from everything readers can reach. p_deleter can't retire anything itself.
+	void retire(std::function<void()> p_deleter) {
+		std::unique_lock<std::mutex> lock(m_retireMutex);
+		m_retired.push_back({ m_globalEpoch.load(), std::move(p_deleter) });
+		m_globalEpoch.fetch_add(1);
+		collectLocked();
+	}
+	template<typename T>
+	void retire(const T* p_object) {
+		retire([p_object] { delete p_object; });
+	}
+
+	// Frees whatever it safely can. retire() does this too, so it's only needed to clean up after the last write.
+	void collect() {
+		std::unique_lock<std::mutex> lock(m_retireMutex);
+		collectLocked();
+	}
+
+	size_t pendingCount() {
+		std::unique_lock<std::mutex> lock(m_retireMutex);
+		return m_retired.size();
+	}
+
+	static EpochDomain& Get() {
+		static EpochDomain instance;
+		return instance;
+	}
+private:
+	struct alignas(64) Slot {
+		// 0 while the owning thread isn't reading, otherwise the epoch it pinned at
+		std::atomic<uint64_t> epoch{ 0 };
+		std::atomic<bool> claimed{ false };
+	};
+	struct Retired {
+		uint64_t epoch;
+		std::function<void()> deleter;
+	};
+	// Which slot this thread owns in one domain. Handed back when the thread exits.
+	struct ThreadSlot {
+		EpochDomain* domain = nullptr;
+		size_t index = 0;
+		uint32_t depth = 0;
+
+		~ThreadSlot() {
+			if (domain) domain->m_slots[index].claimed.store(false, std::memory_order_release);
+		}
+	};
+	struct ThreadSlots {
+		// a deque so handing out references is safe while it grows
+		std::deque<ThreadSlot> slots;
+	};
+
+	ThreadSlot& localSlot() {
+		// a thread usually only ever reads through one or two domains, so a short list is fine
+		thread_local ThreadSlots t_slots;
+		for (ThreadSlot& slot : t_slots.slots) {
+			if (slot.domain == this) return slot;
+		}
+		for (size_t i = 0; i < MAX_READER_THREADS; i++) {
+			bool expected = false;
+			if (m_slots[i].claimed.load(std::memory_order_relaxed)) continue;
+			if (!m_slots[i].claimed.compare_exchange_strong(expected, true)) continue;
+			ThreadSlot& slot = t_slots.slots.emplace_back();
+			slot.domain = this;
+			slot.index = i;
+			return slot;
+		}
+		ERROR_LOG("More than " << MAX_READER_THREADS << " threads tried to read from the same epoch domain.");
+		throw std::runtime_error("Out of epoch reader slots");
+	}
+
+	// must hold m_retireMutex
+	void collectLocked() {
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		uint64_t oldestPinned = UINT64_MAX;
+		for (Slot& slot : m_slots) {
+			uint64_t epoch = slot.epoch.load(std::memory_order_acquire);
+			if (epoch != 0 && epoch < oldestPinned) oldestPinned = epoch;
+		}
+		// anything retired before the oldest pinned reader showed up can't be seen by anyone anymore
+		size_t kept = 0;
+		for (size_t i = 0; i < m_retired.size(); i++) {
+			if (m_retired[i].epoch < oldestPinned) {
+				m_retired[i].deleter();
+			}
+			else {
+				if (kept != i) m_retired[kept] = std::move(m_retired[i]);
+				kept++;
+			}
+		}
+		m_retired.resize(kept);
+	}
+
+	// starts at 1 so 0 can mean "not pinned"
+	alignas(64) std::atomic<uint64_t> m_globalEpoch{ 1 };
+	Slot m_slots[MAX_READER_THREADS];
+	std::mutex m_retireMutex;
+	std::vector<Retired> m_retired;
+};
@@ -0,0 +1,131 @@
+#pragma once
+#include <algorithm>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// Quick and dirty LZ77 block compressor in the LZ4 block format, for when shaving bytes is worth a few microseconds
+// but not more. One pass with a small hash table, no entropy coding, and decompressing is mostly memcpy.
+// Does well on the kind of repetitive data we send around (lots of similar structs, zeroes, ids), badly on anything random.
+// Nothing here allocates, the caller owns both buffers.
+struct FastCompress {
+	static constexpr size_t MIN_MATCH = 4;
+	static constexpr size_t MAX_OFFSET = 65535;
+	static constexpr int HASH_BITS = 12;
+
+	// Biggest output compress() can ever produce for p_size bytes of input.
+	static constexpr size_t compressBound(size_t p_size) {
+		return p_size + p_size / 255 + 16;
+	}
+
+	// Returns the compressed size, or 0 if it wouldn't fit in p_capacity bytes.
+	// Passing a capacity smaller than the input is a cheap way of asking for "only if it actually gets smaller".
+	static size_t compress(const uint8_t* p_src, size_t p_size, uint8_t* p_dst, size_t p_capacity) {
+		uint32_t table[1 << HASH_BITS] = {};
+		size_t ip = 0, anchor = 0, op = 0;
+		// the format wants the last match to start 12 bytes from the end and the last 5 bytes to be literals
+		if (p_size > 12) {
+			size_t matchLimit = p_size - 12;
+			size_t matchEnd = p_size - 5;
+			while (ip < matchLimit) {
+				uint32_t sequence = read32(p_src + ip);
+				uint32_t& slot = table[hash(sequence)];
+				size_t candidate = slot;
+				slot = (uint32_t)ip;
+				if (candidate < ip && ip - candidate <= MAX_OFFSET && read32(p_src + candidate) == sequence) {
+					size_t length = MIN_MATCH;
+					while (ip + length < matchEnd && p_src[candidate + length] == p_src[ip + length]) length++;
+					if (!emit(p_src + anchor, ip - anchor, ip - candidate, length, p_dst, p_capacity, op)) return 0;
+					ip += length;
+					anchor = ip;
+				}
+				else {
+					// skip ahead faster the longer we go without finding anything
+					ip += 1 + ((ip - anchor) >> 6);
+				}
+			}
+		}
+		if (!emit(p_src + anchor, p_size - anchor, 0, 0, p_dst, p_capacity, op)) return 0;
+		return op;
+	}
+
+	// Expands exactly p_rawSize bytes into p_dst. Returns false if the input is garbled in any way,
+	// it never reads or writes outside the buffers it was given.
+	static bool decompress(const uint8_t* p_src, size_t p_size, uint8_t* p_dst, size_t p_rawSize) {
+		size_t ip = 0, op = 0;
+		while (ip < p_size) {
+			uint8_t token = p_src[ip++];
+			size_t literals = token >> 4;
+			if (literals == 15 && !readLength(p_src, p_size, ip, literals)) return false;
+			if (literals > p_size - ip || literals > p_rawSize - op) return false;
+			if (literals) memcpy(p_dst + op, p_src + ip, literals);
+			ip += literals;
+			op += literals;
+			// the last sequence is just literals
+			if (ip == p_size) break;
+
+			if (p_size - ip < 2) return false;
+			size_t offset = p_src[ip] | (p_src[ip + 1] << 8);
+			ip += 2;
+			if (offset == 0 || offset > op) return false;
+			size_t length = token & 15;
+			if (length == 15 && !readLength(p_src, p_size, ip, length)) return false;
+			length += MIN_MATCH;
+			if (length > p_rawSize - op) return false;
+			const uint8_t* match = p_dst + op - offset;
+			if (offset >= length) {
+				memcpy(p_dst + op, match, length);
+			}
+			else {
+				// overlapping, repeats the last offset bytes
+				for (size_t i = 0; i < length; i++) p_dst[op + i] = match[i];
+			}
+			op += length;
+		}
+		return op == p_rawSize;
+	}
+private:
+	static uint32_t read32(const uint8_t* p_src) {
+		uint32_t value;
+		memcpy(&value, p_src, sizeof(value));
+		return value;
+	}
+	static uint32_t hash(uint32_t p_sequence) {
+		return (p_sequence * 2654435761u) >> (32 - HASH_BITS);
+	}
+
+	// One sequence: a token, the literals, then the match. A length of 0 means literals only.
+	static bool emit(const uint8_t* p_literals, size_t p_literalCount, size_t p_offset, size_t p_length, uint8_t* p_dst, size_t p_capacity, size_t& o_op) {
+		size_t matchExtra = p_length ? p_length - MIN_MATCH : 0;
+		size_t worstCase = 1 + p_literalCount / 255 + 1 + p_literalCount + 2 + matchExtra / 255 + 1;
+		if (o_op > p_capacity || worstCase > p_capacity - o_op) return false;
+		uint8_t& token = p_dst[o_op++];
+		token = uint8_t(std::min<size_t>(p_literalCount, 15) << 4);
+		if (p_literalCount >= 15) writeLength(p_literalCount - 15, p_dst, o_op);
+		// empty input has no literals and may well be a null pointer, which memcpy doesn't allow even for 0 bytes
+		if (p_literalCount) memcpy(p_dst + o_op, p_literals, p_literalCount);
+		o_op += p_literalCount;
+		if (!p_length) return true;
+		p_dst[o_op++] = uint8_t(p_offset);
+		p_dst[o_op++] = uint8_t(p_offset >> 8);
+		token |= uint8_t(std::min<size_t>(matchExtra, 15));
+		if (matchExtra >= 15) writeLength(matchExtra - 15, p_dst, o_op);
+		return true;
+	}
+	static void writeLength(size_t p_length, uint8_t* p_dst, size_t& o_op) {
+		while (p_length >= 255) {
+			p_dst[o_op++] = 255;
+			p_length -= 255;
+		}
+		p_dst[o_op++] = uint8_t(p_length);
+	}
+	static bool readLength(const uint8_t* p_src, size_t p_size, size_t& o_ip, size_t& o_length) {
+		uint8_t byte;
+		do {
+			if (o_ip >= p_size) return false;
+			byte = p_src[o_ip++];
+			o_length += byte;
+		} while (byte == 255);
+		return true;
+	}
+};
@@ -0,0 +1,243 @@
+#pragma once
+#include <atomic>
+#include <vector>
+#include <memory_resource>
+#include <algorithm>
+#include <new>
+#include <utility>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Framework/Log.hpp"
+
+// Bump allocator for stuff that only has to live until the end of the frame.
+// Allocating is a pointer bump, freeing does nothing, and everything is thrown away at once by reset().
+// Every thread gets its own through local(), and GameWindow::displayNewFrame() calls endFrame() which resets them all:
+// the calling thread's straight away, every other thread's at the start of the next Scope it enters. ThreadPool runs every
+// task inside a Scope, so a worker's arena is only ever reset between tasks, never under one that's still running.
+// Threads outside a pool that don't use Scope get reset the next time they allocate.
+// So nothing allocated from a frame arena can be held past displayNewFrame() (or past the end of the task it came from,
+// on a worker), and nothing that outlives the frame should go in one.
+// In debug builds, memory gets poisoned with 0xDD when it's released, and freeing something from an earlier frame
+// prints a warning, which is how things that escaped their frame get caught.
+// Use resource() to put a std::pmr container on it.
+class FrameArena {
+public:
+	static constexpr size_t DEFAULT_CHUNK_SIZE = size_t(256) << 10;
+	static constexpr unsigned char POISON = 0xDD;
+
+	FrameArena(size_t p_chunkSize = DEFAULT_CHUNK_SIZE) : m_chunkSize(p_chunkSize) {}
+	FrameArena(const FrameArena& other) = delete;
+	FrameArena& operator=(const FrameArena& other) = delete;
+	~FrameArena() {
+		for (Chunk& chunk : m_chunks) free(chunk.memory);
+	}
+
+	void* allocate(size_t p_bytes, size_t p_align = alignof(std::max_align_t)) {
+		if (m_scopeDepth == 0) syncFrame();
+#ifdef _DEBUG
+		// room in front to remember which frame this came from
+		size_t align = std::max(p_align, alignof(DebugHeader));
+		size_t headerSpace = std::max(sizeof(DebugHeader), align);
+		unsigned char* memory = bump(p_bytes + headerSpace, align) + headerSpace;
+		DebugHeader* header = reinterpret_cast<DebugHeader*>(memory - sizeof(DebugHeader));
+		header->resetCount = m_resetCount;
+		header->bytes = p_bytes;
+		return memory;
+#else
+		return bump(p_bytes, p_align);
+#endif
+	}
+	// Uninitialized space for p_count T's.
+	template<typename T>
+	T* allocateArray(size_t p_count) {
+		return static_cast<T*>(allocate(sizeof(T) * p_count, alignof(T)));
+	}
+	// The destructor never runs, so only put things in here that don't need it to.
+	template<typename T, typename... Args>
+	T* make(Args&&... p_args) {
+		return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(p_args)...);
+	}
+
+	// Frees nothing, it's only here so debug builds can catch memory that outlived its frame.
+	void release(void* p_memory) {
+#ifdef _DEBUG
+		if (!p_memory || !owns(p_memory)) return;
+		DebugHeader* header = reinterpret_cast<DebugHeader*>(static_cast<unsigned char*>(p_memory) - sizeof(DebugHeader));
+		if (header->resetCount != m_resetCount) {
+			// the header may well be poison by now, so all we know is that it's not from this frame
+			WARNING_LOG("Frame arena memory was freed after its frame ended. Something is holding frame memory past displayNewFrame().");
+			return;
+		}
+		memset(p_memory, POISON, header->bytes);
+#else
+		(void)p_memory;
+#endif
+	}
+
+	// Throws away everything allocated since the last reset.
+	void reset() {
+		m_highWaterMark = std::max(m_highWaterMark, m_frameBytes);
+		size_t globalMark = s_globalHighWaterMark.load(std::memory_order_relaxed);
+		while (globalMark < m_highWaterMark && !s_globalHighWaterMark.compare_exchange_weak(globalMark, m_highWaterMark, std::memory_order_relaxed)) {}
+#ifdef _DEBUG
+		for (size_t i = 0; i <= m_currentChunk && i < m_chunks.size(); i++) memset(m_chunks[i].memory, POISON, m_chunks[i].used);
+#endif
+		// a frame that spilled into several chunks gets one big enough for all of it next time
+		if (m_currentChunk > 0) {
+			size_t total = 0;
+			for (Chunk& chunk : m_chunks) {
+				total += chunk.size;
+				free(chunk.memory);
+			}
+			m_chunks.clear();
+			addChunk(total);
+		}
+		for (Chunk& chunk : m_chunks) chunk.used = 0;
+		m_currentChunk = 0;
+		m_frameBytes = 0;
+		m_resetCount++;
+		m_frame = s_globalFrame.load(std::memory_order_acquire);
+	}
+
+	bool owns(const void* p_memory) const {
+		for (const Chunk& chunk : m_chunks) {
+			if (p_memory >= chunk.memory && p_memory < chunk.memory + chunk.size) return true;
+		}
+		return false;
+	}
+	// Bytes handed out since the last reset, alignment padding included.
+	size_t bytesUsed() const {
+		return m_frameBytes;
+	}
+	size_t capacity() const {
+		size_t total = 0;
+		for (const Chunk& chunk : m_chunks) total += chunk.size;
+		return total;
+	}
+	// The most any single frame has used in this arena. Size DEFAULT_CHUNK_SIZE off of this.
+	size_t highWaterMark() const {
+		return std::max(m_highWaterMark, m_frameBytes);
+	}
+
+	// This thread's arena.
+	static FrameArena& local() {
+		thread_local FrameArena t_arena(DEFAULT_CHUNK_SIZE, true);
+		return t_arena;
+	}
+	// Ends the frame for every thread's local() arena. Called by GameWindow::displayNewFrame().
+	static void endFrame() {
+		s_globalFrame.fetch_add(1, std::memory_order_acq_rel);
+		// inside a Scope it waits for the next one, like everybody else
+		FrameArena& arena = local();
+		if (arena.m_scopeDepth == 0) arena.reset();
+	}
+	static uint64_t frameIndex() {
+		return s_globalFrame.load(std::memory_order_acquire);
+	}
+	// Highest highWaterMark() of any arena, as of their last reset.
+	static size_t globalHighWaterMark() {
+		return s_globalHighWaterMark.load(std::memory_order_relaxed);
+	}
+
+	// Keeps this thread's local() arena on one frame for as long as it's alive. If a frame ended since the arena was last
+	// reset, it's reset when the scope starts, and never while it's open. Scopes nest, only the outermost one counts.
+	// A task that's still running when displayNewFrame() happens keeps its memory until it finishes, so long running
+	// background tasks should keep what they allocate in here small.
+	class Scope {
+	public:
+		Scope() : m_arena(local()) {
+			if (m_arena.m_scopeDepth++ == 0) m_arena.syncFrame();
+		}
+		~Scope() {
+			m_arena.m_scopeDepth--;
+		}
+		Scope(const Scope& other) = delete;
+		Scope& operator=(const Scope& other) = delete;
+	private:
+		FrameArena& m_arena;
+	};
+
+	// Hands out memory from whichever thread's local() arena is asking.
+	class Resource : public std::pmr::memory_resource {
+	protected:
+		void* do_allocate(size_t p_bytes, size_t p_align) override {
+			return local().allocate(p_bytes, p_align);
+		}
+		void do_deallocate(void* p_memory, size_t /*p_bytes*/, size_t /*p_align*/) override {
+			local().release(p_memory);
+		}
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+			return this == &other;
+		}
+	};
+	// e.g. std::pmr::vector<Vertex> verts(FrameArena::resource());
+	static std::pmr::memory_resource* resource() {
+		static Resource instance;
+		return &instance;
+	}
+private:
+	struct Chunk {
+		unsigned char* memory;
+		size_t size;
+		size_t used;
+	};
+#ifdef _DEBUG
+	struct DebugHeader {
+		uint64_t resetCount;
+		size_t bytes;
+	};
+#endif
+
+	FrameArena(size_t p_chunkSize, bool p_followsGlobalFrame) : m_chunkSize(p_chunkSize), m_followsGlobalFrame(p_followsGlobalFrame) {
+		m_frame = s_globalFrame.load(std::memory_order_acquire);
+	}
+
+	void syncFrame() {
+		if (m_followsGlobalFrame && m_frame != s_globalFrame.load(std::memory_order_acquire)) reset();
+	}
+	unsigned char* bump(size_t p_bytes, size_t p_align) {
+		while (true) {
+			if (m_currentChunk < m_chunks.size()) {
+				Chunk& chunk = m_chunks[m_currentChunk];
+				uintptr_t base = reinterpret_cast<uintptr_t>(chunk.memory);
+				size_t start = ((base + chunk.used + p_align - 1) & ~(uintptr_t)(p_align - 1)) - base;
+				if (start + p_bytes <= chunk.size) {
+					m_frameBytes += start + p_bytes - chunk.used;
+					chunk.used = start + p_bytes;
+					return chunk.memory + start;
+				}
+				// doesn't fit, so the rest of this chunk is wasted until the reset
+				if (m_currentChunk + 1 < m_chunks.size()) {
+					m_currentChunk++;
+					continue;
+				}
+			}
+			addChunk(std::max(m_chunkSize, p_bytes + p_align));
+			m_currentChunk = m_chunks.size() - 1;
+		}
+	}
+	void addChunk(size_t p_size) {
+		unsigned char* memory = static_cast<unsigned char*>(malloc(p_size));
+		if (!memory) {
+			ERROR_LOG("Frame arena failed to allocate a " << p_size << " byte chunk.");
+			throw std::bad_alloc();
+		}
+		m_chunks.push_back({ memory, p_size, 0 });
+	}
+
+	std::vector<Chunk> m_chunks;
+	size_t m_currentChunk = 0;
+	size_t m_chunkSize;
+	size_t m_frameBytes = 0;
+	size_t m_highWaterMark = 0;
+	uint64_t m_resetCount = 0;
+	// the global frame this arena was last reset for
+	uint64_t m_frame = 0;
+	bool m_followsGlobalFrame = false;
+	// open Scopes on this thread
+	uint32_t m_scopeDepth = 0;
+
+	static inline std::atomic<uint64_t> s_globalFrame{ 0 };
+	static inline std::atomic<size_t> s_globalHighWaterMark{ 0 };
+};
@@ -2,7 +2,13 @@
 
 #include <iostream>
 #include <vector>
+#include <span>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
 #include <stdint.h>
+#include "Framework/Log.hpp"
 
 // for future internal/external networking
 namespace net {
@@ -31,6 +37,8 @@ namespace net {
 			return p_os;
 		}
 
+		// These two work like a stack, >> pops the last thing << pushed. MessageWriter and MessageReader go front to back
+		// and are a lot cheaper when there's more than a couple of fields.
 		template <typename t_InputType>
 		friend Message<T>& operator << (Message<T>& p_msg, const t_InputType& p_data) {
 			static_assert(std::is_standard_layout<t_InputType>::value, "Cannot serialize message input. Too complex.");
@@ -64,4 +72,186 @@ namespace net {
 	};
 
 
+	// Appends to a message's body front to back. Grows the body in big steps and only trims it to size in finish(),
+	// instead of resizing the vector for every field like operator << does. Read it back in the same order with MessageReader.
+	// Pass a reserve size up front when you know roughly how big the message will be and it never has to grow at all.
+	template <typename T>
+	class MessageWriter
+	{
+	public:
+		MessageWriter(Message<T>& p_msg, size_t p_reserveBytes = 0) : m_msg(p_msg), m_pos(p_msg.body.size()) {
+			ensure(p_reserveBytes);
+		}
+		MessageWriter(const MessageWriter<T>& other) = delete;
+		MessageWriter<T>& operator=(const MessageWriter<T>& other) = delete;
+		~MessageWriter() {
+			finish();
+		}
+
+		template <typename t_InputType>
+		MessageWriter<T>& write(const t_InputType& p_data) {
+			static_assert(std::is_trivially_copyable<t_InputType>::value, "Cannot serialize message input. Too complex.");
+			writeBytes(&p_data, sizeof(t_InputType));
+			return *this;
+		}
+		template <typename t_InputType>
+		MessageWriter<T>& operator << (const t_InputType& p_data) {
+			return write(p_data);
+		}
+		MessageWriter<T>& writeBytes(const void* p_data, size_t p_bytes) {
+			ensure(p_bytes);
+			std::memcpy(m_msg.body.data() + m_pos, p_data, p_bytes);
+			m_pos += p_bytes;
+			return *this;
+		}
+
+		// 7 bits a byte, high bit set when there's more. Small numbers (counts, ids, most deltas) take one or two bytes instead of eight.
+		MessageWriter<T>& writeVarint(uint64_t p_value) {
+			ensure(10);
+			uint8_t* out = m_msg.body.data() + m_pos;
+			while (p_value >= 0x80) {
+				*out++ = uint8_t(p_value) | 0x80;
+				p_value >>= 7;
+			}
+			*out++ = uint8_t(p_value);
+			m_pos = out - m_msg.body.data();
+			return *this;
+		}
+		// Maps small negative numbers to small positive ones first (0, -1, 1, -2 -> 0, 1, 2, 3) so they stay short too.
+		MessageWriter<T>& writeZigzag(int64_t p_value) {
+			return writeVarint((uint64_t(p_value) << 1) ^ uint64_t(p_value >> 63));
+		}
+
+		// A varint count followed by every element in one copy.
+		template <typename t_InputType>
+		MessageWriter<T>& writeArray(std::span<const t_InputType> p_values) {
+			static_assert(std::is_trivially_copyable<t_InputType>::value, "Cannot serialize message input. Too complex.");
+			writeVarint(p_values.size());
+			return writeBytes(p_values.data(), p_values.size_bytes());
+		}
+		template <typename t_InputType>
+		MessageWriter<T>& writeArray(const std::vector<t_InputType>& p_values) {
+			return writeArray(std::span<const t_InputType>(p_values));
+		}
+
+		// Bytes written so far, including whatever was already in the body.
+		size_t size() const {
+			return m_pos;
+		}
+		// Trims the body down to what was written and fixes up the header. The destructor calls it too.
+		void finish() {
+			m_msg.body.resize(m_pos);
+			m_msg.header.size = (uint32_t)m_msg.size();
+		}
+	private:
+		void ensure(size_t p_bytes) {
+			if (m_pos + p_bytes <= m_msg.body.size()) return;
+			m_msg.body.resize(std::max(m_pos + p_bytes, m_msg.body.size() * 2));
+		}
+
+		Message<T>& m_msg;
+		size_t m_pos;
+	};
+
+	// Reads a message body front to back without copying or changing it. It only points at the bytes,
+	// so the message has to outlive the reader and not change underneath it.
+	// Reading past the end throws std::out_of_range, so a truncated or garbled message can't read random memory.
+	class MessageReader
+	{
+	public:
+		MessageReader(std::span<const uint8_t> p_data) : m_data(p_data) {}
+		template <typename T>
+		MessageReader(const Message<T>& p_msg) : m_data(p_msg.body) {}
+
+		template <typename t_OutputType>
+		MessageReader& read(t_OutputType& o_data) {
+			static_assert(std::is_trivially_copyable<t_OutputType>::value, "Cannot serialize message output. Too complex.");
+			std::memcpy(&o_data, take(sizeof(t_OutputType)), sizeof(t_OutputType));
+			return *this;
+		}
+		template <typename t_OutputType>
+		t_OutputType read() {
+			t_OutputType data;
+			read(data);
+			return data;
+		}
+		template <typename t_OutputType>
+		MessageReader& operator >> (t_OutputType& o_data) {
+			return read(o_data);
+		}
+		// Points straight into the message, nothing gets copied.
+		std::span<const uint8_t> readBytes(size_t p_bytes) {
+			return { take(p_bytes), p_bytes };
+		}
+
+		uint64_t readVarint() {
+			uint64_t value = 0;
+			for (int shift = 0; shift < 64; shift += 7) {
+				uint8_t byte = *take(1);
+				value |= uint64_t(byte & 0x7F) << shift;
+				if (!(byte & 0x80)) return value;
+			}
+			ERROR_LOG("Message varint is longer than 10 bytes, the message is garbled.");
+			throw std::out_of_range("Bad varint in message");
+		}
+		int64_t readZigzag() {
+			uint64_t value = readVarint();
+			return int64_t(value >> 1) ^ -int64_t(value & 1);
+		}
+
+		// Reads something written by writeArray(). Returns how many elements were read, and throws if o_values is too small for them.
+		template <typename t_OutputType>
+		size_t readArray(std::span<t_OutputType> o_values) {
+			static_assert(std::is_trivially_copyable<t_OutputType>::value, "Cannot serialize message output. Too complex.");
+			size_t count = readArrayCount<t_OutputType>();
+			if (count > o_values.size()) {
+				ERROR_LOG("Message array has " << count << " elements but there's only room for " << o_values.size() << ".");
+				throw std::out_of_range("Message array too big");
+			}
+			std::memcpy(o_values.data(), take(count * sizeof(t_OutputType)), count * sizeof(t_OutputType));
+			return count;
+		}
+		template <typename t_OutputType>
+		MessageReader& readArray(std::vector<t_OutputType>& o_values) {
+			static_assert(std::is_trivially_copyable<t_OutputType>::value, "Cannot serialize message output. Too complex.");
+			size_t count = readArrayCount<t_OutputType>();
+			o_values.resize(count);
+			std::memcpy(o_values.data(), take(count * sizeof(t_OutputType)), count * sizeof(t_OutputType));
+			return *this;
+		}
+
+		size_t position() const {
+			return m_pos;
+		}
+		size_t remaining() const {
+			return m_data.size() - m_pos;
+		}
+		bool atEnd() const {
+			return m_pos == m_data.size();
+		}
+	private:
+		const uint8_t* take(size_t p_bytes) {
+			if (p_bytes > remaining()) {
+				ERROR_LOG("Tried to read " << p_bytes << " bytes from a message with " << remaining() << " left.");
+				throw std::out_of_range("Read past the end of a message");
+			}
+			const uint8_t* data = m_data.data() + m_pos;
+			m_pos += p_bytes;
+			return data;
+		}
+		// the count is checked against what's left before anything gets sized off of it
+		template <typename t_OutputType>
+		size_t readArrayCount() {
+			uint64_t count = readVarint();
+			if (count > remaining() / sizeof(t_OutputType)) {
+				ERROR_LOG("Message array claims " << count << " elements but there are only " << remaining() << " bytes left.");
+				throw std::out_of_range("Message array runs past the end");
+			}
+			return (size_t)count;
+		}
+
+		std::span<const uint8_t> m_data;
+		size_t m_pos = 0;
+	};
+
 }
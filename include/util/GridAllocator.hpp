@@ -0,0 +1,91 @@
+#pragma once
+#include <stdint.h>
+#include <stdlib.h>
+#include <new>
+#include <numeric>
+#include <algorithm>
+#include "Framework/Log.hpp"
+#ifdef _WIN32
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
+
+class ThreadPool;
+
+// How StaticArray2D and StaticArray3D should set up memory they allocate themselves.
+struct GridAllocOptions {
+	// Asks the OS to back the grid with 2MB pages, so a big grid needs a few dozen TLB entries instead of tens of thousands.
+	// Only does anything on Linux (madvise) for now, Windows needs SeLockMemoryPrivilege for large pages.
+	bool hugePages = false;
+	// If set, the first write to every page is spread across this pool the same way ArrayOps splits work,
+	// so on a NUMA machine each part of the grid ends up on the node of the thread that'll be working on it.
+	ThreadPool* firstTouchPool = nullptr;
+	// Rows are padded to a multiple of this many elements too, e.g. the channel count for pixel data,
+	// so the pitch can be handed to GL as a whole number of pixels.
+	size_t pitchMultiple = 1;
+};
+
+// What the static arrays always did: memory comes from malloc (usually from someone else) and goes back with free.
+// Rows are packed, pitch is always the width.
+struct MallocGridAllocator {
+	static size_t pitchFor(size_t p_width, size_t /*p_elementSize*/, const GridAllocOptions& /*p_options*/) {
+		return p_width;
+	}
+	static void* allocate(size_t p_bytes, const GridAllocOptions& /*p_options*/) {
+		void* memory = malloc(p_bytes);
+		if (!memory && p_bytes) {
+			ERROR_LOG("Failed to allocate " << p_bytes << " bytes for a static array.");
+			throw std::bad_alloc();
+		}
+		return memory;
+	}
+	static void release(void* p_memory) {
+		free(p_memory);
+	}
+};
+
+// Every row starts on a 64 byte boundary, so rows line up with cache lines and SIMD loads never split one.
+// The pitch gets padded to make that work, so index with pitch rather than width.
+// Memory has to come from allocate(), setData() with memory from anywhere else would be freed wrong.
+struct AlignedGridAllocator {
+	static constexpr size_t ROW_ALIGNMENT = 64;
+	static constexpr size_t HUGE_PAGE_SIZE = size_t(2) << 20;
+
+	static size_t pitchFor(size_t p_width, size_t p_elementSize, const GridAllocOptions& p_options) {
+		// fewest elements that add up to a whole number of alignment steps
+		size_t step = ROW_ALIGNMENT / std::gcd(ROW_ALIGNMENT, p_elementSize);
+		step = std::lcm(step, std::max<size_t>(1, p_options.pitchMultiple));
+		return (p_width + step - 1) / step * step;
+	}
+	static void* allocate(size_t p_bytes, const GridAllocOptions& p_options) {
+		// anything smaller than one huge page can't use one anyway
+		bool hugePages = p_options.hugePages && p_bytes >= HUGE_PAGE_SIZE;
+		size_t alignment = hugePages ? HUGE_PAGE_SIZE : ROW_ALIGNMENT;
+		size_t size = (std::max<size_t>(p_bytes, 1) + alignment - 1) / alignment * alignment;
+#ifdef _WIN32
+		void* memory = _aligned_malloc(size, alignment);
+#else
+		void* memory = nullptr;
+		if (posix_memalign(&memory, alignment, size) != 0) memory = nullptr;
+#endif
+		if (!memory) {
+			ERROR_LOG("Failed to allocate " << size << " aligned bytes for a static array.");
+			throw std::bad_alloc();
+		}
+#ifdef MADV_HUGEPAGE
+		// only a hint, transparent huge pages might be turned off
+		if (hugePages && madvise(memory, size, MADV_HUGEPAGE) != 0) {
+			WARNING_LOG("madvise(MADV_HUGEPAGE) failed, the grid will use regular pages.");
+		}
+#endif
+		return memory;
+	}
+	static void release(void* p_memory) {
+#ifdef _WIN32
+		_aligned_free(p_memory);
+#else
+		free(p_memory);
+#endif
+	}
+};
@@ -0,0 +1,107 @@
+#pragma once
+#include <new>
+#include <utility>
+#include <cstddef>
+#include <type_traits>
+
+template<size_t Capacity = 64>
+// A move-only void() callable that keeps the closure inside itself instead of on the heap.
+// Closures bigger than Capacity (or ones that could throw while moving) still work, they just spill to the heap.
+// Basically a std::function that can't be copied, which is exactly what a task queue needs.
+class InplaceTask {
+public:
+	InplaceTask() {}
+	template<typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, InplaceTask>>>
+	InplaceTask(F&& p_fn) {
+		emplace(std::forward<F>(p_fn));
+	}
+	InplaceTask(const InplaceTask& other) = delete;
+	InplaceTask(InplaceTask&& other) noexcept {
+		moveFrom(other);
+	}
+	InplaceTask& operator=(const InplaceTask& other) = delete;
+	InplaceTask& operator=(InplaceTask&& other) noexcept {
+		if (this != &other) {
+			reset();
+			moveFrom(other);
+		}
+		return *this;
+	}
+	~InplaceTask() {
+		reset();
+	}
+
+	template<typename F>
+	void emplace(F&& p_fn) {
+		using Fn = std::decay_t<F>;
+		reset();
+		if constexpr (fitsInline<Fn>) {
+			new (m_storage) Fn(std::forward<F>(p_fn));
+			m_ops = &s_inlineOps<Fn>;
+		}
+		else {
+			*reinterpret_cast<Fn**>(m_storage) = new Fn(std::forward<F>(p_fn));
+			m_ops = &s_heapOps<Fn>;
+		}
+	}
+
+	void operator()() {
+		m_ops->invoke(m_storage);
+	}
+	explicit operator bool() const {
+		return m_ops != nullptr;
+	}
+	// False if the closure had to go on the heap.
+	bool storedInline() const {
+		return m_ops && !m_ops->heap;
+	}
+	void reset() {
+		if (!m_ops) return;
+		m_ops->destroy(m_storage);
+		m_ops = nullptr;
+	}
+
+	template<typename Fn>
+	static constexpr bool fitsInline = sizeof(Fn) <= Capacity && alignof(Fn) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible_v<Fn>;
+private:
+	struct Ops {
+		void (*invoke)(void*);
+		// move constructs into the first pointer and destroys the second
+		void (*relocate)(void*, void*);
+		void (*destroy)(void*);
+		bool heap;
+	};
+
+	template<typename Fn>
+	static void invokeInline(void* p_storage) { (*static_cast<Fn*>(p_storage))(); }
+	template<typename Fn>
+	static void relocateInline(void* p_dst, void* p_src) {
+		new (p_dst) Fn(std::move(*static_cast<Fn*>(p_src)));
+		static_cast<Fn*>(p_src)->~Fn();
+	}
+	template<typename Fn>
+	static void destroyInline(void* p_storage) { static_cast<Fn*>(p_storage)->~Fn(); }
+
+	template<typename Fn>
+	static void invokeHeap(void* p_storage) { (**static_cast<Fn**>(p_storage))(); }
+	static void relocateHeap(void* p_dst, void* p_src) {
+		*static_cast<void**>(p_dst) = *static_cast<void**>(p_src);
+	}
+	template<typename Fn>
+	static void destroyHeap(void* p_storage) { delete *static_cast<Fn**>(p_storage); }
+
+	template<typename Fn>
+	inline static constexpr Ops s_inlineOps{ &invokeInline<Fn>, &relocateInline<Fn>, &destroyInline<Fn>, false };
+	template<typename Fn>
+	inline static constexpr Ops s_heapOps{ &invokeHeap<Fn>, &relocateHeap, &destroyHeap<Fn>, true };
+
+	void moveFrom(InplaceTask& other) {
+		if (!other.m_ops) return;
+		other.m_ops->relocate(m_storage, other.m_storage);
+		m_ops = other.m_ops;
+		other.m_ops = nullptr;
+	}
+
+	alignas(std::max_align_t) unsigned char m_storage[Capacity < sizeof(void*) ? sizeof(void*) : Capacity];
+	const Ops* m_ops = nullptr;
+};
@@ -0,0 +1,277 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <new>
+#include <thread>
+#include <utility>
+#include <iterator>
+#include <optional>
+#include <cstddef>
+#include <stdint.h>
+
+template<typename T>
+// Bounded lock-free multi producer multi consumer queue, after Dmitry Vyukov's design.
+// Every cell carries a sequence number that says whose turn it is: a producer may write cell i on lap L once its sequence
+// reads L*capacity + i, and a consumer may read it once the sequence is one past that. Claiming a slot is a single CAS
+// on the head or tail position, and nobody ever waits on a lock.
+// Blocking push/pop spin for a bit, then sleep with atomic::wait, so idle threads don't burn a core.
+class MPMCRing {
+public:
+	// Capacity is rounded up to a power of two.
+	MPMCRing(size_t p_capacity = 1024) {
+		size_t capacity = 2;
+		while (capacity < p_capacity) capacity <<= 1;
+		m_mask = capacity - 1;
+		m_cells = std::make_unique<Cell[]>(capacity);
+		for (size_t i = 0; i < capacity; i++) {
+			m_cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+	MPMCRing(const MPMCRing& other) = delete;
+	MPMCRing& operator=(const MPMCRing& other) = delete;
+	~MPMCRing() {
+		clear();
+	}
+
+	// Returns false if the ring is full.
+	template<typename U>
+	bool tryPush(U&& p_value) {
+		size_t pos = m_enqueuePos.value.load(std::memory_order_relaxed);
+		while (true) {
+			Cell& cell = m_cells[pos & m_mask];
+			size_t sequence = cell.sequence.load(std::memory_order_acquire);
+			intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+			if (diff == 0) {
+				if (m_enqueuePos.value.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					new (cell.storage) T(std::forward<U>(p_value));
+					cell.sequence.store(pos + 1, std::memory_order_release);
+					wakePoppers();
+					return true;
+				}
+			}
+			else if (diff < 0) {
+				return false;
+			}
+			else {
+				pos = m_enqueuePos.value.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	// Waits for room if the ring is full. Gives up and returns false if forceAllThreadsToPop() is called meanwhile.
+	template<typename U>
+	bool push(U&& p_value) {
+		return blockUntil(m_popEpoch, m_pushWaiters, [&] { return tryPush(std::forward<U>(p_value)); });
+	}
+
+	std::optional<T> tryPop() {
+		std::optional<T> out;
+		size_t pos = m_dequeuePos.value.load(std::memory_order_relaxed);
+		while (true) {
+			Cell& cell = m_cells[pos & m_mask];
+			size_t sequence = cell.sequence.load(std::memory_order_acquire);
+			intptr_t diff = (intptr_t)sequence - (intptr_t)(pos + 1);
+			if (diff == 0) {
+				if (m_dequeuePos.value.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					T* value = cell.value();
+					out.emplace(std::move(*value));
+					value->~T();
+					cell.sequence.store(pos + m_mask + 1, std::memory_order_release);
+					wakePushers();
+					return out;
+				}
+			}
+			else if (diff < 0) {
+				return out;
+			}
+			else {
+				pos = m_dequeuePos.value.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	// Waits for something to show up. Returns a default constructed T if forceAllThreadsToPop() is called meanwhile.
+	T pop() {
+		std::optional<T> out;
+		blockUntil(m_pushEpoch, m_popWaiters, [&] { return (out = tryPop()).has_value(); });
+		return out ? std::move(*out) : T();
+	}
+
+	// Pushes as much of [p_first, p_last) as fits in one go, claiming all the slots with a single CAS.
+	// Returns how many were pushed, elements are moved out of the range.
+	template<typename It>
+	size_t tryPushN(It p_first, It p_last) {
+		size_t wanted = (size_t)std::distance(p_first, p_last);
+		if (wanted == 0) return 0;
+		size_t pos = m_enqueuePos.value.load(std::memory_order_relaxed);
+		while (true) {
+			size_t count = 0;
+			while (count < wanted && m_cells[(pos + count) & m_mask].sequence.load(std::memory_order_acquire) == pos + count) count++;
+			if (count == 0) {
+				// either full, or another producer got here first
+				if ((intptr_t)m_cells[pos & m_mask].sequence.load(std::memory_order_acquire) - (intptr_t)pos < 0) return 0;
+				pos = m_enqueuePos.value.load(std::memory_order_relaxed);
+				continue;
+			}
+			if (!m_enqueuePos.value.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed)) continue;
+
+			for (size_t i = 0; i < count; i++, ++p_first) {
+				Cell& cell = m_cells[(pos + i) & m_mask];
+				new (cell.storage) T(std::move(*p_first));
+				cell.sequence.store(pos + i + 1, std::memory_order_release);
+			}
+			wakePoppers(count);
+			return count;
+		}
+	}
+	// Pushes the whole range, waiting for room as needed. Returns how many made it in, which is less than the
+	// full range only if forceAllThreadsToPop() was called.
+	template<typename It>
+	size_t pushN(It p_first, It p_last) {
+		size_t total = 0;
+		blockUntil(m_popEpoch, m_pushWaiters, [&] {
+			size_t pushed = tryPushN(p_first, p_last);
+			std::advance(p_first, pushed);
+			total += pushed;
+			return p_first == p_last;
+		});
+		return total;
+	}
+
+	// Pops up to p_max elements into p_out with a single CAS. Returns how many it got.
+	template<typename OutIt>
+	size_t tryPopN(OutIt p_out, size_t p_max) {
+		if (p_max == 0) return 0;
+		size_t pos = m_dequeuePos.value.load(std::memory_order_relaxed);
+		while (true) {
+			size_t count = 0;
+			while (count < p_max && m_cells[(pos + count) & m_mask].sequence.load(std::memory_order_acquire) == pos + count + 1) count++;
+			if (count == 0) {
+				if ((intptr_t)m_cells[pos & m_mask].sequence.load(std::memory_order_acquire) - (intptr_t)(pos + 1) < 0) return 0;
+				pos = m_dequeuePos.value.load(std::memory_order_relaxed);
+				continue;
+			}
+			if (!m_dequeuePos.value.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed)) continue;
+
+			for (size_t i = 0; i < count; i++) {
+				Cell& cell = m_cells[(pos + i) & m_mask];
+				T* value = cell.value();
+				*p_out++ = std::move(*value);
+				value->~T();
+				cell.sequence.store(pos + i + m_mask + 1, std::memory_order_release);
+			}
+			wakePushers(count);
+			return count;
+		}
+	}
+	// Waits until there's at least one element, then takes up to p_max. Returns 0 only after forceAllThreadsToPop().
+	template<typename OutIt>
+	size_t popN(OutIt p_out, size_t p_max) {
+		size_t count = 0;
+		blockUntil(m_pushEpoch, m_popWaiters, [&] { return (count = tryPopN(p_out, p_max)) > 0; });
+		return count;
+	}
+
+	// Wakes every thread blocked in push or pop and makes them return. Sticks until resetTermination().
+	void forceAllThreadsToPop() {
+		m_terminateWaiting.store(true);
+		m_pushEpoch.fetch_add(1);
+		m_pushEpoch.notify_all();
+		m_popEpoch.fetch_add(1);
+		m_popEpoch.notify_all();
+	}
+	void resetTermination() {
+		m_terminateWaiting.store(false);
+	}
+
+	// Not safe to call while other threads are pushing.
+	void clear() {
+		while (tryPop()) {}
+	}
+	// Just a snapshot, it can be stale by the time you look at it.
+	size_t length() const {
+		size_t tail = m_enqueuePos.value.load(std::memory_order_acquire);
+		size_t head = m_dequeuePos.value.load(std::memory_order_acquire);
+		return tail > head ? tail - head : 0;
+	}
+	bool empty() const {
+		return length() == 0;
+	}
+	size_t capacity() const {
+		return m_mask + 1;
+	}
+private:
+	static constexpr size_t CACHE_LINE = 64;
+	// tries this many times before going to sleep
+	static constexpr int SPIN_COUNT = 64;
+
+	struct Cell {
+		std::atomic<size_t> sequence;
+		alignas(T) unsigned char storage[sizeof(T)];
+
+		T* value() {
+			return std::launder(reinterpret_cast<T*>(storage));
+		}
+	};
+	// keeps the producer and consumer positions from sharing a cache line
+	template<typename V>
+	struct alignas(CACHE_LINE) Padded {
+		V value;
+	};
+
+	// Runs p_attempt until it returns true, sleeping on p_epoch in between.
+	// Whoever could make p_attempt succeed bumps p_epoch if it sees a waiter. Returns false if woken by forceAllThreadsToPop().
+	template<typename F>
+	bool blockUntil(std::atomic<uint32_t>& p_epoch, std::atomic<uint32_t>& p_waiters, F&& p_attempt) {
+		// spinning on a single core just keeps whoever we're waiting on from running
+		static const int spinCount = std::thread::hardware_concurrency() > 1 ? SPIN_COUNT : 1;
+		for (int spin = 0; spin < spinCount; spin++) {
+			if (p_attempt()) return true;
+			if (m_terminateWaiting.load(std::memory_order_relaxed)) return false;
+			std::this_thread::yield();
+		}
+		while (true) {
+			uint32_t epoch = p_epoch.load();
+			p_waiters.fetch_add(1);
+			// pairs with the fence in wake(), either we see their element or they see us waiting
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (p_attempt()) {
+				p_waiters.fetch_sub(1);
+				return true;
+			}
+			if (m_terminateWaiting.load()) {
+				p_waiters.fetch_sub(1);
+				return false;
+			}
+			p_epoch.wait(epoch);
+			p_waiters.fetch_sub(1);
+		}
+	}
+
+	// p_count is how many elements or slots just became available, more than one wakes everyone like the LOCKED queue
+	void wake(std::atomic<uint32_t>& p_epoch, std::atomic<uint32_t>& p_waiters, size_t p_count) {
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (p_waiters.load(std::memory_order_relaxed) == 0) return;
+		p_epoch.fetch_add(1);
+		if (p_count > 1) p_epoch.notify_all();
+		else p_epoch.notify_one();
+	}
+	void wakePoppers(size_t p_count = 1) {
+		wake(m_pushEpoch, m_popWaiters, p_count);
+	}
+	void wakePushers(size_t p_count = 1) {
+		wake(m_popEpoch, m_pushWaiters, p_count);
+	}
+
+	std::unique_ptr<Cell[]> m_cells;
+	size_t m_mask = 0;
+	Padded<std::atomic<size_t>> m_enqueuePos{ 0 };
+	Padded<std::atomic<size_t>> m_dequeuePos{ 0 };
+
+	// bumped by pushes when someone's sleeping in pop, and the other way around
+	alignas(CACHE_LINE) std::atomic<uint32_t> m_pushEpoch{ 0 };
+	std::atomic<uint32_t> m_popWaiters{ 0 };
+	alignas(CACHE_LINE) std::atomic<uint32_t> m_popEpoch{ 0 };
+	std::atomic<uint32_t> m_pushWaiters{ 0 };
+	std::atomic<bool> m_terminateWaiting = false;
+};
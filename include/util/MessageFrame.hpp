@@ -0,0 +1,237 @@
+#pragma once
+#include <vector>
+#include <span>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <stdint.h>
+#include "GenericMessage.hpp"
+#include "FastCompress.hpp"
+#include "Framework/Log.hpp"
+
+namespace net {
+
+	// Every frame starts with this. rawLength is what the payload expands to, and only differs from length when it's compressed.
+	// The payload is just messages back to back, each one its MessageHeader followed by its body.
+	struct FrameHeader
+	{
+		uint32_t length = 0;
+		uint32_t rawLength = 0;
+	};
+
+	// Packs a batch of messages into a single length prefixed frame, ready to go down a stream in one write.
+	// The buffer is reused from one frame to the next, so after the first few frames nothing gets allocated.
+	// Frames whose payload is at least p_compressAbove bytes get run through FastCompress, and are sent as is if that doesn't help.
+	template <typename T>
+	class FrameEncoder
+	{
+	public:
+		static constexpr size_t NO_COMPRESSION = SIZE_MAX;
+
+		FrameEncoder(size_t p_compressAbove = NO_COMPRESSION) : m_compressAbove(p_compressAbove) {
+			m_buffer.resize(sizeof(FrameHeader));
+		}
+
+		FrameEncoder<T>& add(const Message<T>& p_msg) {
+			ensure(p_msg.size());
+			write(p_msg);
+			return *this;
+		}
+		// Sizes the buffer for the whole batch up front.
+		FrameEncoder<T>& add(std::span<const Message<T>> p_msgs) {
+			size_t total = 0;
+			for (const Message<T>& msg : p_msgs) total += msg.size();
+			ensure(total);
+			for (const Message<T>& msg : p_msgs) write(msg);
+			return *this;
+		}
+		void reserve(size_t p_bytes) {
+			ensure(p_bytes);
+		}
+
+		size_t pendingCount() const {
+			return m_count;
+		}
+		size_t pendingBytes() const {
+			return m_pos - sizeof(FrameHeader);
+		}
+
+		// Frames everything added since the last finish() and starts a new batch.
+		// The view points into the encoder, so write it out before adding anything else. Empty if nothing was added.
+		std::span<const uint8_t> finish() {
+			if (m_count == 0) return {};
+			size_t payload = pendingBytes();
+			if (payload > UINT32_MAX) {
+				ERROR_LOG("Message frame payload of " << payload << " bytes doesn't fit in a frame header.");
+				throw std::length_error("Message frame too big");
+			}
+			m_count = 0;
+			m_pos = sizeof(FrameHeader);
+			FrameHeader header{ (uint32_t)payload, (uint32_t)payload };
+
+			if (payload >= m_compressAbove) {
+				m_compressed.resize(sizeof(FrameHeader) + FastCompress::compressBound(payload));
+				// only worth it if it comes out smaller
+				size_t compressed = FastCompress::compress(m_buffer.data() + sizeof(FrameHeader), payload, m_compressed.data() + sizeof(FrameHeader), payload - 1);
+				if (compressed) {
+					header.length = (uint32_t)compressed;
+					std::memcpy(m_compressed.data(), &header, sizeof(FrameHeader));
+					return { m_compressed.data(), sizeof(FrameHeader) + compressed };
+				}
+			}
+			std::memcpy(m_buffer.data(), &header, sizeof(FrameHeader));
+			return { m_buffer.data(), sizeof(FrameHeader) + payload };
+		}
+	private:
+		void ensure(size_t p_bytes) {
+			if (m_pos + p_bytes <= m_buffer.size()) return;
+			m_buffer.resize(std::max(m_pos + p_bytes, m_buffer.size() * 2));
+		}
+		// must have ensure()d room for it
+		void write(const Message<T>& p_msg) {
+			MessageHeader<T> header = p_msg.header;
+			// whatever's in the header might be stale if the body was filled in by hand
+			header.size = (uint32_t)p_msg.size();
+			std::memcpy(m_buffer.data() + m_pos, &header, sizeof(MessageHeader<T>));
+			if (!p_msg.body.empty()) std::memcpy(m_buffer.data() + m_pos + sizeof(MessageHeader<T>), p_msg.body.data(), p_msg.body.size());
+			m_pos += header.size;
+			m_count++;
+		}
+
+		std::vector<uint8_t> m_buffer;
+		std::vector<uint8_t> m_compressed;
+		size_t m_pos = sizeof(FrameHeader);
+		size_t m_count = 0;
+		size_t m_compressAbove;
+	};
+
+	// One message out of a frame, pointing at bytes somewhere else.
+	template <typename T>
+	struct MessageView
+	{
+		MessageHeader<T> header{};
+		std::span<const uint8_t> body;
+
+		MessageReader reader() const {
+			return MessageReader(body);
+		}
+		// For when the message has to stick around.
+		Message<T> copy() const {
+			return Message<T>{ header, std::vector<uint8_t>(body.begin(), body.end()) };
+		}
+	};
+
+	// Takes a byte stream in whatever pieces it arrives in and hands back the messages in it, without copying them
+	// wherever it can get away with it.
+	// Use it like: feed() what came off the socket, then call next() until it returns false, then feed() the next piece.
+	// Whole frames are read straight out of what you fed it, so keep that alive until next() returns false.
+	// Only a frame that got split between two feeds is copied, and a compressed one is expanded into the decoder.
+	// A view is only good until the following next() call, copy() it if it needs to live longer.
+	// Anything malformed (a frame bigger than p_maxFrameSize, a message running off the end of its frame, a compressed
+	// payload that doesn't expand right) logs an error and throws std::runtime_error, and the stream can't be trusted after that.
+	template <typename T>
+	class FrameDecoder
+	{
+	public:
+		static constexpr size_t DEFAULT_MAX_FRAME_SIZE = size_t(64) << 20;
+
+		FrameDecoder(size_t p_maxFrameSize = DEFAULT_MAX_FRAME_SIZE) : m_maxFrameSize(p_maxFrameSize) {}
+
+		void feed(std::span<const uint8_t> p_data) {
+			if (!m_input.empty() || m_framePos < m_frame.size()) {
+				ERROR_LOG("Fed a frame decoder before reading everything out of it.");
+				throw std::logic_error("Frame decoder fed while it still had messages");
+			}
+			m_input = p_data;
+		}
+
+		bool next(MessageView<T>& o_view) {
+			while (m_framePos == m_frame.size()) {
+				if (!nextFrame()) return false;
+			}
+			if (m_frame.size() - m_framePos < sizeof(MessageHeader<T>)) fail("Message header runs off the end of its frame.");
+			std::memcpy(&o_view.header, m_frame.data() + m_framePos, sizeof(MessageHeader<T>));
+			size_t size = o_view.header.size;
+			if (size < sizeof(MessageHeader<T>) || size > m_frame.size() - m_framePos) fail("Message body runs off the end of its frame.");
+			o_view.body = m_frame.subspan(m_framePos + sizeof(MessageHeader<T>), size - sizeof(MessageHeader<T>));
+			m_framePos += size;
+			return true;
+		}
+
+		// Bytes of a partial frame that are waiting on the next feed().
+		size_t bufferedBytes() const {
+			return m_pending.size() - m_pendingPos;
+		}
+	private:
+		bool nextFrame() {
+			m_frame = {};
+			m_framePos = 0;
+			std::span<const uint8_t> frame;
+			if (m_pendingPos < m_pending.size()) {
+				// finish off the frame that got split, using as little of the new data as it needs
+				if (m_pendingPos > 0) {
+					m_pending.erase(m_pending.begin(), m_pending.begin() + m_pendingPos);
+					m_pendingPos = 0;
+				}
+				if (!topUp(sizeof(FrameHeader))) return false;
+				size_t total = frameSize(m_pending.data());
+				if (!topUp(total)) return false;
+				frame = { m_pending.data(), total };
+				m_pendingPos = total;
+			}
+			else {
+				m_pending.clear();
+				m_pendingPos = 0;
+				if (m_input.size() < sizeof(FrameHeader) || m_input.size() < frameSize(m_input.data())) {
+					m_pending.assign(m_input.begin(), m_input.end());
+					m_input = {};
+					return false;
+				}
+				frame = m_input.first(frameSize(m_input.data()));
+				m_input = m_input.subspan(frame.size());
+			}
+
+			FrameHeader header;
+			std::memcpy(&header, frame.data(), sizeof(FrameHeader));
+			std::span<const uint8_t> payload = frame.subspan(sizeof(FrameHeader));
+			if (header.rawLength == header.length) {
+				m_frame = payload;
+				return true;
+			}
+			if (header.rawLength > m_maxFrameSize) fail("Compressed message frame expands past the size limit.");
+			m_expanded.resize(header.rawLength);
+			if (!FastCompress::decompress(payload.data(), payload.size(), m_expanded.data(), header.rawLength)) fail("Compressed message frame is garbled.");
+			m_frame = m_expanded;
+			return true;
+		}
+		// reads the header at p_data, which has to have one
+		size_t frameSize(const uint8_t* p_data) const {
+			FrameHeader header;
+			std::memcpy(&header, p_data, sizeof(FrameHeader));
+			if (header.length > m_maxFrameSize) fail("Message frame is bigger than the size limit.");
+			return sizeof(FrameHeader) + header.length;
+		}
+		// moves input over to the pending buffer until it holds p_bytes
+		bool topUp(size_t p_bytes) {
+			if (m_pending.size() >= p_bytes) return true;
+			size_t taken = std::min(p_bytes - m_pending.size(), m_input.size());
+			m_pending.insert(m_pending.end(), m_input.begin(), m_input.begin() + taken);
+			m_input = m_input.subspan(taken);
+			return m_pending.size() >= p_bytes;
+		}
+		[[noreturn]] void fail(const char* p_reason) const {
+			ERROR_LOG(p_reason);
+			throw std::runtime_error("Malformed message frame");
+		}
+
+		std::span<const uint8_t> m_input;
+		// the frame being read, either in m_input's buffer, m_pending or m_expanded
+		std::span<const uint8_t> m_frame;
+		size_t m_framePos = 0;
+		std::vector<uint8_t> m_pending;
+		size_t m_pendingPos = 0;
+		std::vector<uint8_t> m_expanded;
+		size_t m_maxFrameSize;
+	};
+
+}
@@ -6,8 +6,16 @@
 #include <mutex>
 #include <optional>
 #include <string>
+#include "SPSCRing.hpp"
 
-template<typename TFront, typename TBack>
+enum class MessengerMode {
+    // Mutex per direction, any number of threads can send and receive.
+    LOCKED,
+    // Exactly one thread on each end. No locks at all, see SPSCRing.
+    SPSC
+};
+
+template<typename TFront, typename TBack, MessengerMode Mode = MessengerMode::LOCKED>
 // The messenger class handles thread synchronization in a non-blocking way, allowing the sharing of resources
 // The front and back in this context refer to forward and reverse directions of messaging, allowing two way communication.
 // Warning: Used as a singleton, this class can only exists with one instance of any given type template.
@@ -19,7 +27,7 @@ public:
     std::optional<TFront> getMessageFront() {
         std::unique_lock<std::mutex> lock(m_frontMutex);
         if (m_frontQueue.empty()) return std::nullopt;
-        const TFront out = m_frontQueue.front();
+        TFront out = std::move(m_frontQueue.front());
         m_frontQueue.pop();
         return out;
     }
@@ -28,7 +36,7 @@ public:
     std::optional<TBack> getMessageBack() {
         std::unique_lock<std::mutex> lock(m_backMutex);
         if (m_backQueue.empty()) return std::nullopt;
-        const TBack out = m_backQueue.front();
+        TBack out = std::move(m_backQueue.front());
         m_backQueue.pop();
         return out;
     }
@@ -61,8 +69,8 @@ public:
         m_backQueue.push(p_message);
     }
 
-    static BidirectionalMessenger<TFront, TBack>& Get() {
-        static BidirectionalMessenger<TFront, TBack> instance;
+    static BidirectionalMessenger<TFront, TBack, Mode>& Get() {
+        static BidirectionalMessenger<TFront, TBack, Mode> instance;
         return instance;
     }
 
@@ -73,3 +81,69 @@ private:
     std::mutex m_frontMutex;
     std::mutex m_backMutex;
 };
+
+template<typename TFront, typename TBack>
+// Same thing for when exactly one thread sends front messages and exactly one other thread sends back messages,
+// like the game thread and the render thread. Sending and receiving never lock or allocate, messages are moved
+// instead of copied, so move-only types work, and drainFront()/drainBack() take a whole frame's worth in one go.
+// Each direction is bounded, sending to a full one waits for the other side to catch up.
+class BidirectionalMessenger<TFront, TBack, MessengerMode::SPSC> {
+public:
+    BidirectionalMessenger(size_t p_capacity = 4096) : m_frontRing(p_capacity), m_backRing(p_capacity) {}
+
+    // Non-blocking
+    std::optional<TFront> getMessageFront() {
+        return m_frontRing.tryPop();
+    }
+    // Non-blocking
+    std::optional<TBack> getMessageBack() {
+        return m_backRing.tryPop();
+    }
+
+    void sendMessageFront(TFront&& p_message) {
+        m_frontRing.push(std::move(p_message));
+    }
+    void sendMessageFront(const TFront& p_message) {
+        m_frontRing.push(p_message);
+    }
+    void sendMessageBack(TBack&& p_message) {
+        m_backRing.push(std::move(p_message));
+    }
+    void sendMessageBack(const TBack& p_message) {
+        m_backRing.push(p_message);
+    }
+
+    // Calls p_fn on every message waiting right now, returns how many there were.
+    template<typename F>
+    size_t drainFront(F&& p_fn) {
+        return m_frontRing.drain(std::forward<F>(p_fn));
+    }
+    template<typename F>
+    size_t drainBack(F&& p_fn) {
+        return m_backRing.drain(std::forward<F>(p_fn));
+    }
+
+    // Blocking, sleeps until a message arrives. Only call from the receiving thread.
+    void waitFront() {
+        m_frontRing.wait();
+    }
+    void waitBack() {
+        m_backRing.wait();
+    }
+
+    bool incomingFront() {
+        return !m_frontRing.empty();
+    }
+    bool incomingBack() {
+        return !m_backRing.empty();
+    }
+
+    static BidirectionalMessenger<TFront, TBack, MessengerMode::SPSC>& Get() {
+        static BidirectionalMessenger<TFront, TBack, MessengerMode::SPSC> instance;
+        return instance;
+    }
+
+private:
+    SPSCRing<TFront> m_frontRing;
+    SPSCRing<TBack> m_backRing;
+};
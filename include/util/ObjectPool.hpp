@@ -0,0 +1,358 @@
+#pragma once
+#include <new>
+#include <mutex>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <memory_resource>
+#include <cstddef>
+#include <stdint.h>
+#include <string.h>
+#include "Framework/Log.hpp"
+
+// Fixed size block allocator for things that get made and thrown away constantly from lots of threads.
+// Every thread keeps two magazines (small stacks of free blocks) per pool, so allocating and freeing is almost always
+// a push or pop on memory only that thread touches. When both of a thread's magazines run dry or fill up it swaps a
+// whole magazine with the depot in one CAS, so threads only ever meet each other once per MAGAZINE_SIZE blocks.
+// Only carving a new slab takes a lock. Slabs aren't given back until the pool goes away.
+// Blocks freed on one thread can be allocated on another, that's what the depot is for.
+// Threads can come and go freely: a thread hands its magazines back to the depot when it exits, and a thread that
+// outlives the pool just forgets about it.
+class BlockPool {
+public:
+	static constexpr size_t MAGAZINE_SIZE = 64;
+	static constexpr size_t MAGAZINES_PER_SLAB = 4;
+	static constexpr size_t MAX_THREADS = 256;
+	static constexpr unsigned char POISON = 0xDD;
+
+	BlockPool(size_t p_blockSize, size_t p_blockAlign = alignof(std::max_align_t), std::pmr::memory_resource* p_upstream = std::pmr::new_delete_resource()) :
+		m_core(makeCore(p_blockSize, p_blockAlign)),
+		m_resource(this, p_upstream) {}
+	BlockPool(const BlockPool& other) = delete;
+	BlockPool& operator=(const BlockPool& other) = delete;
+
+	void* allocate() {
+		Core& core = *m_core;
+		ThreadCache& cache = core.localCache();
+		if (cache.loaded->count == 0) {
+			if (cache.previous->count > 0) {
+				std::swap(cache.loaded, cache.previous);
+			}
+			else {
+				// both empty, trade one in for a full one
+				Magazine* full = core.pop(core.m_fullMagazines);
+				if (!full) full = core.carveSlab();
+				core.push(core.m_emptyMagazines, cache.previous);
+				cache.previous = cache.loaded;
+				cache.loaded = full;
+			}
+		}
+		return cache.loaded->blocks[--cache.loaded->count];
+	}
+	void deallocate(void* p_block) {
+		if (!p_block) return;
+		Core& core = *m_core;
+#ifdef _DEBUG
+		memset(p_block, POISON, core.m_blockSize);
+#endif
+		ThreadCache& cache = core.localCache();
+		if (cache.loaded->count == MAGAZINE_SIZE) {
+			if (cache.previous->count < MAGAZINE_SIZE) {
+				std::swap(cache.loaded, cache.previous);
+			}
+			else {
+				// both full, give one to the depot for someone else to allocate out of
+				Magazine* empty = core.pop(core.m_emptyMagazines);
+				if (!empty) empty = core.newMagazine();
+				core.push(core.m_fullMagazines, cache.previous);
+				cache.previous = cache.loaded;
+				cache.loaded = empty;
+			}
+		}
+		cache.loaded->blocks[cache.loaded->count++] = p_block;
+	}
+
+	size_t blockSize() const {
+		return m_core->m_blockSize;
+	}
+	size_t blockAlign() const {
+		return m_core->m_blockAlign;
+	}
+	// Every block the pool has carved, whether it's handed out or sitting in a magazine.
+	size_t capacity() const {
+		return m_core->m_slabCount.load(std::memory_order_relaxed) * MAGAZINES_PER_SLAB * MAGAZINE_SIZE;
+	}
+	// How many times the pool had to go to the system for a new slab.
+	uint64_t slabAllocs() const {
+		return m_core->m_slabCount.load(std::memory_order_relaxed);
+	}
+	// How many magazines have gone through the depot. Divided by the allocation count, this is how often threads met.
+	uint64_t depotTransfers() const {
+		return m_core->m_depotTransfers.load(std::memory_order_relaxed);
+	}
+
+	// Serves anything that fits in a block from the pool and sends the rest upstream.
+	// Meant for node based containers, e.g. std::pmr::list<Foo> where the pool is sized for list nodes.
+	class Resource : public std::pmr::memory_resource {
+	public:
+		Resource(BlockPool* p_pool, std::pmr::memory_resource* p_upstream) : m_pool(p_pool), m_upstream(p_upstream) {}
+	protected:
+		void* do_allocate(size_t p_bytes, size_t p_align) override {
+			if (!fits(p_bytes, p_align)) return m_upstream->allocate(p_bytes, p_align);
+			return m_pool->allocate();
+		}
+		void do_deallocate(void* p_memory, size_t p_bytes, size_t p_align) override {
+			if (!fits(p_bytes, p_align)) return m_upstream->deallocate(p_memory, p_bytes, p_align);
+			m_pool->deallocate(p_memory);
+		}
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+			return this == &other;
+		}
+	private:
+		bool fits(size_t p_bytes, size_t p_align) const {
+			return p_bytes <= m_pool->blockSize() && p_align <= m_pool->blockAlign();
+		}
+		BlockPool* m_pool;
+		std::pmr::memory_resource* m_upstream;
+	};
+	std::pmr::memory_resource* resource() {
+		return &m_resource;
+	}
+private:
+	struct Magazine {
+		uint32_t index;
+		uint32_t count = 0;
+		// 1 + index of the magazine under this one in a depot stack, 0 for the bottom
+		std::atomic<uint32_t> next{ 0 };
+		void* blocks[MAGAZINE_SIZE];
+	};
+	struct alignas(64) ThreadCache {
+		std::atomic<bool> claimed{ false };
+		Magazine* loaded = nullptr;
+		Magazine* previous = nullptr;
+	};
+
+	// Everything the threads' caches point into. Lives in a shared_ptr so a thread exiting after the pool is gone
+	// can tell, and one exiting while it goes away keeps it alive long enough to hand its magazines back.
+	struct Core {
+		static constexpr size_t MAGAZINES_PER_BLOCK = 64;
+		static constexpr size_t MAX_MAGAZINE_BLOCKS = 4096;
+
+		Core(size_t p_blockSize, size_t p_blockAlign) {
+			if (p_blockAlign == 0 || (p_blockAlign & (p_blockAlign - 1)) != 0) {
+				ERROR_LOG("Block pool alignment has to be a power of two, got " << p_blockAlign << ".");
+				throw std::invalid_argument("Bad block pool alignment");
+			}
+			m_blockAlign = p_blockAlign;
+			m_blockSize = (std::max<size_t>(p_blockSize, 1) + p_blockAlign - 1) & ~(p_blockAlign - 1);
+		}
+		~Core() {
+			for (void* slab : m_slabs) ::operator delete(slab, std::align_val_t(m_blockAlign));
+			for (std::atomic<Magazine*>& block : m_magazineBlocks) delete[] block.load(std::memory_order_relaxed);
+		}
+
+		// Which cache this thread owns in one pool. Hands it back when the thread exits.
+		struct ThreadEntry {
+			uint64_t poolId = 0;
+			std::weak_ptr<Core> core;
+			ThreadCache* cache = nullptr;
+
+			~ThreadEntry() {
+				std::shared_ptr<Core> alive = core.lock();
+				if (alive) alive->releaseCache(*cache);
+			}
+		};
+
+		ThreadCache& localCache() {
+			// a thread usually only ever uses a few pools, so a short list is fine
+			thread_local std::deque<ThreadEntry> t_entries;
+			for (ThreadEntry& entry : t_entries) {
+				if (entry.poolId == m_id) return *entry.cache;
+			}
+			// first time this thread has used this pool, drop the entries for pools that are gone while we're here
+			while (!t_entries.empty() && t_entries.front().core.expired()) t_entries.pop_front();
+			for (size_t i = 0; i < MAX_THREADS; i++) {
+				bool expected = false;
+				if (m_caches[i].claimed.load(std::memory_order_relaxed)) continue;
+				if (!m_caches[i].claimed.compare_exchange_strong(expected, true)) continue;
+				ThreadCache& cache = m_caches[i];
+				cache.loaded = newMagazineOrEmpty();
+				cache.previous = newMagazineOrEmpty();
+				ThreadEntry& entry = t_entries.emplace_back();
+				entry.poolId = m_id;
+				entry.core = m_self.lock();
+				entry.cache = &cache;
+				return cache;
+			}
+			ERROR_LOG("More than " << MAX_THREADS << " threads tried to use the same block pool.");
+			throw std::runtime_error("Out of block pool thread caches");
+		}
+		void releaseCache(ThreadCache& p_cache) {
+			for (Magazine* magazine : { p_cache.loaded, p_cache.previous }) {
+				push(magazine->count > 0 ? m_fullMagazines : m_emptyMagazines, magazine);
+			}
+			p_cache.loaded = nullptr;
+			p_cache.previous = nullptr;
+			p_cache.claimed.store(false, std::memory_order_release);
+		}
+
+		// Depot stacks are a head index with a tag in the top half that goes up on every change,
+		// so a magazine that got popped and pushed back while we weren't looking can't fool the CAS.
+		void push(std::atomic<uint64_t>& p_stack, Magazine* p_magazine) {
+			uint64_t head = p_stack.load(std::memory_order_relaxed);
+			uint64_t next;
+			do {
+				p_magazine->next.store((uint32_t)head, std::memory_order_relaxed);
+				next = (((head >> 32) + 1) << 32) | (p_magazine->index + 1);
+			} while (!p_stack.compare_exchange_weak(head, next, std::memory_order_release, std::memory_order_relaxed));
+			m_depotTransfers.fetch_add(1, std::memory_order_relaxed);
+		}
+		Magazine* pop(std::atomic<uint64_t>& p_stack) {
+			uint64_t head = p_stack.load(std::memory_order_acquire);
+			while (true) {
+				uint32_t top = (uint32_t)head;
+				if (top == 0) return nullptr;
+				// magazines are never freed while the pool's alive, so reading a stale one is harmless, the CAS just fails
+				Magazine* magazine = magazineAt(top - 1);
+				uint64_t next = (((head >> 32) + 1) << 32) | magazine->next.load(std::memory_order_relaxed);
+				if (p_stack.compare_exchange_weak(head, next, std::memory_order_acquire, std::memory_order_acquire)) {
+					m_depotTransfers.fetch_add(1, std::memory_order_relaxed);
+					return magazine;
+				}
+			}
+		}
+
+		Magazine* magazineAt(uint32_t p_index) {
+			return m_magazineBlocks[p_index / MAGAZINES_PER_BLOCK].load(std::memory_order_acquire) + p_index % MAGAZINES_PER_BLOCK;
+		}
+		Magazine* newMagazine() {
+			std::unique_lock<std::mutex> lock(m_growMutex);
+			return newMagazineLocked();
+		}
+		Magazine* newMagazineOrEmpty() {
+			Magazine* magazine = pop(m_emptyMagazines);
+			return magazine ? magazine : newMagazine();
+		}
+		// must hold m_growMutex
+		Magazine* newMagazineLocked() {
+			uint32_t index = m_magazineCount++;
+			size_t block = index / MAGAZINES_PER_BLOCK;
+			if (block >= MAX_MAGAZINE_BLOCKS) {
+				ERROR_LOG("Block pool ran out of magazines, something is holding on to an awful lot of blocks.");
+				throw std::bad_alloc();
+			}
+			if (index % MAGAZINES_PER_BLOCK == 0) {
+				Magazine* magazines = new Magazine[MAGAZINES_PER_BLOCK];
+				for (size_t i = 0; i < MAGAZINES_PER_BLOCK; i++) magazines[i].index = (uint32_t)(index + i);
+				m_magazineBlocks[block].store(magazines, std::memory_order_release);
+			}
+			return magazineAt(index);
+		}
+
+		// Makes a new slab, keeps one magazine's worth of it and puts the rest in the depot.
+		Magazine* carveSlab() {
+			std::unique_lock<std::mutex> lock(m_growMutex);
+			size_t blockCount = MAGAZINES_PER_SLAB * MAGAZINE_SIZE;
+			unsigned char* slab = static_cast<unsigned char*>(::operator new(m_blockSize * blockCount, std::align_val_t(m_blockAlign)));
+			m_slabs.push_back(slab);
+			m_slabCount.fetch_add(1, std::memory_order_relaxed);
+
+			Magazine* kept = nullptr;
+			for (size_t m = 0; m < MAGAZINES_PER_SLAB; m++) {
+				Magazine* magazine = pop(m_emptyMagazines);
+				if (!magazine) magazine = newMagazineLocked();
+				for (size_t i = 0; i < MAGAZINE_SIZE; i++) magazine->blocks[i] = slab + (m * MAGAZINE_SIZE + i) * m_blockSize;
+				magazine->count = MAGAZINE_SIZE;
+				if (!kept) kept = magazine;
+				else push(m_fullMagazines, magazine);
+			}
+			return kept;
+		}
+
+		size_t m_blockSize;
+		size_t m_blockAlign;
+		uint64_t m_id = s_nextId.fetch_add(1, std::memory_order_relaxed);
+		std::weak_ptr<Core> m_self;
+
+		alignas(64) std::atomic<uint64_t> m_fullMagazines{ 0 };
+		alignas(64) std::atomic<uint64_t> m_emptyMagazines{ 0 };
+		alignas(64) std::atomic<uint64_t> m_depotTransfers{ 0 };
+		std::atomic<uint64_t> m_slabCount{ 0 };
+		ThreadCache m_caches[MAX_THREADS];
+
+		std::mutex m_growMutex;
+		std::vector<void*> m_slabs;
+		uint32_t m_magazineCount = 0;
+		std::atomic<Magazine*> m_magazineBlocks[MAX_MAGAZINE_BLOCKS] = {};
+
+		static inline std::atomic<uint64_t> s_nextId{ 1 };
+	};
+
+	static std::shared_ptr<Core> makeCore(size_t p_blockSize, size_t p_blockAlign) {
+		std::shared_ptr<Core> core = std::make_shared<Core>(p_blockSize, p_blockAlign);
+		core->m_self = core;
+		return core;
+	}
+
+	std::shared_ptr<Core> m_core;
+	Resource m_resource;
+};
+
+template<typename T>
+// BlockPool with blocks sized for T, plus making and destroying T's in them.
+// make() hands back a pooled_ptr, which puts the object back in the pool when it goes out of scope.
+// The pool has to outlive everything allocated from it.
+class ObjectPool {
+public:
+	// Deleter for pooled_ptr, destroys the object and gives its block back to the pool it came from.
+	class Deleter {
+	public:
+		Deleter() {}
+		Deleter(ObjectPool<T>* p_pool) : m_pool(p_pool) {}
+		void operator()(T* p_object) const {
+			m_pool->destroy(p_object);
+		}
+	private:
+		ObjectPool<T>* m_pool = nullptr;
+	};
+
+	ObjectPool(std::pmr::memory_resource* p_upstream = std::pmr::new_delete_resource()) : m_blocks(sizeof(T), alignof(T), p_upstream) {}
+	ObjectPool(const ObjectPool<T>& other) = delete;
+	ObjectPool<T>& operator=(const ObjectPool<T>& other) = delete;
+
+	template<typename... Args>
+	T* create(Args&&... p_args) {
+		void* block = m_blocks.allocate();
+		try {
+			return new (block) T(std::forward<Args>(p_args)...);
+		}
+		catch (...) {
+			m_blocks.deallocate(block);
+			throw;
+		}
+	}
+	void destroy(T* p_object) {
+		if (!p_object) return;
+		p_object->~T();
+		m_blocks.deallocate(p_object);
+	}
+	template<typename... Args>
+	std::unique_ptr<T, Deleter> make(Args&&... p_args) {
+		return std::unique_ptr<T, Deleter>(create(std::forward<Args>(p_args)...), Deleter(this));
+	}
+
+	BlockPool& blocks() {
+		return m_blocks;
+	}
+	std::pmr::memory_resource* resource() {
+		return m_blocks.resource();
+	}
+private:
+	BlockPool m_blocks;
+};
+
+template<typename T>
+using pooled_ptr = std::unique_ptr<T, typename ObjectPool<T>::Deleter>;
@@ -0,0 +1,142 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <new>
+#include <thread>
+#include <utility>
+#include <optional>
+#include <cstddef>
+
+template<typename T>
+// Bounded queue for exactly one producer thread and one consumer thread.
+// Each side owns one index and only ever reads the other's, so a push or pop is a couple of plain loads and one release store.
+// Each side also keeps a stale copy of the other's index and only re-reads the real one when the copy says full/empty,
+// which keeps the two cache lines from bouncing back and forth on every message.
+class SPSCRing {
+public:
+	// Capacity is rounded up to a power of two.
+	SPSCRing(size_t p_capacity = 4096) {
+		size_t capacity = 2;
+		while (capacity < p_capacity) capacity <<= 1;
+		m_mask = capacity - 1;
+		m_slots = std::make_unique<Slot[]>(capacity);
+	}
+	SPSCRing(const SPSCRing& other) = delete;
+	SPSCRing& operator=(const SPSCRing& other) = delete;
+	~SPSCRing() {
+		size_t head = m_consumer.head.load(std::memory_order_relaxed);
+		size_t tail = m_producer.tail.load(std::memory_order_relaxed);
+		for (; head != tail; head++) m_slots[head & m_mask].value()->~T();
+	}
+
+	// producer side
+
+	// Returns false if the ring is full.
+	template<typename U>
+	bool tryPush(U&& p_value) {
+		size_t tail = m_producer.tail.load(std::memory_order_relaxed);
+		if (tail - m_producer.cachedHead > m_mask) {
+			m_producer.cachedHead = m_consumer.head.load(std::memory_order_acquire);
+			if (tail - m_producer.cachedHead > m_mask) return false;
+		}
+		new (m_slots[tail & m_mask].storage) T(std::forward<U>(p_value));
+		publish(tail + 1);
+		return true;
+	}
+	// Waits for the consumer to make room if the ring is full.
+	template<typename U>
+	void push(U&& p_value) {
+		while (!tryPush(std::forward<U>(p_value))) std::this_thread::yield();
+	}
+
+	// consumer side
+
+	std::optional<T> tryPop() {
+		std::optional<T> out;
+		size_t head = m_consumer.head.load(std::memory_order_relaxed);
+		if (head == m_consumer.cachedTail) {
+			m_consumer.cachedTail = m_producer.tail.load(std::memory_order_acquire);
+			if (head == m_consumer.cachedTail) return out;
+		}
+		T* value = m_slots[head & m_mask].value();
+		out.emplace(std::move(*value));
+		value->~T();
+		m_consumer.head.store(head + 1, std::memory_order_release);
+		return out;
+	}
+
+	// Hands everything that's currently queued to p_fn, in order, and returns how many there were.
+	// The slots are given back to the producer in one go at the end instead of one at a time.
+	// p_fn gets an rvalue reference, move out of it if you want to keep it. It shouldn't throw.
+	template<typename F>
+	size_t drain(F&& p_fn) {
+		size_t head = m_consumer.head.load(std::memory_order_relaxed);
+		m_consumer.cachedTail = m_producer.tail.load(std::memory_order_acquire);
+		size_t count = m_consumer.cachedTail - head;
+		if (count == 0) return 0;
+		for (size_t i = 0; i < count; i++) {
+			T* value = m_slots[(head + i) & m_mask].value();
+			p_fn(std::move(*value));
+			value->~T();
+		}
+		m_consumer.head.store(head + count, std::memory_order_release);
+		return count;
+	}
+
+	// Blocks the consumer until there's something to pop. Sleeps with atomic::wait rather than spinning.
+	void wait() {
+		size_t head = m_consumer.head.load(std::memory_order_relaxed);
+		while (true) {
+			if (m_producer.tail.load(std::memory_order_acquire) != head) return;
+			m_consumerWaiting.store(true);
+			// pairs with the fence in publish(), either we see the new tail or the producer sees us waiting
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			size_t tail = m_producer.tail.load(std::memory_order_relaxed);
+			if (tail == head) m_producer.tail.wait(tail, std::memory_order_acquire);
+			m_consumerWaiting.store(false, std::memory_order_relaxed);
+		}
+	}
+
+	// Either side can call these, they're just a snapshot.
+	size_t length() const {
+		return m_producer.tail.load(std::memory_order_acquire) - m_consumer.head.load(std::memory_order_acquire);
+	}
+	bool empty() const {
+		return length() == 0;
+	}
+	size_t capacity() const {
+		return m_mask + 1;
+	}
+private:
+	static constexpr size_t CACHE_LINE = 64;
+
+	struct Slot {
+		alignas(T) unsigned char storage[sizeof(T)];
+
+		T* value() {
+			return std::launder(reinterpret_cast<T*>(storage));
+		}
+	};
+	// written by the producer, read by the consumer
+	struct alignas(CACHE_LINE) ProducerSide {
+		std::atomic<size_t> tail{ 0 };
+		size_t cachedHead = 0;
+	};
+	// written by the consumer, read by the producer
+	struct alignas(CACHE_LINE) ConsumerSide {
+		std::atomic<size_t> head{ 0 };
+		size_t cachedTail = 0;
+	};
+
+	void publish(size_t p_tail) {
+		m_producer.tail.store(p_tail, std::memory_order_release);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (m_consumerWaiting.load(std::memory_order_relaxed)) m_producer.tail.notify_one();
+	}
+
+	ProducerSide m_producer;
+	ConsumerSide m_consumer;
+	alignas(CACHE_LINE) std::atomic<bool> m_consumerWaiting{ false };
+	std::unique_ptr<Slot[]> m_slots;
+	size_t m_mask = 0;
+};
@@ -7,7 +7,7 @@
 
 template <typename T, size_t MAX_BLOCK_COUNT = 2048>
 // same as the other one but threadsafe and a singleton
-// depreciated due to issues
+// depreciated due to issues, use SlotMap (or ConcurrentSlotMap) instead
 // long name lol
 class SharedDynArray {
 public:
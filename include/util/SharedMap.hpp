@@ -6,6 +6,7 @@
 
 template<typename Kty, typename Ty, typename Hasher>
 // Threadsafe map, not entirely comprehensive but it's enough
+// Every call goes through one lock, so anything hit from lots of threads at once should use ConcurrentMap instead.
 class SharedMap {
 public:
 	Ty& operator[](const Kty& p_key) {
@@ -4,9 +4,18 @@
 #include <shared_mutex>
 #include <condition_variable>
 #include <optional>
+#include <iterator>
+#include "MPMCRing.hpp"
 
-template<typename T>
-// T must be default constructable 
+enum class SharedQueueBackend {
+	// std::queue behind a mutex. Unbounded, push never fails.
+	LOCKED,
+	// Bounded lock-free ring, see MPMCRing. Much better under contention, but push waits (or tryPush fails) when it's full.
+	LOCK_FREE_RING
+};
+
+template<typename T, SharedQueueBackend Backend = SharedQueueBackend::LOCKED>
+// T must be default constructable
 class SharedQueue {
 public:
 	void push(const T& p_value) {
@@ -14,12 +23,23 @@ public:
 		m_queue.push(p_value);
 		m_cv.notify_one();
 	}
+	void push(T&& p_value) {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_queue.push(std::move(p_value));
+		m_cv.notify_one();
+	}
+	// never full, only here so both backends can be used the same way
+	template<typename U>
+	bool tryPush(U&& p_value) {
+		push(std::forward<U>(p_value));
+		return true;
+	}
 	auto pop() {
 		std::unique_lock<std::mutex> lock(m_mutex);
 		// kinda scuffed but good enough
 		m_cv.wait(lock, [&]() { return !m_queue.empty() || m_terminateWaiting; });
 		if (m_terminateWaiting) return T();
-		T out = m_queue.front();
+		T out = std::move(m_queue.front());
 		m_queue.pop();
 		return out;
 	}
@@ -28,14 +48,45 @@ public:
 		return m_queue.empty();
 	}
 	std::optional<T> tryPop() {
-		if (!empty()) {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (m_queue.empty()) return std::nullopt;
+		T out = std::move(m_queue.front());
+		m_queue.pop();
+		return out;
+	}
+
+	// Moves the whole range in under one lock.
+	template<typename It>
+	size_t pushN(It p_first, It p_last) {
+		size_t count = 0;
+		{
 			std::unique_lock<std::mutex> lock(m_mutex);
-			T out = m_queue.front();
-			m_queue.pop();
-			return out;
+			for (; p_first != p_last; ++p_first, count++) {
+				m_queue.push(std::move(*p_first));
+			}
 		}
-		return std::nullopt;
+		if (count > 1) m_cv.notify_all();
+		else if (count == 1) m_cv.notify_one();
+		return count;
 	}
+	template<typename It>
+	size_t tryPushN(It p_first, It p_last) {
+		return pushN(p_first, p_last);
+	}
+	// Takes up to p_max elements under one lock, waiting until there's at least one. Returns 0 after forceAllThreadsToPop().
+	template<typename OutIt>
+	size_t popN(OutIt p_out, size_t p_max) {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_cv.wait(lock, [&]() { return !m_queue.empty() || m_terminateWaiting; });
+		if (m_terminateWaiting) return 0;
+		return popLocked(p_out, p_max);
+	}
+	template<typename OutIt>
+	size_t tryPopN(OutIt p_out, size_t p_max) {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		return popLocked(p_out, p_max);
+	}
+
 	// force threads to exit
 	void forceAllThreadsToPop() {
 		m_terminateWaiting = true;
@@ -54,13 +105,37 @@ public:
 		return m_queue.size();
 	}
 
-	static SharedQueue<T>& Get() {
-		static SharedQueue<T> instance;
+	static SharedQueue<T, Backend>& Get() {
+		static SharedQueue<T, Backend> instance;
 		return instance;
 	}
 private:
+	// must hold m_mutex
+	template<typename OutIt>
+	size_t popLocked(OutIt p_out, size_t p_max) {
+		size_t count = 0;
+		while (count < p_max && !m_queue.empty()) {
+			*p_out++ = std::move(m_queue.front());
+			m_queue.pop();
+			count++;
+		}
+		return count;
+	}
+
 	std::mutex m_mutex;
 	std::queue<T> m_queue;
 	std::condition_variable m_cv;
 	std::atomic<bool> m_terminateWaiting = false;
-};
\ No newline at end of file
+};
+
+template<typename T>
+// Same interface on top of the lock-free ring. Pass a capacity to the constructor if the default 1024 isn't enough.
+class SharedQueue<T, SharedQueueBackend::LOCK_FREE_RING> : public MPMCRing<T> {
+public:
+	using MPMCRing<T>::MPMCRing;
+
+	static SharedQueue<T, SharedQueueBackend::LOCK_FREE_RING>& Get() {
+		static SharedQueue<T, SharedQueueBackend::LOCK_FREE_RING> instance;
+		return instance;
+	}
+};
@@ -0,0 +1,204 @@
+#pragma once
+#include <new>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <cstddef>
+#include <stdint.h>
+
+// A small thread-safe block allocator with a handful of power of two size classes.
+// Freed blocks go on an intrusive freelist and get handed right back out, so after warming up nothing hits malloc.
+// Each thread keeps its own freelists for the arena it last used, and only takes the lock to move a batch of blocks
+// to or from the shared depot, same idea as ThreadPool's NodeCache. Anything too big or too aligned just falls through
+// to operator new.
+// Make it with make_shared, a thread's cached blocks only go back to the depot when it can get at the arena through a
+// weak_ptr. Otherwise they stay put until the arena is destroyed, which is fine, they're still part of its slabs.
+class SizeClassArena : public std::enable_shared_from_this<SizeClassArena> {
+public:
+	static constexpr size_t MIN_BLOCK_SIZE = 32;
+	static constexpr size_t CLASS_COUNT = 4; // 32, 64, 128, 256
+	static constexpr size_t BLOCKS_PER_SLAB = 64;
+	// a thread's cache gives half of a size class back to the depot once it holds this many, and takes half this many when empty
+	static constexpr size_t CACHE_LIMIT = 64;
+
+	SizeClassArena() : m_id(s_nextId.fetch_add(1, std::memory_order_relaxed)) {}
+	SizeClassArena(const SizeClassArena& other) = delete;
+	SizeClassArena& operator=(const SizeClassArena& other) = delete;
+
+	void* allocate(size_t p_bytes, size_t p_align) {
+		size_t sizeClass = classFor(p_bytes);
+		if (sizeClass >= CLASS_COUNT || p_align > alignof(std::max_align_t)) {
+			fallbackAllocs.fetch_add(1, std::memory_order_relaxed);
+			return ::operator new(p_bytes);
+		}
+		ThreadCache& cache = cacheForThisThread();
+		if (!cache.lists[sizeClass]) refill(cache, sizeClass);
+		FreeBlock* block = cache.lists[sizeClass];
+		cache.lists[sizeClass] = block->next;
+		cache.counts[sizeClass]--;
+		return block;
+	}
+
+	void deallocate(void* p_ptr, size_t p_bytes, size_t p_align) {
+		size_t sizeClass = classFor(p_bytes);
+		if (sizeClass >= CLASS_COUNT || p_align > alignof(std::max_align_t)) {
+			::operator delete(p_ptr);
+			return;
+		}
+		ThreadCache& cache = cacheForThisThread();
+		FreeBlock* block = static_cast<FreeBlock*>(p_ptr);
+		block->next = cache.lists[sizeClass];
+		cache.lists[sizeClass] = block;
+		if (++cache.counts[sizeClass] >= CACHE_LIMIT) spill(cache, sizeClass);
+	}
+
+	// All only ever go up. The first two are how often we actually had to ask the system for memory, depotTrips is how
+	// often a thread's cache ran dry or overflowed and had to take the lock.
+	std::atomic<uint64_t> slabAllocs{ 0 };
+	std::atomic<uint64_t> fallbackAllocs{ 0 };
+	std::atomic<uint64_t> depotTrips{ 0 };
+private:
+	struct FreeBlock {
+		FreeBlock* next;
+	};
+	// One per thread, holding blocks for whichever arena that thread used last. Arenas are told apart by id rather than
+	// address, since a new arena can land where a dead one was.
+	struct ThreadCache {
+		uint64_t arenaId = 0;
+		std::weak_ptr<SizeClassArena> arena;
+		FreeBlock* lists[CLASS_COUNT] = {};
+		size_t counts[CLASS_COUNT] = {};
+
+		~ThreadCache() {
+			release();
+		}
+		// hands everything back if the arena's still alive, otherwise just forgets it
+		void release() {
+			if (std::shared_ptr<SizeClassArena> owner = arena.lock()) owner->takeBack(*this);
+			arenaId = 0;
+			arena.reset();
+			for (size_t i = 0; i < CLASS_COUNT; i++) {
+				lists[i] = nullptr;
+				counts[i] = 0;
+			}
+		}
+	};
+
+	static size_t classFor(size_t p_bytes) {
+		size_t sizeClass = 0;
+		size_t blockSize = MIN_BLOCK_SIZE;
+		while (blockSize < p_bytes && sizeClass < CLASS_COUNT) {
+			blockSize <<= 1;
+			sizeClass++;
+		}
+		return sizeClass;
+	}
+
+	ThreadCache& cacheForThisThread() {
+		thread_local ThreadCache t_cache;
+		ThreadCache& cache = t_cache;
+		if (cache.arenaId != m_id) {
+			// a thread going back and forth between two arenas pays for it here, but that's not how they get used
+			cache.release();
+			cache.arenaId = m_id;
+			cache.arena = weak_from_this();
+		}
+		return cache;
+	}
+
+	void refill(ThreadCache& p_cache, size_t p_sizeClass) {
+		depotTrips.fetch_add(1, std::memory_order_relaxed);
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (!m_freeLists[p_sizeClass]) m_freeLists[p_sizeClass] = carveSlab(p_sizeClass);
+		// take up to half a cache's worth off the front
+		FreeBlock* first = m_freeLists[p_sizeClass];
+		FreeBlock* last = first;
+		size_t taken = 1;
+		while (taken < CACHE_LIMIT / 2 && last->next) {
+			last = last->next;
+			taken++;
+		}
+		m_freeLists[p_sizeClass] = last->next;
+		last->next = p_cache.lists[p_sizeClass];
+		p_cache.lists[p_sizeClass] = first;
+		p_cache.counts[p_sizeClass] += taken;
+	}
+	void spill(ThreadCache& p_cache, size_t p_sizeClass) {
+		depotTrips.fetch_add(1, std::memory_order_relaxed);
+		// the newest half stays, it's the warmest
+		FreeBlock* keepLast = p_cache.lists[p_sizeClass];
+		for (size_t i = 1; i < CACHE_LIMIT / 2; i++) keepLast = keepLast->next;
+		FreeBlock* first = keepLast->next;
+		keepLast->next = nullptr;
+		p_cache.counts[p_sizeClass] = CACHE_LIMIT / 2;
+		pushToDepot(p_sizeClass, first);
+	}
+	void takeBack(ThreadCache& p_cache) {
+		for (size_t i = 0; i < CLASS_COUNT; i++) {
+			if (p_cache.lists[i]) pushToDepot(i, p_cache.lists[i]);
+		}
+	}
+	// splices a whole chain onto the front of the depot's list
+	void pushToDepot(size_t p_sizeClass, FreeBlock* p_first) {
+		FreeBlock* last = p_first;
+		while (last->next) last = last->next;
+		std::unique_lock<std::mutex> lock(m_mutex);
+		last->next = m_freeLists[p_sizeClass];
+		m_freeLists[p_sizeClass] = p_first;
+	}
+
+	// must hold m_mutex
+	FreeBlock* carveSlab(size_t p_sizeClass) {
+		size_t blockSize = MIN_BLOCK_SIZE << p_sizeClass;
+		m_slabs.emplace_back(new std::max_align_t[(blockSize * BLOCKS_PER_SLAB) / sizeof(std::max_align_t)]);
+		slabAllocs.fetch_add(1, std::memory_order_relaxed);
+
+		unsigned char* base = reinterpret_cast<unsigned char*>(m_slabs.back().get());
+		for (size_t i = 0; i < BLOCKS_PER_SLAB; i++) {
+			FreeBlock* block = reinterpret_cast<FreeBlock*>(base + i * blockSize);
+			block->next = (i + 1 < BLOCKS_PER_SLAB) ? reinterpret_cast<FreeBlock*>(base + (i + 1) * blockSize) : nullptr;
+		}
+		return reinterpret_cast<FreeBlock*>(base);
+	}
+
+	// starts at 1 so a fresh ThreadCache never matches anything
+	inline static std::atomic<uint64_t> s_nextId{ 1 };
+
+	const uint64_t m_id;
+	std::mutex m_mutex;
+	FreeBlock* m_freeLists[CLASS_COUNT] = {};
+	std::vector<std::unique_ptr<std::max_align_t[]>> m_slabs;
+};
+
+template<typename T>
+// Standard allocator that draws from a shared SizeClassArena.
+// Holds a shared_ptr so anything allocated from it (like a future's shared state) can safely outlive whoever made the arena.
+class ArenaAllocator {
+public:
+	using value_type = T;
+
+	ArenaAllocator(std::shared_ptr<SizeClassArena> p_arena) : m_arena(std::move(p_arena)) {}
+	template<typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) : m_arena(other.m_arena) {}
+
+	T* allocate(size_t p_count) {
+		return static_cast<T*>(m_arena->allocate(p_count * sizeof(T), alignof(T)));
+	}
+	void deallocate(T* p_ptr, size_t p_count) {
+		m_arena->deallocate(p_ptr, p_count * sizeof(T), alignof(T));
+	}
+
+	template<typename U>
+	bool operator==(const ArenaAllocator<U>& other) const {
+		return m_arena == other.m_arena;
+	}
+	template<typename U>
+	bool operator!=(const ArenaAllocator<U>& other) const {
+		return m_arena != other.m_arena;
+	}
+private:
+	template<typename U>
+	friend class ArenaAllocator;
+	std::shared_ptr<SizeClassArena> m_arena;
+};
@@ -0,0 +1,164 @@
+#pragma once
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <stdint.h>
+
+// Refers to one entry of a SlotMap or ConcurrentSlotMap. Stays valid while the entry is alive no matter what else gets
+// added or removed, and once the entry is erased every lookup with it fails, even if the slot gets reused.
+struct SlotHandle {
+	uint32_t index = UINT32_MAX;
+	uint32_t generation = 0;
+
+	bool isNull() const {
+		return index == UINT32_MAX;
+	}
+	bool operator==(const SlotHandle& other) const {
+		return index == other.index && generation == other.generation;
+	}
+	bool operator!=(const SlotHandle& other) const {
+		return !(*this == other);
+	}
+};
+
+template<typename T>
+// Values are kept packed together in one vector, so iterating is a straight walk over memory.
+// Handles go through a sparse slot table that tracks where each value currently lives, plus a generation number that
+// gets bumped whenever a slot is emptied, which is how stale handles get caught.
+// Insert, erase and lookup are all O(1). Erasing moves the last value into the hole, so order isn't kept.
+// Replaces DynArray and SharedDynArray.
+class SlotMap {
+public:
+	SlotMap() {}
+
+	template<typename... Args>
+	SlotHandle emplace(Args&&... p_args) {
+		// the value goes first, so if constructing it throws there's nothing to undo
+		m_values.emplace_back(std::forward<Args>(p_args)...);
+		uint32_t slotIndex;
+		try {
+			// follow m_values' growth, reserving one more each time would copy the whole thing on every insert
+			if (m_valueSlots.capacity() < m_values.size()) m_valueSlots.reserve(m_values.capacity());
+			slotIndex = acquireSlot();
+		}
+		catch (...) {
+			m_values.pop_back();
+			throw;
+		}
+		m_valueSlots.push_back(slotIndex); // reserved, can't throw
+
+		Slot& slot = m_slots[slotIndex];
+		slot.generation++; // now odd, so it's live
+		slot.target = (uint32_t)(m_values.size() - 1);
+		return { slotIndex, slot.generation };
+	}
+	SlotHandle insert(const T& p_value) {
+		return emplace(p_value);
+	}
+	SlotHandle insert(T&& p_value) {
+		return emplace(std::move(p_value));
+	}
+
+	// Returns false if the handle was already stale.
+	bool erase(SlotHandle p_handle) {
+		if (!contains(p_handle)) return false;
+		Slot& slot = m_slots[p_handle.index];
+		uint32_t hole = slot.target;
+		uint32_t last = (uint32_t)(m_values.size() - 1);
+		if (hole != last) {
+			m_values[hole] = std::move(m_values[last]);
+			m_valueSlots[hole] = m_valueSlots[last];
+			m_slots[m_valueSlots[hole]].target = hole;
+		}
+		m_values.pop_back();
+		m_valueSlots.pop_back();
+		releaseSlot(p_handle.index);
+		return true;
+	}
+
+	bool contains(SlotHandle p_handle) const {
+		return p_handle.index < m_slots.size() && m_slots[p_handle.index].generation == p_handle.generation && (p_handle.generation & 1);
+	}
+	// nullptr if the handle is stale. The pointer is only good until the next insert or erase.
+	T* get(SlotHandle p_handle) {
+		if (!contains(p_handle)) return nullptr;
+		return &m_values[m_slots[p_handle.index].target];
+	}
+	const T* get(SlotHandle p_handle) const {
+		if (!contains(p_handle)) return nullptr;
+		return &m_values[m_slots[p_handle.index].target];
+	}
+
+	// The handle of the value currently at p_denseIndex, for when you're iterating and need to know what you're looking at.
+	SlotHandle handleAt(size_t p_denseIndex) const {
+		uint32_t slotIndex = m_valueSlots[p_denseIndex];
+		return { slotIndex, m_slots[slotIndex].generation };
+	}
+
+	size_t size() const {
+		return m_values.size();
+	}
+	bool empty() const {
+		return m_values.empty();
+	}
+	void reserve(size_t p_count) {
+		m_values.reserve(p_count);
+		m_valueSlots.reserve(p_count);
+		m_slots.reserve(p_count);
+	}
+	// Every outstanding handle goes stale.
+	void clear() {
+		for (uint32_t slotIndex : m_valueSlots) releaseSlot(slotIndex);
+		m_values.clear();
+		m_valueSlots.clear();
+	}
+
+	T* data() {
+		return m_values.data();
+	}
+	auto begin() {
+		return m_values.begin();
+	}
+	auto end() {
+		return m_values.end();
+	}
+	auto begin() const {
+		return m_values.begin();
+	}
+	auto end() const {
+		return m_values.end();
+	}
+private:
+	static constexpr uint32_t NO_FREE_SLOT = UINT32_MAX;
+
+	struct Slot {
+		// where the value lives in m_values while the slot is live, the next free slot while it isn't
+		uint32_t target = NO_FREE_SLOT;
+		// odd while live, even while free
+		uint32_t generation = 0;
+	};
+
+	uint32_t acquireSlot() {
+		if (m_freeHead != NO_FREE_SLOT) {
+			uint32_t slotIndex = m_freeHead;
+			m_freeHead = m_slots[slotIndex].target;
+			return slotIndex;
+		}
+		m_slots.emplace_back();
+		return (uint32_t)(m_slots.size() - 1);
+	}
+	void releaseSlot(uint32_t p_slotIndex) {
+		Slot& slot = m_slots[p_slotIndex];
+		slot.generation++;
+		// a slot whose generation is about to wrap around is never reused, or an ancient handle could match it again
+		if (slot.generation >= UINT32_MAX - 1) return;
+		slot.target = m_freeHead;
+		m_freeHead = p_slotIndex;
+	}
+
+	std::vector<T> m_values;
+	// which slot each value belongs to, parallel to m_values
+	std::vector<uint32_t> m_valueSlots;
+	std::vector<Slot> m_slots;
+	uint32_t m_freeHead = NO_FREE_SLOT;
+};
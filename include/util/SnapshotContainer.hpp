@@ -0,0 +1,169 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <unordered_map>
+#include <optional>
+#include <utility>
+#include <functional>
+#include "EpochDomain.hpp"
+
+template<typename T>
+// Copy on write wrapper for tables that get written at load time and read constantly after that.
+// Readers pin the epoch domain and load one pointer, and never take a lock or do an atomic read-modify-write,
+// so any number of threads can read at once without slowing each other down.
+// Writers copy the whole table, change the copy, and swap it in. The old version is freed once nobody can be reading it,
+// which makes writes expensive, so batch them up with update() where you can.
+class CowSnapshot {
+public:
+	CowSnapshot(EpochDomain& p_domain = EpochDomain::Get()) : m_domain(p_domain), m_current(new T()) {}
+	CowSnapshot(T p_initial, EpochDomain& p_domain = EpochDomain::Get()) : m_domain(p_domain), m_current(new T(std::move(p_initial))) {}
+	CowSnapshot(const CowSnapshot& other) = delete;
+	CowSnapshot& operator=(const CowSnapshot& other) = delete;
+	// Nobody can be reading by now, so the last version can go straight away.
+	~CowSnapshot() {
+		delete m_current.load(std::memory_order_acquire);
+	}
+
+	// Keeps one version of the table alive and unchanged for as long as it's around, even if it gets replaced meanwhile.
+	// Don't hold onto one across frames, it stops every retired version in the domain from being freed.
+	class ReadHandle {
+	public:
+		ReadHandle(const CowSnapshot& p_owner) : m_guard(p_owner.m_domain), m_data(p_owner.m_current.load(std::memory_order_acquire)) {}
+
+		const T& operator*() const {
+			return *m_data;
+		}
+		const T* operator->() const {
+			return m_data;
+		}
+		const T* get() const {
+			return m_data;
+		}
+	private:
+		EpochDomain::Guard m_guard;
+		const T* m_data;
+	};
+
+	ReadHandle read() const {
+		return ReadHandle(*this);
+	}
+	// Calls p_fn(const T&) on the current version and returns whatever it returns.
+	template<typename F>
+	auto read(F&& p_fn) const {
+		EpochDomain::Guard guard(m_domain);
+		return p_fn(*m_current.load(std::memory_order_acquire));
+	}
+
+	// Copies the current version, lets p_fn(T&) change the copy, then publishes it. Writers are serialized.
+	template<typename F>
+	void update(F&& p_fn) {
+		std::unique_lock<std::mutex> lock(m_writeMutex);
+		T* next = new T(*m_current.load(std::memory_order_relaxed));
+		try {
+			p_fn(*next);
+		}
+		catch (...) {
+			delete next;
+			throw;
+		}
+		publish(next);
+	}
+	// Replaces the whole table without copying the old one.
+	void store(T p_value) {
+		std::unique_lock<std::mutex> lock(m_writeMutex);
+		publish(new T(std::move(p_value)));
+	}
+
+	// Goes up by one for every published write, handy for noticing that something cached off the table is stale.
+	uint64_t version() const {
+		return m_version.load(std::memory_order_acquire);
+	}
+protected:
+	// must hold m_writeMutex
+	void publish(T* p_next) {
+		const T* old = m_current.exchange(p_next, std::memory_order_seq_cst);
+		m_version.fetch_add(1, std::memory_order_release);
+		m_domain.retire(old);
+	}
+
+	EpochDomain& m_domain;
+	std::atomic<const T*> m_current;
+	std::atomic<uint64_t> m_version{ 0 };
+	std::mutex m_writeMutex;
+};
+
+template<typename Kty, typename Ty, typename Hasher = std::hash<Kty>>
+// Read mostly hash map, for resource registries and the like. See CowSnapshot.
+class SnapshotMap : public CowSnapshot<std::unordered_map<Kty, Ty, Hasher>> {
+public:
+	using Map = std::unordered_map<Kty, Ty, Hasher>;
+	using CowSnapshot<Map>::CowSnapshot;
+
+	std::optional<Ty> find(const Kty& p_key) const {
+		return this->read([&](const Map& p_map) -> std::optional<Ty> {
+			auto itr = p_map.find(p_key);
+			if (itr == p_map.end()) return std::nullopt;
+			return itr->second;
+		});
+	}
+	bool contains(const Kty& p_key) const {
+		return this->read([&](const Map& p_map) { return p_map.contains(p_key); });
+	}
+	// Calls p_fn(const Ty&) without copying the value out. Returns false if there's no such key.
+	template<typename F>
+	bool visit(const Kty& p_key, F&& p_fn) const {
+		return this->read([&](const Map& p_map) {
+			auto itr = p_map.find(p_key);
+			if (itr == p_map.end()) return false;
+			p_fn(itr->second);
+			return true;
+		});
+	}
+	size_t size() const {
+		return this->read([](const Map& p_map) { return p_map.size(); });
+	}
+
+	// Each of these copies the whole map, use update() to make several changes at once.
+	void insert_or_assign(const Kty& p_key, Ty p_value) {
+		this->update([&](Map& p_map) { p_map.insert_or_assign(p_key, std::move(p_value)); });
+	}
+	bool erase(const Kty& p_key) {
+		if (!contains(p_key)) return false;
+		bool erased = false;
+		this->update([&](Map& p_map) { erased = p_map.erase(p_key) > 0; });
+		return erased;
+	}
+};
+
+template<typename T>
+// Read mostly vector. See CowSnapshot.
+class SnapshotVector : public CowSnapshot<std::vector<T>> {
+public:
+	using Vector = std::vector<T>;
+	using CowSnapshot<Vector>::CowSnapshot;
+
+	std::optional<T> at(size_t p_index) const {
+		return this->read([&](const Vector& p_vec) -> std::optional<T> {
+			if (p_index >= p_vec.size()) return std::nullopt;
+			return p_vec[p_index];
+		});
+	}
+	size_t size() const {
+		return this->read([](const Vector& p_vec) { return p_vec.size(); });
+	}
+
+	// Each of these copies the whole vector, use update() to make several changes at once.
+	void push_back(T p_value) {
+		this->update([&](Vector& p_vec) { p_vec.push_back(std::move(p_value)); });
+	}
+	bool set(size_t p_index, T p_value) {
+		bool inRange = false;
+		this->update([&](Vector& p_vec) {
+			if (p_index >= p_vec.size()) return;
+			p_vec[p_index] = std::move(p_value);
+			inRange = true;
+		});
+		return inRange;
+	}
+};
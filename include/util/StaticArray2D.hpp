@@ -3,9 +3,12 @@
 #include <vector>
 #include "Framework/Log.hpp"
 #include <algorithm>
-template<class T>
+#include "ArrayOps.hpp"
+#include "GridAllocator.hpp"
+template<class T, class Allocator = MallocGridAllocator>
 // an Array2D that keeps its data in a raw pointer, handles its own memory
-// Allocated data must be past in externally at the moment, serves as a wrapper.
+// Data can be past in externally with setData(), or allocate() can make it through Allocator (see GridAllocator.hpp).
+// Rows are pitch elements apart in memory, which is only bigger than width with AlignedGridAllocator.
 // WARNING: DOES NOT BOUNDS CHECK
 // IF YOU READ OUT OF BOUNDS IT'S YOUR OWN FAULT, LOL
 class StaticArray2D {
@@ -14,22 +17,24 @@ public:
 	StaticArray2D(uint32_t p_width, uint32_t p_height) {
 		width = p_width;
 		height = p_height;
+		pitch = p_width;
 	}
-	StaticArray2D(const StaticArray2D<T>& other) = delete;
+	StaticArray2D(const StaticArray2D<T, Allocator>& other) = delete;
 
-	StaticArray2D(StaticArray2D<T>&& other) noexcept {
+	StaticArray2D(StaticArray2D<T, Allocator>&& other) noexcept {
 		data = other.data;
 		other.data = nullptr;
 		initialized = other.initialized;
 		other.initialized = false;
 		width = other.width;
 		height = other.height;
+		pitch = other.pitch;
 	}
 
 	~StaticArray2D() {
-		if (data) free(data);
+		if (data) Allocator::release(data);
 	}
-	StaticArray2D<T> operator=(const StaticArray2D<T>& other) = delete;
+	StaticArray2D<T, Allocator> operator=(const StaticArray2D<T, Allocator>& other) = delete;
 
 	T& operator()(int x, int y) {
 #ifdef _DEBUG
@@ -39,7 +44,7 @@ public:
 		}
 #endif
 		if (!initialized) throw std::exception("uninitialized 2d array access");
-		return data[((y * width) + x)];
+		return data[((y * pitch) + x)];
 	}
 	// Can only be ran if the array does not have data, otherwise, it is fixed and cannot change
 	void resize(uint32_t p_width, uint32_t p_height) {
@@ -50,16 +55,75 @@ public:
 		}
 		width = p_width;
 		height = p_height;
+		pitch = p_width;
 	}
 
-	void fill(T p_fillValue) {
+	// Makes the array own fresh memory for its current size, every cell set to p_fillValue. Drops whatever it held before.
+	void allocate(const GridAllocOptions& p_options = GridAllocOptions(), T p_fillValue = T()) {
+		if (data) Allocator::release(data);
+		pitch = Allocator::pitchFor(width, sizeof(T), p_options);
+		data = static_cast<T*>(Allocator::allocate(pitch * height * sizeof(T), p_options));
+		initialized = true;
+		// this is the first touch, so with a pool each page lands on the NUMA node of whoever filled it
+		ArrayOps::fill(data, pitch * height, p_fillValue, p_options.firstTouchPool);
+	}
+
+	// The bulk operations below take an optional pool to split big arrays across, see ArrayOps.
+	void fill(T p_fillValue, ThreadPool* p_pool = nullptr) {
 		if (!initialized) throw std::exception();
-		for (size_t i = 0; i < width * height; i++) {
-			data[i] = p_fillValue;
-		}
+		// padding gets filled too, it's cheaper than going row by row
+		ArrayOps::fill(data, pitch * height, p_fillValue, p_pool);
+	}
+	// Replaces every cell with p_fn(const T&).
+	template<typename F>
+	void transform(F&& p_fn, ThreadPool* p_pool = nullptr) {
+		if (!initialized) throw std::exception();
+		ArrayOps::transform(data, pitch * height, std::forward<F>(p_fn), p_pool);
+	}
+	template<typename F>
+	T reduce(T p_init, F&& p_fn, ThreadPool* p_pool = nullptr) const {
+		if (!initialized) throw std::exception();
+		if (width == 0 || height == 0) return p_init;
+		// each row folds from its own first cell, so p_init only goes in once, in reduceRows()
+		return reduceRows(p_init, [&](const T* p_row, size_t p_count) { return ArrayOps::reduce(p_row + 1, p_count - 1, p_row[0], p_fn, p_pool); }, p_fn, p_pool);
+	}
+	T min(ThreadPool* p_pool = nullptr) const {
+		if (!initialized) throw std::exception();
+		if (width == 0 || height == 0) return T();
+		return reduceRows(data[0], [&](const T* p_row, size_t p_count) { return ArrayOps::min(p_row, p_count, p_pool); },
+			[](const T& a, const T& b) { return b < a ? b : a; }, p_pool);
+	}
+	T max(ThreadPool* p_pool = nullptr) const {
+		if (!initialized) throw std::exception();
+		if (width == 0 || height == 0) return T();
+		return reduceRows(data[0], [&](const T* p_row, size_t p_count) { return ArrayOps::max(p_row, p_count, p_pool); },
+			[](const T& a, const T& b) { return a < b ? b : a; }, p_pool);
+	}
+	ArraySumType<T> sum(ThreadPool* p_pool = nullptr) const {
+		if (!initialized) throw std::exception();
+		return reduceRows(ArraySumType<T>(), [&](const T* p_row, size_t p_count) { return ArrayOps::sum(p_row, p_count, p_pool); },
+			[](const ArraySumType<T>& a, const ArraySumType<T>& b) { return a + b; }, p_pool);
+	}
+	template<typename Pred>
+	size_t countIf(Pred&& p_pred, ThreadPool* p_pool = nullptr) const {
+		if (!initialized) throw std::exception();
+		return reduceRows(size_t(0), [&](const T* p_row, size_t p_count) { return ArrayOps::countIf(p_row, p_count, p_pred, p_pool); },
+			[](size_t a, size_t b) { return a + b; }, p_pool);
+	}
+	// Copies the p_width x p_height block at (p_srcX, p_srcY) in p_src to (p_dstX, p_dstY) here.
+	// Whatever hangs off the edge of either array is clipped. p_src can't be this array.
+	void copyRegion(const StaticArray2D<T, Allocator>& p_src, size_t p_srcX, size_t p_srcY, size_t p_width, size_t p_height, size_t p_dstX, size_t p_dstY, ThreadPool* p_pool = nullptr) {
+		if (!initialized || !p_src.initialized) throw std::exception();
+		if (p_srcX >= p_src.width || p_srcY >= p_src.height || p_dstX >= width || p_dstY >= height) return;
+		p_width = std::min({ p_width, p_src.width - p_srcX, width - p_dstX });
+		p_height = std::min({ p_height, p_src.height - p_srcY, height - p_dstY });
+		ArrayOps::copy2D(p_src.data + p_srcY * p_src.pitch + p_srcX, p_src.pitch, data + p_dstY * pitch + p_dstX, pitch, p_width, p_height, p_pool);
 	}
+	// p_data has to have come from Allocator, and rows are taken as packed.
 	void setData(T* p_data) {
+		if (data && data != p_data) Allocator::release(data);
 		data = p_data;
+		pitch = width;
 		initialized = true;
 	}
 	T* getData() {
@@ -73,22 +137,57 @@ public:
 	}
 
 	void reverse() {
-		std::reverse(data, &data[width * height]);
+		if (pitch == width) {
+			std::reverse(data, &data[width * height]);
+			return;
+		}
+		// flip the row order, then each row
+		for (size_t y = 0; y < height / 2; y++) std::swap_ranges(data + y * pitch, data + y * pitch + width, data + (height - 1 - y) * pitch);
+		for (size_t y = 0; y < height; y++) std::reverse(data + y * pitch, data + y * pitch + width);
 	}
 
 	void clear() {
-		memset(data, 0, width * height * sizeof(T));
+		memset(data, 0, pitch * height * sizeof(T));
 	}
 
 	void reset() {
-		if (data) free(data);
+		if (data) Allocator::release(data);
+		data = nullptr;
 		width = 0;
 		height = 0;
+		pitch = 0;
 		initialized = false;
 	}
 	size_t width;
 	size_t height;
+	// elements from the start of one row to the next
+	size_t pitch = 0;
 	bool initialized = false;
 private:
-	T* data;
+	// Packed arrays go to p_fn in one go. Padded ones go row by row, spread over the pool when they're big enough.
+	// Each block of rows folds from its own first row and p_init is combined in once at the front, so p_fn shouldn't
+	// fold it in itself.
+	template<typename R, typename RowF, typename CombineF>
+	R reduceRows(R p_init, RowF&& p_fn, CombineF&& p_combine, ThreadPool* p_pool) const {
+		if (pitch == width) return p_combine(p_init, p_fn(data, width * height));
+		if (height == 0) return p_init;
+		size_t rowsPerTask = height;
+		if (p_pool && width * height * sizeof(T) >= ArrayOps::PARALLEL_MIN_BYTES) {
+			rowsPerTask = std::max<size_t>(1, ArrayOps::PARALLEL_GRAIN_BYTES / (width * sizeof(T)));
+		}
+		// p_init is only a placeholder here, every slot gets overwritten
+		std::vector<R> partials((height + rowsPerTask - 1) / rowsPerTask, p_init);
+		auto foldRows = [&](size_t p_first, size_t p_last) {
+			R acc = p_fn(data + p_first * pitch, width);
+			for (size_t y = p_first + 1; y < p_last; y++) acc = p_combine(std::move(acc), p_fn(data + y * pitch, width));
+			partials[p_first / rowsPerTask] = std::move(acc);
+		};
+		if (partials.size() > 1) p_pool->parallelFor(0, height, rowsPerTask, foldRows);
+		else foldRows(0, height);
+		R out = p_init;
+		for (R& partial : partials) out = p_combine(std::move(out), std::move(partial));
+		return out;
+	}
+
+	T* data = nullptr;
 };
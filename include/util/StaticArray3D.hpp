@@ -4,18 +4,21 @@
 #include <vector>
 #include "Framework/Log.hpp"
 #include <algorithm>
-template<class T>
+#include "ArrayOps.hpp"
+#include "GridAllocator.hpp"
+template<class T, class Allocator = MallocGridAllocator>
 // an Array2D that keeps its data in a raw pointer, handles its own memory
-// Allocated data must be past in externally at the moment, serves as a wrapper.
+// Data can be past in externally with setData(), or allocate() can make it through Allocator (see GridAllocator.hpp).
+// Rows are pitch elements apart in memory and slices pitch * height, pitch is only bigger than width with AlignedGridAllocator.
 // WARNING: DOES NOT BOUNDS CHECK
 // IF YOU READ OUT OF BOUNDS IT'S YOUR OWN FAULT, LOL
 class StaticArray3D {
 public:
 	StaticArray3D() : width(0), height(0), data(nullptr), invertDepth(false) {}
-	StaticArray3D(size_t p_width, size_t p_height, size_t p_depth) : width(p_width), height(p_height), depth(p_depth), data(nullptr), invertDepth(false) {}
-	StaticArray3D(const StaticArray3D<T>& other) = delete;
+	StaticArray3D(size_t p_width, size_t p_height, size_t p_depth) : width(p_width), height(p_height), depth(p_depth), pitch(p_width), data(nullptr), invertDepth(false) {}
+	StaticArray3D(const StaticArray3D<T, Allocator>& other) = delete;
 
-	StaticArray3D(StaticArray3D<T>&& other) noexcept {
+	StaticArray3D(StaticArray3D<T, Allocator>&& other) noexcept {
 		data = other.data;
 		other.data = nullptr;
 		initialized = other.initialized;
@@ -23,12 +26,13 @@ public:
 		width = other.width;
 		height = other.height;
 		depth = other.depth;
+		pitch = other.pitch;
 	}
 
 	~StaticArray3D() {
-		if (data) free(data);
+		if (data) Allocator::release(data);
 	}
-	StaticArray3D<T> operator=(const StaticArray3D<T>& other) = delete;
+	StaticArray3D<T, Allocator> operator=(const StaticArray3D<T, Allocator>& other) = delete;
 
 	T& operator()(size_t x, size_t y, size_t z) {
 #ifdef _DEBUG
@@ -37,10 +41,10 @@ public:
 		}
 #endif
 		if (!invertDepth) {
-			return data[(z * width * height) + ((y * width) + x)];
+			return data[(((z * height) + y) * pitch) + x];
 		}
 		else {
-			return data[((depth - 1 - z) * width * height) + ((y * width) + x)];
+			return data[((((depth - 1 - z) * height) + y) * pitch) + x];
 		}
 
 	}
@@ -54,16 +58,28 @@ public:
 		width = p_width;
 		height = p_height;
 		depth = p_depth;
+		pitch = p_width;
 	}
 
-	void fill(T p_fillValue) {
+	// Makes the array own fresh memory for its current size, every cell set to p_fillValue. Drops whatever it held before.
+	void allocate(const GridAllocOptions& p_options = GridAllocOptions(), T p_fillValue = T()) {
+		if (data) Allocator::release(data);
+		pitch = Allocator::pitchFor(width, sizeof(T), p_options);
+		data = static_cast<T*>(Allocator::allocate(pitch * height * depth * sizeof(T), p_options));
+		initialized = true;
+		// this is the first touch, so with a pool each page lands on the NUMA node of whoever filled it
+		ArrayOps::fill(data, pitch * height * depth, p_fillValue, p_options.firstTouchPool);
+	}
+
+	void fill(T p_fillValue, ThreadPool* p_pool = nullptr) {
 		if (!initialized) throw std::exception();
-		for (size_t i = 0; i < width * height; i++) {
-			data[i] = p_fillValue;
-		}
+		ArrayOps::fill(data, pitch * height * depth, p_fillValue, p_pool);
 	}
+	// p_data has to have come from Allocator, and rows are taken as packed.
 	void setData(T* p_data) {
+		if (data && data != p_data) Allocator::release(data);
 		data = p_data;
+		pitch = width;
 		initialized = true;
 	}
 	T* getData() {
@@ -77,22 +93,33 @@ public:
 	}
 
 	void reverse() {
-		std::reverse(data, &data[width * height * depth]);
+		if (pitch == width) {
+			std::reverse(data, &data[width * height * depth]);
+			return;
+		}
+		// flip the row order, then each row
+		size_t rows = height * depth;
+		for (size_t r = 0; r < rows / 2; r++) std::swap_ranges(data + r * pitch, data + r * pitch + width, data + (rows - 1 - r) * pitch);
+		for (size_t r = 0; r < rows; r++) std::reverse(data + r * pitch, data + r * pitch + width);
 	}
 
 	void clear() {
-		memset(data, 0, width * height * depth * sizeof(T));
+		memset(data, 0, pitch * height * depth * sizeof(T));
 	}
 
 	void reset() {
-		if (data) free(data);
+		if (data) Allocator::release(data);
+		data = nullptr;
 		width = 0;
 		height = 0;
+		pitch = 0;
 		initialized = false;
 	}
 	size_t width;
 	size_t height;
 	size_t depth;
+	// elements from the start of one row to the next
+	size_t pitch = 0;
 	bool initialized = false;
 	bool invertDepth;
 private:
@@ -0,0 +1,229 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <string_view>
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <exception>
+#include "Threadpool.hpp"
+
+// A dependency graph of tasks that runs on a ThreadPool.
+// Build it once with addTask() and precede(), then call run() every frame. Each node counts down its unfinished dependencies,
+// and whoever finishes the last one kicks off the successor, so nothing ever blocks on a future inside the pool.
+// Re-running a graph reuses all of its storage, so a run doesn't allocate anything.
+class TaskGraph {
+public:
+	using NodeID = size_t;
+
+	TaskGraph() {}
+	TaskGraph(const TaskGraph& other) = delete;
+	TaskGraph& operator=(const TaskGraph& other) = delete;
+
+	template <typename F>
+	NodeID addTask(std::string_view p_name, F&& p_fn) {
+		if (m_running) throw std::runtime_error("Cannot modify a task graph while it is running.");
+		m_nodes.emplace_back();
+		Node& node = m_nodes.back();
+		node.name = p_name;
+		node.fn = std::forward<F>(p_fn);
+		m_validated = false;
+		return m_nodes.size() - 1;
+	}
+
+	// p_after won't start until p_before has finished.
+	void precede(NodeID p_before, NodeID p_after) {
+		if (m_running) throw std::runtime_error("Cannot modify a task graph while it is running.");
+		if (p_before >= m_nodes.size() || p_after >= m_nodes.size() || p_before == p_after) {
+			ERROR_LOG("Invalid task graph edge " << p_before << " -> " << p_after);
+			throw std::invalid_argument("Bad task graph edge");
+		}
+		m_nodes[p_before].successors.push_back(p_after);
+		m_nodes[p_after].dependencyCount++;
+		m_validated = false;
+	}
+
+	// Runs every node once and returns when they're all done. The calling thread helps out in the meantime.
+	// The first exception thrown by a node gets rethrown here, after the rest of the graph has finished.
+	void run(ThreadPool& p_pool) {
+		if (m_nodes.empty()) return;
+		if (m_running.exchange(true)) throw std::runtime_error("Task graph is already running.");
+		if (!m_validated) validate();
+
+		m_pool = &p_pool;
+		m_error = nullptr;
+		for (auto& node : m_nodes) {
+			node.pending.store(node.dependencyCount, std::memory_order_relaxed);
+		}
+		m_remaining.store(m_nodes.size(), std::memory_order_release);
+		m_runStart = std::chrono::high_resolution_clock::now();
+
+		for (NodeID root : m_roots) {
+			p_pool.submit([this, root] { runNode(root); });
+		}
+		while (m_remaining.load(std::memory_order_acquire) > 0) {
+			if (!p_pool.tryRunPendingTask()) std::this_thread::yield();
+		}
+		m_runEnd = std::chrono::high_resolution_clock::now();
+		m_pool = nullptr;
+		m_running = false;
+
+		if (m_error) std::rethrow_exception(m_error);
+	}
+
+	// Prints when each node of the last run started and how long it took, followed by the critical path,
+	// the chain of dependent nodes with the longest total time. That chain is the floor for how fast the graph can go.
+	void dumpTimings(std::ostream& p_os = std::cout) const {
+		if (!m_validated) {
+			p_os << "Task graph hasn't been run yet.\n";
+			return;
+		}
+		p_os << "Task graph, " << m_nodes.size() << " nodes, " << msBetween(m_runStart, m_runEnd) << "ms total\n";
+		p_os << std::fixed << std::setprecision(3);
+		for (NodeID id : m_order) {
+			const Node& node = m_nodes[id];
+			p_os << "  " << std::setw(24) << std::left << node.name << std::right
+				<< " start " << std::setw(9) << msBetween(m_runStart, node.start) << "ms"
+				<< "  took " << std::setw(9) << msBetween(node.start, node.end) << "ms"
+				<< "  worker " << node.worker << "\n";
+		}
+
+		// longest path by duration, walked in topological order
+		std::vector<double> pathCost(m_nodes.size(), 0.0);
+		std::vector<NodeID> pathPrev(m_nodes.size(), m_nodes.size());
+		for (NodeID id : m_order) {
+			pathCost[id] += msBetween(m_nodes[id].start, m_nodes[id].end);
+			for (NodeID succ : m_nodes[id].successors) {
+				if (pathCost[id] > pathCost[succ]) {
+					pathCost[succ] = pathCost[id];
+					pathPrev[succ] = id;
+				}
+			}
+		}
+		NodeID tail = 0;
+		for (NodeID id = 0; id < m_nodes.size(); id++) {
+			if (pathCost[id] > pathCost[tail]) tail = id;
+		}
+		std::vector<NodeID> path;
+		for (NodeID id = tail; id < m_nodes.size(); id = pathPrev[id]) path.push_back(id);
+
+		p_os << "Critical path (" << pathCost[tail] << "ms): ";
+		for (auto itr = path.rbegin(); itr != path.rend(); itr++) {
+			p_os << m_nodes[*itr].name << (itr + 1 != path.rend() ? " -> " : "\n");
+		}
+		p_os << std::defaultfloat;
+	}
+
+	size_t size() const {
+		return m_nodes.size();
+	}
+	void clear() {
+		if (m_running) throw std::runtime_error("Cannot modify a task graph while it is running.");
+		m_nodes.clear();
+		m_roots.clear();
+		m_order.clear();
+		m_validated = false;
+	}
+private:
+	using TimePoint = std::chrono::time_point<std::chrono::high_resolution_clock>;
+
+	struct Node {
+		Node() {}
+		// only here so std::vector can grow, never called while the graph is running
+		Node(Node&& other) noexcept :
+			name(std::move(other.name)),
+			fn(std::move(other.fn)),
+			successors(std::move(other.successors)),
+			dependencyCount(other.dependencyCount)
+		{}
+
+		std::string name;
+		std::function<void()> fn;
+		std::vector<NodeID> successors;
+		uint32_t dependencyCount = 0;
+		std::atomic<uint32_t> pending{ 0 };
+
+		TimePoint start;
+		TimePoint end;
+		int worker = -1;
+	};
+
+	static double msBetween(TimePoint p_a, TimePoint p_b) {
+		return std::chrono::duration<double, std::milli>(p_b - p_a).count();
+	}
+
+	void runNode(NodeID p_id) {
+		// grabbed up front, once m_remaining hits zero the graph might already be gone
+		const NodeID none = m_nodes.size();
+		while (true) {
+			Node& node = m_nodes[p_id];
+			node.worker = m_pool->currentWorkerIndex();
+			node.start = std::chrono::high_resolution_clock::now();
+			try {
+				node.fn();
+			}
+			catch (...) {
+				std::unique_lock<std::mutex> lock(m_errorMutex);
+				if (!m_error) m_error = std::current_exception();
+			}
+			node.end = std::chrono::high_resolution_clock::now();
+
+			// The first successor that becomes ready runs right here instead of taking a trip through the queue.
+			NodeID next = none;
+			for (NodeID succ : node.successors) {
+				if (m_nodes[succ].pending.fetch_sub(1, std::memory_order_acq_rel) != 1) continue;
+				if (next == none) {
+					next = succ;
+				}
+				else {
+					m_pool->submit([this, succ] { runNode(succ); });
+				}
+			}
+			m_remaining.fetch_sub(1, std::memory_order_acq_rel);
+			if (next == none) return;
+			p_id = next;
+		}
+	}
+
+	// Finds the roots and a topological order, and makes sure there are no cycles. Only redone after the graph changes.
+	void validate() {
+		m_roots.clear();
+		m_order.clear();
+		std::vector<uint32_t> remaining(m_nodes.size());
+		for (NodeID id = 0; id < m_nodes.size(); id++) {
+			remaining[id] = m_nodes[id].dependencyCount;
+			if (remaining[id] == 0) {
+				m_roots.push_back(id);
+				m_order.push_back(id);
+			}
+		}
+		for (size_t i = 0; i < m_order.size(); i++) {
+			for (NodeID succ : m_nodes[m_order[i]].successors) {
+				if (--remaining[succ] == 0) m_order.push_back(succ);
+			}
+		}
+		if (m_order.size() != m_nodes.size()) {
+			m_running = false;
+			ERROR_LOG("Task graph has a cycle in it, " << m_nodes.size() - m_order.size() << " nodes can never run.");
+			throw std::runtime_error("Task graph cycle");
+		}
+		m_validated = true;
+	}
+
+	std::vector<Node> m_nodes;
+	std::vector<NodeID> m_roots;
+	std::vector<NodeID> m_order;
+	bool m_validated = false;
+
+	std::atomic<bool> m_running{ false };
+	std::atomic<size_t> m_remaining{ 0 };
+	ThreadPool* m_pool = nullptr;
+	std::mutex m_errorMutex;
+	std::exception_ptr m_error;
+
+	TimePoint m_runStart;
+	TimePoint m_runEnd;
+};
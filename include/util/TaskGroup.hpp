@@ -0,0 +1,86 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <exception>
+#include <chrono>
+#include <condition_variable>
+#include "Threadpool.hpp"
+
+// Counts a batch of tasks on a ThreadPool so you can wait on just that batch, while other work keeps flowing through the pool.
+// wait() runs queued pool work on the waiting thread instead of sleeping, so it's fine to use from inside a pool task.
+// A group can be reused once wait() has returned.
+class TaskGroup {
+public:
+	TaskGroup(ThreadPool& p_pool) : m_pool(p_pool) {}
+	TaskGroup(const TaskGroup& other) = delete;
+	TaskGroup& operator=(const TaskGroup& other) = delete;
+	// Tasks hold a pointer back to the group, so it can't go away with any still in flight.
+	~TaskGroup() {
+		if (m_pending.load() > 0) {
+			WARNING_LOG("TaskGroup destroyed with tasks still in flight, waiting on them.");
+			try {
+				wait();
+			}
+			catch (...) {}
+		}
+	}
+
+	template <typename F>
+	void run(F&& p_fn) {
+		m_pending.fetch_add(1);
+		m_pool.submit([this, fn = std::forward<F>(p_fn)]() mutable {
+			try {
+				fn();
+			}
+			catch (...) {
+				std::unique_lock<std::mutex> lock(m_mutex);
+				if (!m_error) m_error = std::current_exception();
+			}
+			finishOne();
+		});
+	}
+
+	// Returns once every task handed to run() has finished. Rethrows the first exception any of them threw.
+	void wait() {
+		while (m_pending.load(std::memory_order_acquire) > 0) {
+			if (m_pool.tryRunPendingTask()) continue;
+
+			// Nothing to help with, our remaining tasks are already running somewhere.
+			// Nap briefly rather than until the end, so we can go back and help if they spawn more work.
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_doneCv.wait_for(lock, std::chrono::microseconds(200), [this] { return m_pending.load() == 0; });
+		}
+		std::exception_ptr error;
+		{
+			// Also makes sure the task that finished last is completely out of finishOne() before we can be destroyed.
+			std::unique_lock<std::mutex> lock(m_mutex);
+			error = m_error;
+			m_error = nullptr;
+		}
+		if (error) std::rethrow_exception(error);
+	}
+
+	size_t pending() const {
+		return m_pending.load(std::memory_order_acquire);
+	}
+private:
+	void finishOne() {
+		size_t pending = m_pending.load();
+		while (pending > 1) {
+			// not the last one, so the waiter can't return because of us and we don't need the lock
+			if (m_pending.compare_exchange_weak(pending, pending - 1)) return;
+		}
+		// Possibly the last one. The waiter might tear the group down as soon as it sees zero,
+		// so the final decrement and the wakeup both happen under the lock it takes on the way out.
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_pending.fetch_sub(1);
+		m_doneCv.notify_all();
+	}
+
+	ThreadPool& m_pool;
+	std::atomic<size_t> m_pending{ 0 };
+	// guards m_error, and the last task's hand off to wait()
+	std::mutex m_mutex;
+	std::condition_variable m_doneCv;
+	std::exception_ptr m_error;
+};
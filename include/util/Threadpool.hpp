@@ -1,70 +1,796 @@
 #pragma once
 #include <vector>
+#include <deque>
 #include <thread>
+#include <memory>
+#include <atomic>
+#include <chrono>
 #include "SharedQueue.hpp"
+#include "WorkStealingDeque.hpp"
+#include "InplaceTask.hpp"
+#include "SizeClassArena.hpp"
+#include "FrameArena.hpp"
+#include "Framework/Log.hpp"
 #include <functional>
 #include <type_traits>
 #include <condition_variable>
 #include <future>
+#include <algorithm>
+#include <exception>
+#include <tuple>
+
+enum class ThreadPoolMode {
+	// Every task goes through one locked queue. Fine for a handful of big jobs.
+	SHARED_QUEUE,
+	// Each worker owns a Chase-Lev deque. Tasks assigned from inside a worker go to that worker's deque,
+	// tasks from outside go through a small injection queue, and idle workers steal from everyone else.
+	WORK_STEALING
+};
+
+enum class TaskPriority {
+	// Has to be done this frame. Always picked before anything else.
+	FRAME_CRITICAL,
+	NORMAL,
+	// Asset decoding, file IO and the like. Only gets a limited number of workers at once, see setBackgroundWorkerCap().
+	BACKGROUND
+};
+constexpr size_t TASK_PRIORITY_COUNT = 3;
+
+// How a task should be scheduled. Converts straight from a TaskPriority, so assign(TaskPriority::BACKGROUND, ...) works.
+// If a deadline is given, the task jumps ahead of everything but frame critical work once the deadline gets close,
+// and it ignores the background worker cap. It's a hint, nothing gets cancelled if it's missed.
+struct TaskHint {
+	using Clock = std::chrono::steady_clock;
+
+	TaskHint() {}
+	TaskHint(TaskPriority p_priority) : priority(p_priority) {}
+	TaskHint(TaskPriority p_priority, Clock::time_point p_deadline) : priority(p_priority), deadline(p_deadline) {}
+
+	bool hasDeadline() const {
+		return deadline != Clock::time_point::max();
+	}
+
+	TaskPriority priority = TaskPriority::NORMAL;
+	Clock::time_point deadline = Clock::time_point::max();
+};
+
+// Counters for how often the pool had to go to the system allocator. Divide by tasksSubmitted to get mallocs per task,
+// which should settle near zero once the freelists have warmed up.
+struct ThreadPoolAllocStats {
+	uint64_t tasksSubmitted = 0;
+	// closures too big for a task node's inline storage
+	uint64_t taskHeapSpills = 0;
+	// fresh batches of task nodes
+	uint64_t nodeSlabAllocs = 0;
+	// fresh batches of promise/future shared states, and states too big for the arena
+	uint64_t futureSlabAllocs = 0;
+	uint64_t futureFallbackAllocs = 0;
+	// times a thread's cache of shared states had to lock the arena's depot
+	uint64_t futureDepotTrips = 0;
+};
+
+// Per priority lane. Latency is the time between a task being queued and a thread starting on it.
+struct ThreadPoolLaneStats {
+	uint64_t queueDepth = 0;
+	uint64_t submitted = 0;
+	uint64_t started = 0;
+	// started early because their deadline was coming up
+	uint64_t promoted = 0;
+	double averageLatencyMs = 0.0;
+	double maxLatencyMs = 0.0;
+};
 
 class ThreadPool {
 public:
+	using Clock = TaskHint::Clock;
+
 	ThreadPool() = delete;
-	ThreadPool(uint16_t numThreads) {
+	ThreadPool(uint16_t numThreads, ThreadPoolMode p_mode = ThreadPoolMode::SHARED_QUEUE) :
+		m_mode(p_mode),
+		m_futureArena(std::make_shared<SizeClassArena>())
+	{
+		// leave at least one worker free for frame work by default
+		m_backgroundCap = std::max<uint32_t>(1, numThreads > 1 ? numThreads - 1 : 1);
 		for (uint16_t i = 0; i < numThreads; i++) {
-			m_idleFlags.push_back(false);
-			m_workers.emplace_back([this, i] {
-				size_t worker_id = i;
-				while (true) {
-					std::function<void()> task;
-					waitingCount++;
-					cv.notify_one();
-					task = std::move(m_tasks.pop());
-					waitingCount--;
-					if (m_stopping) return;
-
-					task();
-				}
-				});
+			m_nodeCaches.emplace_back(std::make_unique<NodeCache>());
+			if (m_mode == ThreadPoolMode::WORK_STEALING) {
+				m_workerQueues.emplace_back(std::make_unique<WorkStealingDeque<TaskNode*>>());
+			}
+		}
+		for (uint16_t i = 0; i < numThreads; i++) {
+			m_workers.emplace_back([this, i] { workerLoop(i); });
 		}
 	};
 	~ThreadPool() {
 		m_stopping = true;
-		m_tasks.clear();
-		m_tasks.forceAllThreadsToPop();
-
+		{
+			std::unique_lock<std::mutex> lock(m_sleepMutex);
+			m_sleepCv.notify_all();
+		}
 		for (auto& worker : m_workers) {
 			worker.join();
 		}
+		// anything still queued is dropped. Their futures will report a broken promise.
+		for (auto& queue : m_workerQueues) {
+			while (auto task = queue->pop()) releaseNode(*task);
+		}
+		while (!m_injectedTasks.empty()) {
+			releaseNode(m_injectedTasks.front());
+			m_injectedTasks.pop();
+		}
+		while (auto task = m_tasks.tryPop()) releaseNode(*task);
+		for (auto& lane : m_lanes) {
+			for (auto& entry : lane.tasks) releaseNode(entry.node);
+			lane.tasks.clear();
+		}
+	}
 
+	template <typename F, typename... Args> requires std::is_invocable_v<F, Args...>
+	auto assign(F&& f, Args&&... args) -> std::future<typename std::invoke_result_t<F, Args...>> {
+		return assign(TaskHint(), std::forward<F>(f), std::forward<Args>(args)...);
 	}
 
 	template <typename F, typename... Args>
-	auto assign(F&& f, Args&&... args) -> std::future<typename std::invoke_result_t<F, Args...>> {
+	auto assign(TaskHint p_hint, F&& f, Args&&... args) -> std::future<typename std::invoke_result_t<F, Args...>> {
 		using return_type = typename std::invoke_result_t<F, Args...>;
 
 		if (m_stopping) throw std::runtime_error("Cannot enqueue a task on a stopped threadpool. How did this happen?");
 
-		auto task = std::make_shared<std::packaged_task<return_type()>>(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
-
-		std::future<return_type> result = task->get_future();
+		// The promise's shared state comes out of the pool's arena, and the closure sits inside a recycled task node,
+		// so in the steady state this doesn't touch the heap at all.
+		std::promise<return_type> promise(std::allocator_arg, ArenaAllocator<char>(m_futureArena));
+		std::future<return_type> result = promise.get_future();
 
-		m_tasks.push([task] {(*task)(); });
+		if constexpr (sizeof...(Args) == 0) {
+			// no empty tuple in the capture, it'd pad the closure past the node's inline storage
+			enqueue([promise = std::move(promise), fn = std::forward<F>(f)]() mutable {
+				try {
+					if constexpr (std::is_void_v<return_type>) {
+						fn();
+						promise.set_value();
+					}
+					else {
+						promise.set_value(fn());
+					}
+				}
+				catch (...) {
+					promise.set_exception(std::current_exception());
+				}
+			}, p_hint);
+		}
+		else {
+			// the bound arguments get passed as lvalues, same as std::bind did, so functions taking them by reference still work
+			enqueue([promise = std::move(promise), fn = std::forward<F>(f), boundArgs = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+				try {
+					if constexpr (std::is_void_v<return_type>) {
+						std::apply(fn, boundArgs);
+						promise.set_value();
+					}
+					else {
+						promise.set_value(std::apply(fn, boundArgs));
+					}
+				}
+				catch (...) {
+					promise.set_exception(std::current_exception());
+				}
+			}, p_hint);
+		}
 
 		return result;
 	}
 
+	// Fire and forget, for when nobody needs the result. No promise or future gets made.
+	// There's nowhere to send an exception, so it gets logged and swallowed.
+	template <typename F, typename... Args> requires std::is_invocable_v<F, Args...>
+	void submit(F&& f, Args&&... args) {
+		submit(TaskHint(), std::forward<F>(f), std::forward<Args>(args)...);
+	}
+
+	template <typename F, typename... Args>
+	void submit(TaskHint p_hint, F&& f, Args&&... args) {
+		if (m_stopping) throw std::runtime_error("Cannot enqueue a task on a stopped threadpool. How did this happen?");
+
+		if constexpr (sizeof...(Args) == 0) {
+			enqueue([fn = std::forward<F>(f)]() mutable {
+				try {
+					fn();
+				}
+				catch (...) {
+					logSubmitException();
+				}
+			}, p_hint);
+		}
+		else {
+			enqueue([fn = std::forward<F>(f), boundArgs = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+				try {
+					std::apply(fn, boundArgs);
+				}
+				catch (...) {
+					logSubmitException();
+				}
+			}, p_hint);
+		}
+	}
+
+	// Runs p_fn over [p_begin, p_end) in chunks of p_grain indices. The range is split in half recursively, so only
+	// one task is made per chunk and nothing is allocated per element. The calling thread works on the range too and
+	// doesn't return until every chunk is done, so it's safe to call from inside another task.
+	// p_fn can take either a single index, or a (begin, end) pair if it wants to loop over the chunk itself.
+	// A grain of 0 picks one based on the worker count. The first exception thrown by p_fn is rethrown here.
+	template <typename F>
+	void parallelFor(size_t p_begin, size_t p_end, size_t p_grain, F&& p_fn) {
+		if (p_end <= p_begin) return;
+		size_t grain = pickGrain(p_end - p_begin, p_grain);
+		size_t chunkCount = (p_end - p_begin + grain - 1) / grain;
+
+		auto leaf = [&](size_t p_chunk) {
+			size_t chunkBegin = p_begin + p_chunk * grain;
+			size_t chunkEnd = std::min(p_end, chunkBegin + grain);
+			if constexpr (std::is_invocable_v<F&, size_t, size_t>) {
+				p_fn(chunkBegin, chunkEnd);
+			}
+			else {
+				for (size_t i = chunkBegin; i < chunkEnd; i++) p_fn(i);
+			}
+		};
+		runChunks(chunkCount, leaf);
+	}
+
+	// Maps every index in [p_begin, p_end) with p_map and folds the results with p_reduce, starting from p_identity.
+	// Each chunk is folded into its own slot, and the slots are combined in order on the calling thread,
+	// so the result is the same every run as long as p_grain is. p_reduce should be associative.
+	template <typename T, typename MapF, typename ReduceF>
+	T parallelReduce(size_t p_begin, size_t p_end, size_t p_grain, T p_identity, MapF&& p_map, ReduceF&& p_reduce) {
+		if (p_end <= p_begin) return p_identity;
+		size_t grain = pickGrain(p_end - p_begin, p_grain);
+		size_t chunkCount = (p_end - p_begin + grain - 1) / grain;
+
+		std::vector<T> partials(chunkCount, p_identity);
+		auto leaf = [&](size_t p_chunk) {
+			size_t chunkBegin = p_begin + p_chunk * grain;
+			size_t chunkEnd = std::min(p_end, chunkBegin + grain);
+			T acc = p_identity;
+			for (size_t i = chunkBegin; i < chunkEnd; i++) {
+				acc = p_reduce(std::move(acc), p_map(i));
+			}
+			partials[p_chunk] = std::move(acc);
+		};
+		runChunks(chunkCount, leaf);
+
+		T out = p_identity;
+		for (auto& partial : partials) {
+			out = p_reduce(std::move(out), std::move(partial));
+		}
+		return out;
+	}
+
+	// Pulls one queued task and runs it on the calling thread. Returns false if there was nothing to grab.
+	// Used by anything that has to wait on the pool, so the waiting thread chips in instead of sleeping.
+	// Threads outside the pool never pick up background work here, so a frame can't get stuck behind a texture decode.
+	bool tryRunPendingTask() {
+		TaskNode* task = findTask(currentWorkerIndex());
+		if (!task) return false;
+		runNode(task);
+		return true;
+	}
+
+	// Blocks until nothing is queued and nothing is running, helping with the queued work in the meantime.
+	// Anything assigned by another thread while this is waiting counts too, so only rely on it as a barrier
+	// when you control every producer. Use a TaskGroup to wait on one batch while others keep going.
+	// Can't be called from inside one of this pool's tasks, since that task would be waiting on itself.
 	void waitUntilIdle() {
-		std::unique_lock lk(m);
-		cv.wait(lk, [this] { return waitingCount == m_workers.size(); });
+		if (t_currentPool == this) {
+			ERROR_LOG("waitUntilIdle() was called from inside one of the pool's own tasks.");
+			throw std::logic_error("ThreadPool waited on itself");
+		}
+		while (true) {
+			int64_t outstanding = m_outstanding.load();
+			if (outstanding == 0) return;
+			if (tryRunPendingTask()) continue;
+
+			m_idleWaiters.fetch_add(1);
+			m_outstanding.wait(outstanding);
+			m_idleWaiters.fetch_sub(1);
+		}
+	}
+	// Exact, queued plus running. Zero means the pool is idle.
+	int64_t outstandingTasks() const {
+		return m_outstanding.load(std::memory_order_acquire);
 	}
+
+	// Most workers that may be running background tasks at once. Background tasks with a close deadline ignore this.
+	void setBackgroundWorkerCap(uint32_t p_cap) {
+		m_backgroundCap.store(std::max<uint32_t>(1, p_cap));
+		wakeWorkers();
+	}
+	// How close to its deadline a task has to be before it gets bumped up.
+	void setDeadlineSlack(Clock::duration p_slack) {
+		m_deadlineSlack.store(p_slack.count(), std::memory_order_relaxed);
+	}
+
+	ThreadPoolLaneStats getLaneStats(TaskPriority p_priority) const {
+		const LaneCounters& counters = m_laneCounters[(size_t)p_priority];
+		ThreadPoolLaneStats out;
+		out.queueDepth = counters.queued.load(std::memory_order_relaxed);
+		out.submitted = counters.submitted.load(std::memory_order_relaxed);
+		out.started = counters.started.load(std::memory_order_relaxed);
+		out.promoted = counters.promoted.load(std::memory_order_relaxed);
+		if (out.started > 0) {
+			out.averageLatencyMs = double(counters.totalLatency.load(std::memory_order_relaxed)) / double(out.started) / 1000000.0;
+		}
+		out.maxLatencyMs = double(counters.maxLatency.load(std::memory_order_relaxed)) / 1000000.0;
+		return out;
+	}
+	// Clears everything but the queue depth, handy for measuring one frame at a time.
+	void resetLaneStats() {
+		for (auto& counters : m_laneCounters) {
+			counters.submitted.store(0, std::memory_order_relaxed);
+			counters.started.store(0, std::memory_order_relaxed);
+			counters.promoted.store(0, std::memory_order_relaxed);
+			counters.totalLatency.store(0, std::memory_order_relaxed);
+			counters.maxLatency.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	ThreadPoolMode getMode() const {
+		return m_mode;
+	}
+	size_t workerCount() const {
+		return m_workers.size();
+	}
+	ThreadPoolAllocStats getAllocStats() const {
+		ThreadPoolAllocStats out;
+		out.tasksSubmitted = m_tasksSubmitted.load(std::memory_order_relaxed);
+		out.taskHeapSpills = m_taskHeapSpills.load(std::memory_order_relaxed);
+		out.nodeSlabAllocs = m_nodeSlabAllocs.load(std::memory_order_relaxed);
+		out.futureSlabAllocs = m_futureArena->slabAllocs.load(std::memory_order_relaxed);
+		out.futureFallbackAllocs = m_futureArena->fallbackAllocs.load(std::memory_order_relaxed);
+		out.futureDepotTrips = m_futureArena->depotTrips.load(std::memory_order_relaxed);
+		return out;
+	}
+	// Index of the calling worker in this pool, or -1 if called from a thread that isn't one of ours.
+	int currentWorkerIndex() const {
+		return (t_currentPool == this) ? t_workerIndex : -1;
+	}
+	// How many workers are currently asleep waiting for work. Just informational, see waitUntilIdle() for an actual barrier.
 	std::atomic<uint32_t> waitingCount{0};
 private:
-	SharedQueue<std::function<void()>> m_tasks;
-	bool m_stopping = false;
+	// Sized so a node is a single cache line: 40 bytes of closure plus the task's ops pointer, then the node's own fields.
+	// submit() gets all 40 for its closure. assign() also has to carry its promise (24 bytes with libstdc++), which leaves
+	// 16 bytes for the function and any bound arguments together, e.g. a lambda capturing two pointers and no arguments.
+	// Anything bigger still works, it just spills to the heap and shows up in taskHeapSpills.
+	static constexpr size_t TASK_INLINE_SIZE = 40;
+	static constexpr size_t NODES_PER_SLAB = 128;
+	// a worker's cache hands half of itself back to the depot once it gets this big
+	static constexpr size_t NODE_CACHE_LIMIT = 512;
+
+	// only called from inside a catch block, rethrows to find out what was caught
+	static void logSubmitException() {
+		try {
+			throw;
+		}
+		catch (std::exception& e) {
+			ERROR_LOG("Uncaught exception in submitted threadpool task: " << e.what());
+		}
+		catch (...) {
+			ERROR_LOG("Uncaught non-standard exception in submitted threadpool task.");
+		}
+	}
+
+	struct alignas(64) TaskNode {
+		InplaceTask<TASK_INLINE_SIZE> fn;
+		int64_t enqueuedAt = 0;
+		TaskPriority priority = TaskPriority::NORMAL;
+		// took up one of the background worker slots, and has to give it back
+		bool holdsBackgroundSlot = false;
+	};
+	static_assert(sizeof(TaskNode) == 64, "TaskNode should stay a single cache line");
+
+	// Task nodes freed on a worker go back to that worker's cache, so the common case never takes a lock.
+	struct alignas(64) NodeCache {
+		std::vector<TaskNode*> freeNodes;
+	};
+
+	// Frame critical, background, and anything with a deadline goes through one of these instead of the normal queues.
+	// They're locked, but they only see a fraction of the traffic.
+	struct LaneEntry {
+		TaskNode* node;
+		Clock::time_point deadline;
+	};
+	struct alignas(64) Lane {
+		std::mutex mutex;
+		std::deque<LaneEntry> tasks;
+		// both readable without the lock, as hints
+		std::atomic<size_t> size{ 0 };
+		std::atomic<size_t> deadlineCount{ 0 };
+	};
+	struct alignas(64) LaneCounters {
+		std::atomic<uint64_t> queued{ 0 };
+		std::atomic<uint64_t> submitted{ 0 };
+		std::atomic<uint64_t> started{ 0 };
+		std::atomic<uint64_t> promoted{ 0 };
+		// nanoseconds
+		std::atomic<uint64_t> totalLatency{ 0 };
+		std::atomic<uint64_t> maxLatency{ 0 };
+	};
 
-	std::condition_variable cv;
-	std::mutex m;
+	template <typename Leaf>
+	struct ChunkContext {
+		Leaf* leaf;
+		std::atomic<size_t> pending;
+		std::mutex errorMutex;
+		std::exception_ptr error;
+	};
+
+	static int64_t nowTicks() {
+		return Clock::now().time_since_epoch().count();
+	}
+
+	size_t pickGrain(size_t p_count, size_t p_grain) const {
+		if (p_grain > 0) return p_grain;
+		// aim for a few chunks per worker so stealing has something to balance with
+		size_t target = std::max<size_t>(1, (m_workers.size() + 1) * 8);
+		return std::max<size_t>(1, p_count / target);
+	}
+
+	template <typename Leaf>
+	void runChunks(size_t p_chunkCount, Leaf& p_leaf) {
+		if (p_chunkCount == 1 || m_workers.empty()) {
+			for (size_t i = 0; i < p_chunkCount; i++) p_leaf(i);
+			return;
+		}
+		ChunkContext<Leaf> ctx;
+		ctx.leaf = &p_leaf;
+		ctx.pending.store(p_chunkCount);
+
+		splitChunks(&ctx, 0, p_chunkCount);
+		while (ctx.pending.load(std::memory_order_acquire) > 0) {
+			if (!tryRunPendingTask()) std::this_thread::yield();
+		}
+		if (ctx.error) std::rethrow_exception(ctx.error);
+	}
+
+	// Hands the top half of [p_lo, p_hi) to the pool until a single chunk is left, then runs that one here.
+	template <typename Leaf>
+	void splitChunks(ChunkContext<Leaf>* p_ctx, size_t p_lo, size_t p_hi) {
+		while (p_hi - p_lo > 1) {
+			size_t mid = p_lo + (p_hi - p_lo) / 2;
+			enqueue([this, p_ctx, mid, p_hi] { splitChunks(p_ctx, mid, p_hi); });
+			p_hi = mid;
+		}
+		try {
+			(*p_ctx->leaf)(p_lo);
+		}
+		catch (...) {
+			std::unique_lock<std::mutex> lock(p_ctx->errorMutex);
+			if (!p_ctx->error) p_ctx->error = std::current_exception();
+		}
+		// last touch of the context, the waiting thread is free to tear it down after this
+		p_ctx->pending.fetch_sub(1, std::memory_order_acq_rel);
+	}
+
+	template <typename F>
+	void enqueue(F&& p_task, TaskHint p_hint = TaskHint()) {
+		TaskNode* node = acquireNode();
+		node->fn.emplace(std::forward<F>(p_task));
+		node->priority = p_hint.priority;
+		node->enqueuedAt = nowTicks();
+		node->holdsBackgroundSlot = false;
+
+		m_tasksSubmitted.fetch_add(1, std::memory_order_relaxed);
+		if (!node->fn.storedInline()) m_taskHeapSpills.fetch_add(1, std::memory_order_relaxed);
+		LaneCounters& counters = m_laneCounters[(size_t)p_hint.priority];
+		counters.submitted.fetch_add(1, std::memory_order_relaxed);
+		counters.queued.fetch_add(1, std::memory_order_relaxed);
+		m_outstanding.fetch_add(1);
+
+		if (p_hint.priority == TaskPriority::NORMAL && !p_hint.hasDeadline()) {
+			pushNormal(node);
+		}
+		else {
+			Lane& lane = m_lanes[(size_t)p_hint.priority];
+			std::unique_lock<std::mutex> lock(lane.mutex);
+			lane.tasks.push_back({ node, p_hint.deadline });
+			lane.size.store(lane.tasks.size(), std::memory_order_relaxed);
+			if (p_hint.hasDeadline()) lane.deadlineCount.fetch_add(1, std::memory_order_relaxed);
+		}
+		if (p_hint.priority == TaskPriority::BACKGROUND) m_backgroundQueued.fetch_add(1);
+
+		m_queuedCount.fetch_add(1);
+		// pairs with the sleeping worker bumping m_sleepingCount before it re-checks m_queuedCount
+		if (m_sleepingCount.load() > 0) {
+			std::unique_lock<std::mutex> lock(m_sleepMutex);
+			m_sleepCv.notify_one();
+		}
+	}
+
+	void pushNormal(TaskNode* p_node) {
+		if (m_mode == ThreadPoolMode::SHARED_QUEUE) {
+			m_tasks.push(p_node);
+		}
+		else if (t_currentPool == this) {
+			// spawned from one of our own workers, keep it local
+			m_workerQueues[t_workerIndex]->push(p_node);
+		}
+		else {
+			std::unique_lock<std::mutex> lock(m_injectMutex);
+			m_injectedTasks.push(p_node);
+			m_injectedSize.store(m_injectedTasks.size(), std::memory_order_relaxed);
+		}
+	}
+
+	void runNode(TaskNode* p_node) {
+		LaneCounters& counters = m_laneCounters[(size_t)p_node->priority];
+		uint64_t latency = (uint64_t)std::max<int64_t>(0, nowTicks() - p_node->enqueuedAt);
+		latency = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::duration(latency)).count();
+		counters.started.fetch_add(1, std::memory_order_relaxed);
+		counters.totalLatency.fetch_add(latency, std::memory_order_relaxed);
+		uint64_t prevMax = counters.maxLatency.load(std::memory_order_relaxed);
+		while (latency > prevMax && !counters.maxLatency.compare_exchange_weak(prevMax, latency, std::memory_order_relaxed)) {}
+
+		bool heldSlot = p_node->holdsBackgroundSlot;
+		{
+			// the task start is the only place this thread's frame arena gets reset, never halfway through a task
+			FrameArena::Scope frameScope;
+			p_node->fn();
+		}
+		releaseNode(p_node);
+
+		if (heldSlot) {
+			m_backgroundRunning.fetch_sub(1);
+			// a slot just opened up, let somebody pick up the next background task
+			if (m_backgroundQueued.load() > 0) wakeWorkers();
+		}
+		// pairs with waitUntilIdle bumping m_idleWaiters before it goes to sleep on m_outstanding
+		if (m_outstanding.fetch_sub(1) == 1 && m_idleWaiters.load() > 0) {
+			m_outstanding.notify_all();
+		}
+	}
+
+	// Called whenever a task leaves a queue, before it's run.
+	TaskNode* claimed(TaskNode* p_node) {
+		m_queuedCount.fetch_sub(1);
+		m_laneCounters[(size_t)p_node->priority].queued.fetch_sub(1, std::memory_order_relaxed);
+		if (p_node->priority == TaskPriority::BACKGROUND) m_backgroundQueued.fetch_sub(1);
+		return p_node;
+	}
+
+	// Order is frame critical, then anything about to miss its deadline, then normal work, then background work if there's a free slot.
+	// p_workerIndex is -1 for threads that aren't ours.
+	TaskNode* findTask(int p_workerIndex) {
+		if (TaskNode* task = popLane(TaskPriority::FRAME_CRITICAL)) return claimed(task);
+		if (TaskNode* task = popDueTask()) return claimed(task);
+		if (TaskNode* task = findNormalTask(p_workerIndex)) return claimed(task);
+		if (TaskNode* task = popLane(TaskPriority::NORMAL)) return claimed(task);
+		if (p_workerIndex >= 0) {
+			if (TaskNode* task = popBackground()) return claimed(task);
+		}
+		return nullptr;
+	}
+
+	TaskNode* popLane(TaskPriority p_priority) {
+		Lane& lane = m_lanes[(size_t)p_priority];
+		if (lane.size.load(std::memory_order_relaxed) == 0) return nullptr;
+		std::unique_lock<std::mutex> lock(lane.mutex);
+		return popLaneEntry(lane, 0);
+	}
+
+	// must hold the lane's mutex
+	TaskNode* popLaneEntry(Lane& p_lane, size_t p_index) {
+		if (p_index >= p_lane.tasks.size()) return nullptr;
+		LaneEntry entry = p_lane.tasks[p_index];
+		p_lane.tasks.erase(p_lane.tasks.begin() + p_index);
+		p_lane.size.store(p_lane.tasks.size(), std::memory_order_relaxed);
+		if (entry.deadline != Clock::time_point::max()) p_lane.deadlineCount.fetch_sub(1, std::memory_order_relaxed);
+		return entry.node;
+	}
+
+	// Finds the queued task with the closest deadline, if that deadline is within the slack window.
+	TaskNode* popDueTask() {
+		Clock::time_point horizon = Clock::now() + Clock::duration(m_deadlineSlack.load(std::memory_order_relaxed));
+		for (TaskPriority priority : { TaskPriority::NORMAL, TaskPriority::BACKGROUND }) {
+			Lane& lane = m_lanes[(size_t)priority];
+			if (lane.deadlineCount.load(std::memory_order_relaxed) == 0) continue;
+
+			std::unique_lock<std::mutex> lock(lane.mutex);
+			size_t best = lane.tasks.size();
+			for (size_t i = 0; i < lane.tasks.size(); i++) {
+				if (lane.tasks[i].deadline > horizon) continue;
+				if (best == lane.tasks.size() || lane.tasks[i].deadline < lane.tasks[best].deadline) best = i;
+			}
+			if (TaskNode* task = popLaneEntry(lane, best)) {
+				m_laneCounters[(size_t)priority].promoted.fetch_add(1, std::memory_order_relaxed);
+				return task;
+			}
+		}
+		return nullptr;
+	}
+
+	TaskNode* popBackground() {
+		Lane& lane = m_lanes[(size_t)TaskPriority::BACKGROUND];
+		if (lane.size.load(std::memory_order_relaxed) == 0) return nullptr;
+		if (m_backgroundRunning.fetch_add(1) >= m_backgroundCap.load()) {
+			m_backgroundRunning.fetch_sub(1);
+			return nullptr;
+		}
+		TaskNode* task = popLane(TaskPriority::BACKGROUND);
+		if (!task) {
+			m_backgroundRunning.fetch_sub(1);
+			return nullptr;
+		}
+		task->holdsBackgroundSlot = true;
+		return task;
+	}
+
+	TaskNode* findNormalTask(int p_workerIndex) {
+		if (m_mode == ThreadPoolMode::SHARED_QUEUE) {
+			auto task = m_tasks.tryPop();
+			return task ? *task : nullptr;
+		}
+		if (p_workerIndex >= 0) {
+			if (auto task = m_workerQueues[p_workerIndex]->pop()) return *task;
+		}
+
+		if (m_injectedSize.load(std::memory_order_relaxed) > 0) {
+			std::unique_lock<std::mutex> lock(m_injectMutex);
+			if (!m_injectedTasks.empty()) {
+				TaskNode* task = m_injectedTasks.front();
+				m_injectedTasks.pop();
+				m_injectedSize.store(m_injectedTasks.size(), std::memory_order_relaxed);
+				return task;
+			}
+		}
+
+		// xorshift so every worker doesn't start robbing the same victim
+		t_stealRng ^= t_stealRng << 13;
+		t_stealRng ^= t_stealRng >> 17;
+		t_stealRng ^= t_stealRng << 5;
+		size_t count = m_workerQueues.size();
+		if (count == 0) return nullptr;
+		size_t start = t_stealRng % count;
+		for (size_t i = 0; i < count; i++) {
+			size_t victim = (start + i) % count;
+			if ((int)victim == p_workerIndex) continue;
+			if (auto task = m_workerQueues[victim]->steal()) return *task;
+		}
+		return nullptr;
+	}
+
+	// Whether a sleeping worker would find something. Queued background tasks don't count while every background slot is taken.
+	bool hasRunnableWork() const {
+		int64_t queued = m_queuedCount.load();
+		int64_t background = m_backgroundQueued.load();
+		if (queued - background > 0) return true;
+		return background > 0 && m_backgroundRunning.load() < m_backgroundCap.load();
+	}
+
+	void wakeWorkers() {
+		if (m_sleepingCount.load() == 0) return;
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		m_sleepCv.notify_all();
+	}
+
+	void workerLoop(size_t p_workerIndex) {
+		t_currentPool = this;
+		t_workerIndex = (int)p_workerIndex;
+		t_stealRng = 0x9E3779B9u ^ (uint32_t(p_workerIndex + 1) * 0x85EBCA6Bu);
+
+		while (!m_stopping) {
+			TaskNode* task = nullptr;
+			// spin a little before going to sleep, the gaps between tiny tasks are usually short
+			for (int spin = 0; spin < 32 && !task && !m_stopping; spin++) {
+				task = findTask((int)p_workerIndex);
+				if (!task) std::this_thread::yield();
+			}
+			if (task) {
+				runNode(task);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(m_sleepMutex);
+			m_sleepingCount.fetch_add(1);
+			waitingCount++;
+			if (m_lanes[(size_t)TaskPriority::BACKGROUND].deadlineCount.load() > 0) {
+				// capped background work might come due while we're asleep, so check back in now and then
+				m_sleepCv.wait_for(lock, Clock::duration(m_deadlineSlack.load(std::memory_order_relaxed)), [this] { return hasRunnableWork() || m_stopping; });
+			}
+			else {
+				m_sleepCv.wait(lock, [this] { return hasRunnableWork() || m_stopping; });
+			}
+			waitingCount--;
+			m_sleepingCount.fetch_sub(1);
+		}
+	}
+
+	TaskNode* acquireNode() {
+		if (t_currentPool == this) {
+			auto& cache = m_nodeCaches[t_workerIndex]->freeNodes;
+			if (cache.empty()) {
+				std::unique_lock<std::mutex> lock(m_depotMutex);
+				if (m_nodeDepot.empty()) growDepot();
+				size_t take = std::min(m_nodeDepot.size(), NODES_PER_SLAB);
+				cache.insert(cache.end(), m_nodeDepot.end() - take, m_nodeDepot.end());
+				m_nodeDepot.resize(m_nodeDepot.size() - take);
+			}
+			TaskNode* node = cache.back();
+			cache.pop_back();
+			return node;
+		}
+		std::unique_lock<std::mutex> lock(m_depotMutex);
+		if (m_nodeDepot.empty()) growDepot();
+		TaskNode* node = m_nodeDepot.back();
+		m_nodeDepot.pop_back();
+		return node;
+	}
+
+	void releaseNode(TaskNode* p_node) {
+		p_node->fn.reset();
+		if (t_currentPool == this) {
+			auto& cache = m_nodeCaches[t_workerIndex]->freeNodes;
+			cache.push_back(p_node);
+			if (cache.size() >= NODE_CACHE_LIMIT) {
+				std::unique_lock<std::mutex> lock(m_depotMutex);
+				m_nodeDepot.insert(m_nodeDepot.end(), cache.end() - NODE_CACHE_LIMIT / 2, cache.end());
+				cache.resize(cache.size() - NODE_CACHE_LIMIT / 2);
+			}
+			return;
+		}
+		std::unique_lock<std::mutex> lock(m_depotMutex);
+		m_nodeDepot.push_back(p_node);
+	}
+
+	// must hold m_depotMutex
+	void growDepot() {
+		m_nodeSlabs.emplace_back(std::make_unique<TaskNode[]>(NODES_PER_SLAB));
+		m_nodeSlabAllocs.fetch_add(1, std::memory_order_relaxed);
+		for (size_t i = 0; i < NODES_PER_SLAB; i++) {
+			m_nodeDepot.push_back(&m_nodeSlabs.back()[i]);
+		}
+	}
+
+	// declared first so they're torn down last, every queued task lives inside one of these
+	std::vector<std::unique_ptr<TaskNode[]>> m_nodeSlabs;
+	std::vector<TaskNode*> m_nodeDepot;
+	std::mutex m_depotMutex;
+	std::vector<std::unique_ptr<NodeCache>> m_nodeCaches;
+
+	SharedQueue<TaskNode*> m_tasks;
+	std::atomic<bool> m_stopping = false;
+	ThreadPoolMode m_mode;
+	std::shared_ptr<SizeClassArena> m_futureArena;
+
+	std::atomic<uint64_t> m_tasksSubmitted{ 0 };
+	std::atomic<uint64_t> m_taskHeapSpills{ 0 };
+	std::atomic<uint64_t> m_nodeSlabAllocs{ 0 };
+
+	// queued plus running
+	std::atomic<int64_t> m_outstanding{ 0 };
+	std::atomic<uint32_t> m_idleWaiters{ 0 };
 	std::vector<std::thread> m_workers;
-	std::vector<bool> m_idleFlags;
+
+	// work stealing state
+	std::vector<std::unique_ptr<WorkStealingDeque<TaskNode*>>> m_workerQueues;
+	std::mutex m_injectMutex;
+	std::queue<TaskNode*> m_injectedTasks;
+	// lets workers skip the injection lock when there's obviously nothing in there
+	std::atomic<size_t> m_injectedSize{ 0 };
+
+	// priority lanes, indexed by TaskPriority. The NORMAL lane only holds tasks with a deadline.
+	Lane m_lanes[TASK_PRIORITY_COUNT];
+	LaneCounters m_laneCounters[TASK_PRIORITY_COUNT];
+	std::atomic<int64_t> m_backgroundQueued{ 0 };
+	std::atomic<uint32_t> m_backgroundRunning{ 0 };
+	std::atomic<uint32_t> m_backgroundCap{ 1 };
+	std::atomic<Clock::rep> m_deadlineSlack{ std::chrono::duration_cast<Clock::duration>(std::chrono::milliseconds(2)).count() };
+
+	// every queued task in every queue, workers sleep when this hits zero
+	std::atomic<int64_t> m_queuedCount{ 0 };
+	std::atomic<uint32_t> m_sleepingCount{ 0 };
+	std::mutex m_sleepMutex;
+	std::condition_variable m_sleepCv;
+
+	inline static thread_local ThreadPool* t_currentPool = nullptr;
+	inline static thread_local int t_workerIndex = -1;
+	// xorshift state for picking steal victims, must never be zero
+	inline static thread_local uint32_t t_stealRng = 0x9E3779B9u;
 };
@@ -0,0 +1,115 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <vector>
+#include <stdint.h>
+
+template<typename T>
+// Chase-Lev work stealing deque (the C11 version from Le et al, "Correct and Efficient Work-Stealing for Weak Memory Models").
+// The owning thread pushes and pops from the bottom, any other thread can steal from the top.
+// T should be something small and trivially copyable, like a pointer, since it lives inside an atomic.
+// Old ring buffers are kept around until destruction, because a thief might still be reading from one after a grow.
+class WorkStealingDeque {
+public:
+	WorkStealingDeque(int64_t p_capacity = 1024) {
+		int64_t capacity = 1;
+		while (capacity < p_capacity) capacity <<= 1;
+		m_rings.emplace_back(std::make_unique<Ring>(capacity));
+		m_ring.store(m_rings.back().get(), std::memory_order_relaxed);
+	}
+	WorkStealingDeque(const WorkStealingDeque<T>& other) = delete;
+	WorkStealingDeque<T>& operator=(const WorkStealingDeque<T>& other) = delete;
+
+	// Owner thread only.
+	void push(T p_item) {
+		int64_t b = m_bottom.load(std::memory_order_relaxed);
+		int64_t t = m_top.load(std::memory_order_acquire);
+		Ring* ring = m_ring.load(std::memory_order_relaxed);
+		if (b - t > ring->capacity - 1) {
+			ring = grow(ring, b, t);
+		}
+		ring->put(b, p_item);
+		std::atomic_thread_fence(std::memory_order_release);
+		m_bottom.store(b + 1, std::memory_order_relaxed);
+	}
+
+	// Owner thread only. LIFO, so the most recently pushed task is still warm in cache.
+	std::optional<T> pop() {
+		int64_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+		Ring* ring = m_ring.load(std::memory_order_relaxed);
+		m_bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t t = m_top.load(std::memory_order_relaxed);
+
+		if (t > b) { // already empty
+			m_bottom.store(b + 1, std::memory_order_relaxed);
+			return std::nullopt;
+		}
+		T item = ring->get(b);
+		if (t == b) { // last element, race any thieves for it
+			bool won = m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+			m_bottom.store(b + 1, std::memory_order_relaxed);
+			if (!won) return std::nullopt;
+		}
+		return item;
+	}
+
+	// Any thread. FIFO, takes the oldest task which tends to be the biggest chunk of remaining work.
+	std::optional<T> steal() {
+		int64_t t = m_top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t b = m_bottom.load(std::memory_order_acquire);
+
+		if (t >= b) return std::nullopt;
+		Ring* ring = m_ring.load(std::memory_order_acquire);
+		T item = ring->get(t);
+		if (!m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+			return std::nullopt; // lost to the owner or another thief
+		}
+		return item;
+	}
+
+	// Only a hint when other threads are touching the deque.
+	bool empty() const {
+		int64_t b = m_bottom.load(std::memory_order_relaxed);
+		int64_t t = m_top.load(std::memory_order_relaxed);
+		return b <= t;
+	}
+	size_t size() const {
+		int64_t b = m_bottom.load(std::memory_order_relaxed);
+		int64_t t = m_top.load(std::memory_order_relaxed);
+		return b > t ? size_t(b - t) : 0;
+	}
+private:
+	struct Ring {
+		Ring(int64_t p_capacity) : capacity(p_capacity), mask(p_capacity - 1), items(new std::atomic<T>[p_capacity]) {}
+		void put(int64_t p_index, T p_item) {
+			items[p_index & mask].store(p_item, std::memory_order_relaxed);
+		}
+		T get(int64_t p_index) const {
+			return items[p_index & mask].load(std::memory_order_relaxed);
+		}
+		int64_t capacity;
+		int64_t mask;
+		std::unique_ptr<std::atomic<T>[]> items;
+	};
+
+	Ring* grow(Ring* p_old, int64_t p_bottom, int64_t p_top) {
+		auto bigger = std::make_unique<Ring>(p_old->capacity * 2);
+		for (int64_t i = p_top; i < p_bottom; i++) {
+			bigger->put(i, p_old->get(i));
+		}
+		Ring* out = bigger.get();
+		m_rings.emplace_back(std::move(bigger));
+		m_ring.store(out, std::memory_order_release);
+		return out;
+	}
+
+	// Kept on separate cache lines, the owner hammers bottom and the thieves hammer top.
+	alignas(64) std::atomic<int64_t> m_top{ 0 };
+	alignas(64) std::atomic<int64_t> m_bottom{ 0 };
+	alignas(64) std::atomic<Ring*> m_ring{ nullptr };
+	// owned by the pushing thread, every ring ever allocated
+	std::vector<std::unique_ptr<Ring>> m_rings;
+};
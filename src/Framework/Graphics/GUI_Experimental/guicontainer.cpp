@@ -14,16 +14,19 @@ void GUIContainer::draw(DrawSurface& p_target, DrawStates& p_states)
 		m_backgroundSprite.setBounds(Rect(0.f, 0.f, absoluteBounds.wh.x, absoluteBounds.wh.y));
 		m_backgroundSprite.setPosition(glm::vec3(absoluteBounds.xy.x, absoluteBounds.xy.y, 1.f));
 		if (!m_win95Bg) {
-			gs.solidColorShader.setVec3Uniform(gs.solidColor_colorUniformLoc, backgroundColor);
-			gs.solidColorShader.setFloatUniform(gs.solidColor_opacityUniformLoc, backgroundOpacity);
+			p_states.setUniform(gs.solidColor_colorUniformLoc, backgroundColor);
+			p_states.setUniform(gs.solidColor_opacityUniformLoc, backgroundOpacity);
 			m_backgroundSprite.draw(p_target, p_states);
-			gs.solidColorShader.setFloatUniform(gs.solidColor_opacityUniformLoc, 1.f);
+			p_states.removeUniform(gs.solidColor_colorUniformLoc);
+			p_states.removeUniform(gs.solidColor_opacityUniformLoc);
 		}
 		else {
-			gs.win95Shader.setVec2Uniform(gs.win95_pixelBoundsUniformLoc, glm::vec2(absoluteBounds.wh.x * p_target.getViewportWidth(), absoluteBounds.wh.y * p_target.getViewportHeight()));
-			gs.win95Shader.setFloatUniform(gs.win95_opacityUniformLoc, backgroundOpacity);
+			p_states.setUniform(gs.win95_pixelBoundsUniformLoc, glm::vec2(absoluteBounds.wh.x * p_target.getViewportWidth(), absoluteBounds.wh.y * p_target.getViewportHeight()));
+			p_states.setUniform(gs.win95_opacityUniformLoc, backgroundOpacity);
 			m_backgroundSprite.attachShader(&gs.win95Shader);
 			m_backgroundSprite.draw(p_target, p_states);
+			p_states.removeUniform(gs.win95_pixelBoundsUniformLoc);
+			p_states.removeUniform(gs.win95_opacityUniformLoc);
 		}
 	}
 	if (m_imageAttached) {
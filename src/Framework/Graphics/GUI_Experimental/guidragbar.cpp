@@ -9,10 +9,11 @@ void GUIDragBar::draw(DrawSurface& p_target, DrawStates& p_states)
 	if (m_backgroundEnabled) {
 		m_backgroundSprite.setBounds(Rect(0.f, 0.f, absoluteBounds.wh.x, absoluteBounds.wh.y));
 		m_backgroundSprite.setPosition(glm::vec3(absoluteBounds.xy.x, absoluteBounds.xy.y, 1.f));
-		gs.solidColorShader.setVec3Uniform(gs.solidColor_colorUniformLoc, backgroundColor);
-		gs.solidColorShader.setFloatUniform(gs.solidColor_opacityUniformLoc, backgroundOpacity);
+		p_states.setUniform(gs.solidColor_colorUniformLoc, backgroundColor);
+		p_states.setUniform(gs.solidColor_opacityUniformLoc, backgroundOpacity);
 		m_backgroundSprite.draw(p_target, p_states);
-		gs.solidColorShader.setFloatUniform(gs.solidColor_opacityUniformLoc, 1.f);
+		p_states.removeUniform(gs.solidColor_colorUniformLoc);
+		p_states.removeUniform(gs.solidColor_opacityUniformLoc);
 	}
 	Widget::draw(p_target, p_states);
 }
@@ -89,3 +89,57 @@ void DrawStates::setBlendMode(BlendMode p_blendMode)
 	m_blendMode = p_blendMode;
 };
 
+void DrawStates::setUniform(GLint p_loc, float p_value)
+{
+	setUniformValue(p_loc, 1, glm::vec4(p_value, 0.f, 0.f, 0.f));
+}
+void DrawStates::setUniform(GLint p_loc, glm::vec2 p_value)
+{
+	setUniformValue(p_loc, 2, glm::vec4(p_value, 0.f, 0.f));
+}
+void DrawStates::setUniform(GLint p_loc, glm::vec3 p_value)
+{
+	setUniformValue(p_loc, 3, glm::vec4(p_value, 0.f));
+}
+void DrawStates::setUniform(GLint p_loc, glm::vec4 p_value)
+{
+	setUniformValue(p_loc, 4, p_value);
+}
+void DrawStates::removeUniform(GLint p_loc)
+{
+	for (size_t i = 0; i < m_uniforms.size(); i++) {
+		if (m_uniforms[i].loc == p_loc) {
+			m_uniforms.erase(m_uniforms.begin() + i);
+			return;
+		}
+	}
+}
+bool DrawStates::hasUniform(GLint p_loc) const
+{
+	for (const UniformValue& uniform : m_uniforms) {
+		if (uniform.loc == p_loc) return true;
+	}
+	return false;
+}
+void DrawStates::setUniformValue(GLint p_loc, GLint p_components, glm::vec4 p_value)
+{
+	for (UniformValue& uniform : m_uniforms) {
+		if (uniform.loc == p_loc) {
+			uniform.components = p_components;
+			uniform.value = p_value;
+			return;
+		}
+	}
+	m_uniforms.push_back({ p_loc, p_components, p_value });
+}
+
+void DrawStates::UniformValue::apply(const Shader& p_shader) const
+{
+	if (loc < 0) return;
+	switch (components) {
+	case 1: p_shader.setFloatUniform(loc, value.x); break;
+	case 2: p_shader.setVec2Uniform(loc, glm::vec2(value)); break;
+	case 3: p_shader.setVec3Uniform(loc, glm::vec3(value)); break;
+	default: p_shader.setVec4Uniform(loc, value); break;
+	}
+}
@@ -15,7 +15,7 @@ void FrameBuffer::setDimensions(uint32_t p_width, uint32_t p_height)
 	if (!m_initialized) {
 		init();
 	}
-	glCheck(glBindFramebuffer(GL_FRAMEBUFFER, m_frameBuffer->ID));
+	GLStateCache::Get().bindFramebuffer(m_frameBuffer->ID);
 	for (int i = 0; i < m_colorTextures.size(); i++) {
 		// By default, every color texture will be the same size as the entire frame
 		m_colorTextures[i].changeDimensions(m_dimensions.x, m_dimensions.y);
@@ -31,7 +31,7 @@ void FrameBuffer::setDimensions(uint32_t p_width, uint32_t p_height)
 
 	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
 		throw std::exception("Frame buffer is not okie dokie");
-	glCheck(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+	GLStateCache::Get().bindFramebuffer(0);
 	useViewport();
 
 }
@@ -43,7 +43,7 @@ void FrameBuffer::setDimensions(glm::uvec2 p_dimensions)
 	if (!m_initialized) {
 		init();
 	}
-	glCheck(glBindFramebuffer(GL_FRAMEBUFFER, m_frameBuffer->ID));
+	GLStateCache::Get().bindFramebuffer(m_frameBuffer->ID);
 	for (int i = 0; i < m_colorTextures.size(); i++) {
 		m_colorTextures[i].changeDimensions(m_dimensions.x, m_dimensions.y);
 		// only supports 2d color attachments for now. logical assumption.
@@ -57,7 +57,7 @@ void FrameBuffer::setDimensions(glm::uvec2 p_dimensions)
 	}
 	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
 		throw std::exception("Frame buffer is not okie dokie");
-	glCheck(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+	GLStateCache::Get().bindFramebuffer(0);
 	useViewport();
 }
 
@@ -78,7 +78,7 @@ void FrameBuffer::init() {
 		glCheck(glGenRenderbuffers(1, &m_depthBuffer));
 	}
 
-	glCheck(glBindFramebuffer(GL_FRAMEBUFFER, m_frameBuffer->ID));
+	GLStateCache::Get().bindFramebuffer(m_frameBuffer->ID);
 
 	for (int i = 0; i < m_colorTextures.size(); i++) {
 		// Allocates texture
@@ -99,7 +99,7 @@ void FrameBuffer::init() {
 	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
 		throw std::exception("Frame buffer is not okie dokie");
 
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	GLStateCache::Get().bindFramebuffer(0);
 	m_initialized = true;
 }
 
@@ -131,7 +131,7 @@ void FrameBuffer::getPixels(size_t p_colorBufferIndex, uint8_t p_channels, Array
 	glReadPixels(0, 0, m_dimensions.x, m_dimensions.y, m_colorTextures[p_colorBufferIndex].channels, GL_UNSIGNED_BYTE, tmp);
 	o_out.append(tmp, m_dimensions.x * m_dimensions.y * p_channels);
 	free(tmp);
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	GLStateCache::Get().bindFramebuffer(0);
 }
 void FrameBuffer::getPixels(size_t p_colorBufferIndex, uint8_t p_channels, StaticArray2D<uint8_t>& o_out)
 {
@@ -142,7 +142,24 @@ void FrameBuffer::getPixels(size_t p_colorBufferIndex, uint8_t p_channels, Stati
 	bind();
 	glReadPixels(0, 0, m_dimensions.x, m_dimensions.y, m_colorTextures[p_colorBufferIndex].channels, GL_UNSIGNED_BYTE, tmp);
 	o_out.setData(tmp);
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	GLStateCache::Get().bindFramebuffer(0);
+}
+void FrameBuffer::getPixels(size_t p_colorBufferIndex, uint8_t p_channels, StaticArray2D<uint8_t, AlignedGridAllocator>& o_out, const GridAllocOptions& p_options)
+{
+	o_out.reset();
+	o_out.resize(m_dimensions.x * p_channels, m_dimensions.y);
+	// GL wants the row length in whole pixels
+	GridAllocOptions options = p_options;
+	options.pitchMultiple = p_channels;
+	o_out.allocate(options);
+
+	bind();
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glPixelStorei(GL_PACK_ROW_LENGTH, (GLint)(o_out.pitch / p_channels));
+	glReadPixels(0, 0, m_dimensions.x, m_dimensions.y, m_colorTextures[p_colorBufferIndex].channels, GL_UNSIGNED_BYTE, o_out.getData());
+	glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	GLStateCache::Get().bindFramebuffer(0);
 }
 
 void FrameBuffer::useDepth(bool p_bool)
@@ -18,6 +18,13 @@ void GenericShaders::init() {
 	image_imageTextureUniformLoc = imageShader.addTexUniform("imageTexture", 0);
 	image_opacityUniformLoc = imageShader.addFloatUniform("opacity", 0.f);
 
+	spriteBatchShader = Shader(
+		"./src/Shaders/SpriteBatchVS.glsl",
+		"./src/Shaders/SpriteBatchFS.glsl"
+	);
+	spriteBatchShader.addMat4Uniform("transform", tmp);
+	spriteBatch_imageTextureUniformLoc = spriteBatchShader.addTexUniform("imageTexture", 0);
+
 	solidColorShader = Shader(
 		"./src/Shaders/SolidColorVS.glsl",
 		"./src/Shaders/SolidColorFS.glsl"
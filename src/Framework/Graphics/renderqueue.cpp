@@ -0,0 +1,137 @@
+#include "Framework/Graphics/RenderQueue.hpp"
+#include "Framework/Graphics/GlStateCache.hpp"
+#include <algorithm>
+
+void RenderQueue::begin(SubmitOrder p_order)
+{
+	clear();
+	m_order = p_order;
+}
+
+void RenderQueue::clear()
+{
+	m_commands.clear();
+	m_textures.clear();
+	m_uniforms.clear();
+	m_entries.clear();
+	m_sorted = true;
+	m_shaders.clear();
+	m_textureSets.clear();
+	m_blendModes.clear();
+}
+
+RenderCommand& RenderQueue::push(const DrawStates& p_states)
+{
+	uint32_t index = (uint32_t)m_commands.size();
+	RenderCommand& command = m_commands.emplace_back();
+	command.shader = p_states.m_shaderPtr;
+	command.blendMode = p_states.m_blendMode;
+	command.transform = p_states.m_transform;
+
+	command.firstTexture = (uint32_t)m_textures.size();
+	command.textureCount = (uint32_t)p_states.m_textures.size();
+	for (const Texture& texture : p_states.m_textures) m_textures.push_back({ texture.type, texture.glID->ID });
+	command.firstUniform = (uint32_t)m_uniforms.size();
+	command.uniformCount = (uint32_t)p_states.m_uniforms.size();
+	m_uniforms.insert(m_uniforms.end(), p_states.m_uniforms.begin(), p_states.m_uniforms.end());
+
+	uint64_t key = (uint64_t)p_states.m_layer << LAYER_SHIFT;
+	if (m_order == SubmitOrder::Submission) key |= index;
+	else key |= stateKey(p_states, command.firstTexture);
+	command.key = key;
+
+	if (!m_entries.empty() && key < m_entries.back().key) m_sorted = false;
+	m_entries.push_back({ key, index });
+	return command;
+}
+
+uint64_t RenderQueue::stateKey(const DrawStates& p_states, uint32_t p_firstTexture)
+{
+	float depth = std::clamp(p_states.m_depth, 0.f, 1.f);
+	return (uint64_t)shaderID(p_states.m_shaderPtr) << SHADER_SHIFT
+		| (uint64_t)textureSetID(p_firstTexture, (uint32_t)p_states.m_textures.size()) << TEXTURE_SET_SHIFT
+		| (uint64_t)blendID(p_states.m_blendMode) << BLEND_SHIFT
+		| (uint64_t)(depth * MAX_DEPTH);
+}
+
+uint32_t RenderQueue::shaderID(const Shader* p_shader)
+{
+	// only ever a handful, and usually the last one again
+	for (size_t i = m_shaders.size(); i-- > 0;) {
+		if (m_shaders[i] == p_shader) return (uint32_t)std::min<size_t>(i, MAX_SHADER_ID);
+	}
+	m_shaders.push_back(p_shader);
+	return (uint32_t)std::min<size_t>(m_shaders.size() - 1, MAX_SHADER_ID);
+}
+
+uint32_t RenderQueue::textureSetID(uint32_t p_firstTexture, uint32_t p_count)
+{
+	// FNV-1a over the bindings. Two sets hashing the same would only share a number in the key, not their textures.
+	uint64_t hash = 14695981039346656037ull;
+	for (uint32_t i = p_firstTexture; i < p_firstTexture + p_count; i++) {
+		hash = (hash ^ m_textures[i].type) * 1099511628211ull;
+		hash = (hash ^ m_textures[i].ID) * 1099511628211ull;
+	}
+	auto found = m_textureSets.try_emplace(hash, (uint32_t)std::min<size_t>(m_textureSets.size(), MAX_TEXTURE_SET_ID));
+	return found.first->second;
+}
+
+uint32_t RenderQueue::blendID(const BlendMode& p_mode)
+{
+	for (size_t i = 0; i < m_blendModes.size(); i++) {
+		if (m_blendModes[i] == p_mode) return (uint32_t)std::min<size_t>(i, MAX_BLEND_ID);
+	}
+	m_blendModes.push_back(p_mode);
+	return (uint32_t)std::min<size_t>(m_blendModes.size() - 1, MAX_BLEND_ID);
+}
+
+std::span<const RenderQueue::Entry> RenderQueue::sort()
+{
+	size_t count = m_entries.size();
+	if (m_sorted) return m_entries;
+
+	// LSD radix sort a byte at a time, which is stable, so equal keys stay in the order they were drawn
+	size_t histograms[8][256] = {};
+	for (const Entry& entry : m_entries) {
+		for (int digit = 0; digit < 8; digit++) histograms[digit][(entry.key >> (digit * 8)) & 0xFF]++;
+	}
+	m_scratch.resize(count);
+	Entry* src = m_entries.data();
+	Entry* dst = m_scratch.data();
+	for (int digit = 0; digit < 8; digit++) {
+		int shift = digit * 8;
+		size_t* histogram = histograms[digit];
+		// every key has the same byte here, so the pass wouldn't move anything. Most of the key usually is.
+		if (histogram[(src[0].key >> shift) & 0xFF] == count) continue;
+		size_t offset = 0;
+		for (int bucket = 0; bucket < 256; bucket++) {
+			size_t size = histogram[bucket];
+			histogram[bucket] = offset;
+			offset += size;
+		}
+		for (size_t i = 0; i < count; i++) dst[histogram[(src[i].key >> shift) & 0xFF]++] = src[i];
+		std::swap(src, dst);
+	}
+	if (src != m_entries.data()) m_entries.swap(m_scratch);
+	m_sorted = true;
+	return m_entries;
+}
+
+void RenderQueue::execute()
+{
+	GLStateCache& gl = GLStateCache::Get();
+	for (const Entry& entry : sort()) {
+		RenderCommand& command = m_commands[entry.index];
+		Shader& shader = *command.shader;
+		gl.bindVertexArray(command.VAO);
+		shader.use();
+		for (uint32_t i = 0; i < command.textureCount; i++) {
+			const TextureRef& texture = m_textures[command.firstTexture + i];
+			gl.bindTexture(i, texture.type, texture.ID);
+		}
+		gl.setBlend(command.blendMode);
+		for (const DrawStates::UniformValue& uniform : uniforms(command)) uniform.apply(shader);
+		shader.setMat4Uniform(shader.getTransformLoc(), command.transform);
+		command.submit(command.mesh, command.primitiveType);
+	}
+}
@@ -1,8 +1,15 @@
 #include "Framework/Graphics/Shader.hpp"
 #include "Framework/Graphics/GlCheck.hpp"
+#include "Framework/Graphics/GlStateCache.hpp"
 #include "util/utils.hpp"
 #include <util/ext/glm/gtc/type_ptr.hpp>
 #include <exception>
+#include <algorithm>
+#include <cstring>
+
+std::weak_ptr<UniformTable> Shader::s_currentTable;
+Shader::UniformStats Shader::s_frameStats;
+Shader::UniformStats Shader::s_lastFrameStats;
 
 Shader::Shader(const char* vs_filePath, const char* fs_filePath)
 {
@@ -30,17 +37,22 @@ Shader::Shader(const char* vs_filePath, const char* gs_filePath, const char* fs_
         glGetProgramInfoLog(program->ID, 512, nullptr, infoLog);
         ERROR_LOG(infoLog);
     }
+    // relinking can move uniforms around
+    m_uniformTable->reflect(program->ID);
     GLGEN_LOG("Created Shader Program " << program->ID);
 }
 
 Shader& Shader::operator=(const Shader& p_other) {
     program = p_other.program;
+    m_uniformTable = p_other.m_uniformTable;
     return *this;
 }
 
 Shader::Shader(Shader&& other) noexcept {
     LOG("Moved Shader! Program ID: " << other.program->ID);
-    other.program = std::move(program);
+    program = std::move(other.program);
+    m_uniformTable = std::move(other.m_uniformTable);
+    m_uniforms = std::move(other.m_uniforms);
 }
 GLuint Shader::compileShaders(const char* vs_filePath, const char* fs_filePath) {
     GLuint vs, fs;
@@ -135,7 +147,8 @@ GLuint Shader::compileShaders(const char* vs_filePath, const char* fs_filePath)
         throw std::runtime_error("Shader was unable to compile.");
         return -1;
     }
-    glCheck(glUseProgram(program->ID));
+    m_uniformTable->reflect(program->ID);
+    GLStateCache::Get().useProgram(program->ID);
 
     return program->ID;
 }
@@ -265,14 +278,43 @@ GLuint Shader::compileShaders(const char* vs_filePath, const char* gs_filePath,
         throw std::runtime_error("Shader was unable to compile.");
         return -1;
     }
+    m_uniformTable->reflect(program->ID);
 
-    glUseProgram(program->ID);
+    GLStateCache::Get().useProgram(program->ID);
 
     return program->ID;
 }
 
 void Shader::use() const {
-    glCheck(glUseProgram(program->ID));
+    GLStateCache::Get().useProgram(program->ID);
+    s_currentTable = m_uniformTable;
+}
+
+bool Shader::shadowUniform(GLint p_loc, const void* p_value, size_t p_size) const
+{
+    if (m_uniformTable->update(p_loc, p_value, p_size)) {
+        s_frameStats.uploaded++;
+        return true;
+    }
+    s_frameStats.skipped++;
+    return false;
+}
+
+void Shader::invalidateCurrent(GLint p_loc)
+{
+    s_frameStats.uploaded++;
+    if (std::shared_ptr<UniformTable> table = s_currentTable.lock()) table->invalidate(p_loc);
+}
+
+Shader::UniformStats Shader::getUniformStats()
+{
+    return s_lastFrameStats;
+}
+
+void Shader::endFrame()
+{
+    s_lastFrameStats = s_frameStats;
+    s_frameStats = UniformStats();
 }
 
 //void Shader::setUniforms(std::vector<Uniform> p_uniforms) {
@@ -313,16 +355,21 @@ GLint Shader::addBoolUniform(std::string_view p_name, bool p_value)
     Uniform u = Uniform{ p_name, UniformTypes::BOOL, p_value };
     u.loc = loc;
     m_uniforms.push_back(u);
+    GLint value = (GLint)p_value;
+    m_uniformTable->update(loc, &value, sizeof(value));
     glCheck(glUniform1i(loc, (int)p_value));
     return loc;
 }
 void Shader::setBoolUniform(GLint p_loc, bool p_value) const
 {
+    GLint value = (GLint)p_value;
+    if (!shadowUniform(p_loc, &value, sizeof(value))) return;
     use();
-    glCheck(glUniform1i(p_loc, (int)p_value));
+    glCheck(glUniform1i(p_loc, value));
 }
 void Shader::setBoolUniformStatic(GLint p_loc, bool p_value)
 {
+    invalidateCurrent(p_loc);
     glCheck(glUniform1i(p_loc, (int)p_value));
 }
 GLint Shader::addIntUniform(std::string_view p_name, GLint p_value)
@@ -332,16 +379,19 @@ GLint Shader::addIntUniform(std::string_view p_name, GLint p_value)
     Uniform u = Uniform{ p_name, UniformTypes::INT, p_value };
     u.loc = loc;
     m_uniforms.push_back(u);
+    m_uniformTable->update(loc, &p_value, sizeof(p_value));
     glCheck(glUniform1i(loc, p_value));
     return loc;
 }
 void Shader::setIntUniform(GLint p_loc, GLint p_value) const
 {
+    if (!shadowUniform(p_loc, &p_value, sizeof(p_value))) return;
     use();
     glCheck(glUniform1i(p_loc, p_value));
 }
 void Shader::setIntUniformStatic(GLint p_loc, GLint p_value)
 {
+    invalidateCurrent(p_loc);
     glCheck(glUniform1i(p_loc, p_value));
 }
 GLint Shader::addTexUniform(std::string_view p_name, GLuint p_value)
@@ -351,18 +401,21 @@ GLint Shader::addTexUniform(std::string_view p_name, GLuint p_value)
     Uniform u = Uniform{ p_name, UniformTypes::TEX, p_value };
     u.loc = loc;
     m_uniforms.push_back(u);
+    m_uniformTable->update(loc, &p_value, sizeof(p_value));
     glCheck(glUniform1i(loc, p_value));
     return loc;
 }
 
 void Shader::setTexUniform(GLint p_loc, GLuint p_value)
 {
+    if (!shadowUniform(p_loc, &p_value, sizeof(p_value))) return;
     use();
     glCheck(glUniform1i(p_loc, p_value));
 }
 
 void Shader::setTexUniformStatic(GLint p_loc, GLuint p_value)
 {
+    invalidateCurrent(p_loc);
     glCheck(glUniform1i(p_loc, p_value));
 }
 
@@ -381,16 +434,19 @@ GLint Shader::addFloatUniform(std::string_view p_name, GLfloat p_value)
     Uniform u = Uniform{ p_name, UniformTypes::FLOAT, p_value };
     u.loc = loc;
     m_uniforms.push_back(u);
+    m_uniformTable->update(loc, &p_value, sizeof(p_value));
     glCheck(glUniform1f(loc, p_value));
     return loc;
 }
 void Shader::setFloatUniform(GLint p_loc, GLfloat p_value) const
 {
+    if (!shadowUniform(p_loc, &p_value, sizeof(p_value))) return;
     use();
     glCheck(glUniform1f(p_loc, p_value));
 }
 void Shader::setFloatUniformStatic(GLint p_loc, GLfloat p_value)
 {
+    invalidateCurrent(p_loc);
     glCheck(glUniform1f(p_loc, p_value));
 }
 GLint Shader::addMat4Uniform(std::string_view p_name, glm::mat4& p_value)
@@ -400,12 +456,14 @@ GLint Shader::addMat4Uniform(std::string_view p_name, glm::mat4& p_value)
     Uniform u = Uniform{ p_name, UniformTypes::MAT4, p_value };
     u.loc = loc;
     m_uniforms.push_back(u);
+    m_uniformTable->update(loc, &p_value, sizeof(p_value));
     glCheck(glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(p_value)));
     return loc;
 }
 
 void Shader::setMat4Uniform(GLint p_loc, glm::mat4& p_value)
 {
+    if (!shadowUniform(p_loc, &p_value, sizeof(p_value))) return;
     use();
     glCheck(glUniformMatrix4fv(p_loc, 1, GL_FALSE, glm::value_ptr(p_value)));
 }
@@ -413,11 +471,13 @@ void Shader::setMat4Uniform(GLint p_loc, glm::mat4& p_value)
 void Shader::setMat4UniformStaticNamed(std::string_view p_name, glm::mat4& p_value, GLuint p_progID)
 {
     GLint loc = glGetUniformLocation(p_progID, p_name.data());
+    invalidateCurrent(loc);
     glCheck(glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(p_value)));
 }
 
 void Shader::setMat4UniformStatic(GLint p_loc, glm::mat4& p_value)
 {
+    invalidateCurrent(p_loc);
     glCheck(glUniformMatrix4fv(p_loc, 1, GL_FALSE, glm::value_ptr(p_value)));
 }
 
@@ -428,18 +488,21 @@ GLint Shader::addVec2Uniform(std::string_view p_name, glm::vec2 p_value)
     Uniform u = Uniform{ p_name, UniformTypes::VEC2, p_value };
     u.loc = loc;
     m_uniforms.push_back(u);
+    m_uniformTable->update(loc, &p_value, sizeof(p_value));
     glCheck(glUniform2f(loc, p_value.x, p_value.y));
     return loc;
 }
 
 void Shader::setVec2Uniform(GLint p_loc, glm::vec2 p_value) const
 {
+    if (!shadowUniform(p_loc, &p_value, sizeof(p_value))) return;
     use();
     glCheck(glUniform2f(p_loc, p_value.x, p_value.y));
 }
 
 void Shader::setVec2UniformStatic(GLint p_loc, glm::vec2 p_value)
 {
+    invalidateCurrent(p_loc);
     glCheck(glUniform2f(p_loc, p_value.x, p_value.y));
 }
 
@@ -450,18 +513,21 @@ GLint Shader::addVec3Uniform(std::string_view p_name, glm::vec3 p_value)
     Uniform u = Uniform{ p_name, UniformTypes::VEC3, p_value };
     u.loc = loc;
     m_uniforms.push_back(u);
+    m_uniformTable->update(loc, &p_value, sizeof(p_value));
     glCheck(glUniform3f(loc, p_value.x, p_value.y, p_value.z));
     return loc;
 }
 
 void Shader::setVec3Uniform(GLint p_loc, glm::vec3 p_value) const
 {
+    if (!shadowUniform(p_loc, &p_value, sizeof(p_value))) return;
     use();
     glCheck(glUniform3f(p_loc, p_value.x, p_value.y, p_value.z));
 }
 
 void Shader::setVec3UniformStatic(GLint p_loc, glm::vec3 p_value)
 {
+    invalidateCurrent(p_loc);
     glCheck(glUniform3f(p_loc, p_value.x, p_value.y, p_value.z));
 }
 
@@ -472,28 +538,32 @@ GLint Shader::addVec4Uniform(std::string_view p_name, glm::vec4 p_value)
     Uniform u = Uniform{ p_name, UniformTypes::VEC4, p_value };
     u.loc = loc;
     m_uniforms.push_back(u);
+    m_uniformTable->update(loc, &p_value, sizeof(p_value));
     glCheck(glUniform4f(loc, p_value.x, p_value.y, p_value.z, p_value.w));
     return loc;
 }
 
 void Shader::setVec4Uniform(GLint p_loc, glm::vec4 p_value) const
 {
+    if (!shadowUniform(p_loc, &p_value, sizeof(p_value))) return;
     use();
     glCheck(glUniform4f(p_loc, p_value.x, p_value.y, p_value.z, p_value.w));
 }
 
 void Shader::setVec4UniformStatic(GLint p_loc, glm::vec4 p_value)
 {
+    invalidateCurrent(p_loc);
     glCheck(glUniform4f(p_loc, p_value.x, p_value.y, p_value.z, p_value.w));
 }
 
 GLuint Shader::getUniformLoc(std::string_view uniformName)
 {
-    GLint loc = -1;
-    for (auto& u : m_uniforms) {
-        if (u.name == uniformName) loc = u.loc;
-    }
-    return loc;
+    return m_uniformTable->find(uniformName);
+}
+
+GLint Shader::getTransformLoc() const
+{
+    return m_uniformTable->transformLoc;
 }
 
 GLuint Shader::getUniformBlockIndex(std::string_view uniformBlockName)
@@ -504,3 +574,89 @@ GLuint Shader::getUniformBlockIndex(std::string_view uniformBlockName)
     }
     return loc;
 }
+
+void UniformTable::reflect(GLuint p_programID)
+{
+    entries.clear();
+    m_slots.clear();
+    m_byLocation.clear();
+    transformLoc = -1;
+
+    GLint count = 0, maxLength = 0;
+    glCheck(glGetProgramiv(p_programID, GL_ACTIVE_UNIFORMS, &count));
+    glCheck(glGetProgramiv(p_programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength));
+    std::vector<GLchar> nameBuffer(std::max(maxLength, 1));
+    GLint maxLocation = -1;
+    for (GLint i = 0; i < count; i++) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glCheck(glGetActiveUniform(p_programID, (GLuint)i, (GLsizei)nameBuffer.size(), &length, &size, &type, nameBuffer.data()));
+        Entry entry;
+        entry.name.assign(nameBuffer.data(), length);
+        // arrays come back as "name[0]"
+        if (entry.name.size() > 3 && entry.name.compare(entry.name.size() - 3, 3, "[0]") == 0) entry.name.resize(entry.name.size() - 3);
+        entry.location = glGetUniformLocation(p_programID, entry.name.c_str());
+        // uniform block members don't have locations
+        if (entry.location < 0) continue;
+        entry.hash = hashName(entry.name);
+        entry.type = type;
+        entry.arraySize = size;
+        maxLocation = std::max(maxLocation, entry.location);
+        entries.push_back(std::move(entry));
+    }
+
+    size_t capacity = 8;
+    while (capacity < entries.size() * 2) capacity <<= 1;
+    m_slots.assign(capacity, 0);
+    m_byLocation.assign(maxLocation + 1, 0);
+    for (size_t i = 0; i < entries.size(); i++) {
+        size_t slot = entries[i].hash & (capacity - 1);
+        while (m_slots[slot]) slot = (slot + 1) & (capacity - 1);
+        m_slots[slot] = (uint32_t)i + 1;
+        m_byLocation[entries[i].location] = (uint32_t)i + 1;
+    }
+    transformLoc = find("transform");
+    LOAD_LOG("Reflected " << entries.size() << " uniforms from program " << p_programID << ".");
+}
+
+GLint UniformTable::find(std::string_view p_name) const
+{
+    if (m_slots.empty()) return -1;
+    if (p_name.size() > 3 && p_name.substr(p_name.size() - 3) == "[0]") p_name.remove_suffix(3);
+    uint32_t hash = hashName(p_name);
+    size_t mask = m_slots.size() - 1;
+    for (size_t slot = hash & mask; m_slots[slot]; slot = (slot + 1) & mask) {
+        const Entry& entry = entries[m_slots[slot] - 1];
+        if (entry.hash == hash && entry.name == p_name) return entry.location;
+    }
+    return -1;
+}
+
+bool UniformTable::update(GLint p_loc, const void* p_value, size_t p_size)
+{
+    if (p_loc < 0 || (size_t)p_loc >= m_byLocation.size() || !m_byLocation[p_loc]) return true;
+    Entry& entry = entries[m_byLocation[p_loc] - 1];
+    p_size = std::min(p_size, sizeof(entry.shadow));
+    if (entry.shadowValid && std::memcmp(entry.shadow, p_value, p_size) == 0) return false;
+    std::memcpy(entry.shadow, p_value, p_size);
+    entry.shadowValid = true;
+    return true;
+}
+
+void UniformTable::invalidate(GLint p_loc)
+{
+    if (p_loc < 0 || (size_t)p_loc >= m_byLocation.size() || !m_byLocation[p_loc]) return;
+    entries[m_byLocation[p_loc] - 1].shadowValid = false;
+}
+
+uint32_t UniformTable::hashName(std::string_view p_name)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (char c : p_name) {
+        hash ^= (uint8_t)c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
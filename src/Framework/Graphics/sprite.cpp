@@ -27,20 +27,7 @@ void Sprite::initForDraw()
 	m_spriteMesh.addFloatAttrib(3); // Position
 	m_spriteMesh.addFloatAttrib(2); // Texcoord
 
-	// The four corner coordinates of the bounding rectangle. Note that the rectangle is in model space and not world space.
-	glm::vec2 tl = bounds.getTL();
-	glm::vec2 tr = bounds.getTR();
-	glm::vec2 bl = bounds.getBL();
-	glm::vec2 br = bounds.getBR();
-
-	m_spriteMesh.pushVertices({
-		tl.x, tl.y, 0.0f, 0.0f, 0.0f, // vertex 1
-		tr.x, tr.y, 0.0f, 1.0f, 0.0f, // vertex 2
-		bl.x, bl.y, 0.0f, 0.0f, 1.0f, // vertex 3
-		bl.x, bl.y, 0.0f, 0.0f, 1.0f, // vertex 4
-		tr.x, tr.y, 0.0f, 1.0f, 0.0f, // vertex 5
-		br.x, br.y, 0.0f, 1.0f, 1.0f // vertex 6
-		});
+	pushQuad();
 
 	auto& gs = GenericShaders::Get();
 	// default shader
@@ -83,19 +70,17 @@ void Sprite::draw(DrawSurface& p_target, const DrawStates& p_drawStates)
 		newStates.attachTexture(m_attachedTexture);
 	}
 
+	// Goes in with the states so it survives a deferred draw. 0 is the shader's default, so other sprites get it back.
+	// An unset (0) opacity doesn't override one the caller already put in the states, like a GUI background's.
 	if (m_attachedShader) {
-		m_attachedShader->use();
-		if (opacity != 0.f) { // scuffed check, this is kinda bad
-			m_attachedShader->setFloatUniform(m_attachedShader->getUniformLoc("opacity"), opacity);
-		}
+		GLint opacityLoc = m_attachedShader->getUniformLoc("opacity");
+		if (opacity != 0.f || !newStates.hasUniform(opacityLoc)) newStates.setUniform(opacityLoc, opacity);
 	}
 
 	// Multiply it with the existing state transform, just in case it's relative to another coordinate system. Model space to world space.
 	newStates.setTransform(p_drawStates.m_transform * getObjectTransform());
 
 	p_target.draw(m_spriteMesh, GL_TRIANGLES, newStates);
-	if (m_attachedShader && opacity != 0.f)
-		m_attachedShader->setFloatUniform(m_attachedShader->getUniformLoc("opacity"), 0.f); // keep it defaulted for other things using the shader.
 }
 
 void Sprite::setOriginRelative(OriginLoc p_origin)
@@ -107,23 +92,57 @@ void Sprite::setBounds(Rect p_bounds)
 {
 	if (bounds.xy == p_bounds.xy && bounds.wh == p_bounds.wh) return;
 	bounds = p_bounds;
+	m_spriteMesh.remove();
+	pushQuad();
+	if (m_drawReady)
+		m_spriteMesh.pushVBOToGPU();
+
+}
+
+void Sprite::setUVRect(Rect p_uvRect)
+{
+	if (m_uvRect.xy == p_uvRect.xy && m_uvRect.wh == p_uvRect.wh) return;
+	m_uvRect = p_uvRect;
+	m_spriteMesh.remove();
+	pushQuad();
+	if (m_drawReady)
+		m_spriteMesh.pushVBOToGPU();
+}
+
+const Rect& Sprite::getUVRect() const
+{
+	return m_uvRect;
+}
+
+Shader* Sprite::getShader()
+{
+	return m_attachedShader;
+}
+
+float Sprite::getOpacity() const
+{
+	return opacity;
+}
+
+void Sprite::pushQuad()
+{
+	// The four corner coordinates of the bounding rectangle. Note that the rectangle is in model space and not world space.
 	glm::vec2 tl = bounds.getTL();
 	glm::vec2 tr = bounds.getTR();
 	glm::vec2 bl = bounds.getBL();
 	glm::vec2 br = bounds.getBR();
+	// texture rows go top down, so the top of the sprite is the top of the uv rect
+	glm::vec2 uvTL = m_uvRect.getBL();
+	glm::vec2 uvBR = m_uvRect.getTR();
 
-	m_spriteMesh.remove();
 	m_spriteMesh.pushVertices({
-		tl.x, tl.y, 0.0f, 0.0f, 0.0f, // vertex 1
-		tr.x, tr.y, 0.0f, 1.0f, 0.0f, // vertex 2
-		bl.x, bl.y, 0.0f, 0.0f, 1.0f, // vertex 3
-		bl.x, bl.y, 0.0f, 0.0f, 1.0f, // vertex 4
-		tr.x, tr.y, 0.0f, 1.0f, 0.0f, // vertex 5
-		br.x, br.y, 0.0f, 1.0f, 1.0f // vertex 6
+		tl.x, tl.y, 0.0f, uvTL.x, uvTL.y, // vertex 1
+		tr.x, tr.y, 0.0f, uvBR.x, uvTL.y, // vertex 2
+		bl.x, bl.y, 0.0f, uvTL.x, uvBR.y, // vertex 3
+		bl.x, bl.y, 0.0f, uvTL.x, uvBR.y, // vertex 4
+		tr.x, tr.y, 0.0f, uvBR.x, uvTL.y, // vertex 5
+		br.x, br.y, 0.0f, uvBR.x, uvBR.y // vertex 6
 	});
-	if (m_drawReady)
-		m_spriteMesh.pushVBOToGPU();
-
 }
 
 void Sprite::setOpacity(float p_opacity)
@@ -0,0 +1,129 @@
+#include "Framework/Graphics/SpriteBatch.hpp"
+#include "Framework/Graphics/GenericShaders.hpp"
+#include "Framework/Graphics/GlStateCache.hpp"
+#include "util/Threadpool.hpp"
+
+// below this it's not worth waking the pool up
+static constexpr size_t PARALLEL_MIN_SPRITES = 2048;
+
+void SpriteBatch::add(Sprite& p_sprite, const DrawStates& p_states)
+{
+	GenericShaders& gs = GenericShaders::Get();
+	// the sprite would pick the image shader on its first draw, and the batch version of that is the batch shader
+	Shader* shader = p_sprite.getShader();
+	if (!shader || shader == &gs.imageShader) shader = &gs.spriteBatchShader;
+
+	const Texture* texture = nullptr;
+	if (p_sprite.getTexture().initialized) texture = &p_sprite.getTexture();
+	else if (!p_states.m_textures.empty()) texture = &p_states.m_textures[0];
+
+	if (m_parents.empty() || m_parents.back() != p_states.m_transform) m_parents.push_back(p_states.m_transform);
+
+	uint32_t batch = findBatch(shader, texture, p_states.m_blendMode);
+	m_entries.push_back({ &p_sprite, batch, m_batches[batch].count++, (uint32_t)m_parents.size() - 1 });
+}
+
+void SpriteBatch::add(std::span<Sprite* const> p_sprites, const DrawStates& p_states)
+{
+	m_entries.reserve(m_entries.size() + p_sprites.size());
+	for (Sprite* sprite : p_sprites) add(*sprite, p_states);
+}
+
+void SpriteBatch::draw(ThreadPool* p_pool)
+{
+	m_lastDrawCalls = 0;
+	if (m_entries.empty()) return;
+	if (!m_drawReady) initForDraw();
+
+	// written straight into the next section of the mesh's stream buffer
+	build(m_mesh.streamInstances(m_entries.size()), p_pool);
+
+	GLStateCache& gl = GLStateCache::Get();
+	gl.bindVertexArray(m_mesh.VAO->ID);
+	for (const Batch& batch : m_batches) {
+		batch.shader->use();
+		if (batch.texture) gl.bindTexture(0, batch.textureType, batch.texture);
+		gl.setBlend(batch.blendMode);
+		batch.shader->setMat4Uniform(batch.shader->getTransformLoc(), m_identity);
+		glCheck(glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0, 6, (GLsizei)batch.count, m_mesh.getBaseInstance() + batch.first));
+	}
+	m_lastDrawCalls = m_batches.size();
+	clear();
+}
+
+void SpriteBatch::clear()
+{
+	m_entries.clear();
+	m_batches.clear();
+	m_parents.clear();
+}
+
+uint32_t SpriteBatch::findBatch(Shader* p_shader, const Texture* p_texture, const BlendMode& p_blendMode)
+{
+	GLenum textureType = p_texture ? p_texture->type : GL_TEXTURE_2D;
+	GLuint texture = p_texture ? p_texture->glID->ID : 0;
+	// newest first, since sprites that share state tend to get added together
+	for (size_t i = m_batches.size(); i-- > 0;) {
+		const Batch& batch = m_batches[i];
+		if (batch.shader == p_shader && batch.texture == texture && batch.textureType == textureType && batch.blendMode == p_blendMode) return (uint32_t)i;
+		// in submission order, anything but the last batch is already behind something else
+		if (m_order == SubmitOrder::Submission) break;
+	}
+	m_batches.push_back({ p_shader, textureType, texture, p_blendMode, 0, 0 });
+	return (uint32_t)m_batches.size() - 1;
+}
+
+void SpriteBatch::build(std::span<SpriteInstance> o_instances, ThreadPool* p_pool)
+{
+	uint32_t first = 0;
+	for (Batch& batch : m_batches) {
+		batch.first = first;
+		first += batch.count;
+	}
+
+	// every entry has its own slot, so chunks never write to the same place
+	auto buildRange = [&](size_t p_begin, size_t p_end) {
+		for (size_t i = p_begin; i < p_end; i++) {
+			const Entry& entry = m_entries[i];
+			Sprite& sprite = *entry.sprite;
+			SpriteInstance& instance = o_instances[m_batches[entry.batch].first + entry.rank];
+
+			// folding the bounds in here means the vertices can just be the unit square
+			glm::mat4 transform = m_parents[entry.parent] * sprite.getObjectTransform();
+			const Rect& bounds = sprite.bounds;
+			instance.transform[0] = transform[0] * bounds.wh.x;
+			instance.transform[1] = transform[1] * bounds.wh.y;
+			instance.transform[2] = transform[2];
+			instance.transform[3] = transform[0] * bounds.xy.x + transform[1] * bounds.xy.y + transform[3];
+
+			const Rect& uv = sprite.getUVRect();
+			instance.uvRect = glm::vec4(uv.xy, uv.wh);
+			instance.opacity = sprite.getOpacity();
+		}
+	};
+	if (p_pool && m_entries.size() >= PARALLEL_MIN_SPRITES) p_pool->parallelFor(0, m_entries.size(), 0, buildRange);
+	else buildRange(0, m_entries.size());
+}
+
+void SpriteBatch::initForDraw()
+{
+	m_mesh.addFloatAttrib(2); // Corner
+	m_mesh.addFloatAttrib(4, true); // Transform, a column at a time
+	m_mesh.addFloatAttrib(4, true);
+	m_mesh.addFloatAttrib(4, true);
+	m_mesh.addFloatAttrib(4, true);
+	m_mesh.addFloatAttrib(4, true); // UV rect
+	m_mesh.addFloatAttrib(1, true); // Opacity
+
+	// Same winding as Sprite's own mesh
+	m_mesh.pushVertices({
+		0.0f, 1.0f, // top left
+		1.0f, 1.0f, // top right
+		0.0f, 0.0f, // bottom left
+		0.0f, 0.0f, // bottom left
+		1.0f, 1.0f, // top right
+		1.0f, 0.0f // bottom right
+	});
+	m_mesh.pushVBOToGPU();
+	m_drawReady = true;
+}
@@ -40,9 +40,8 @@ void Font::createAtlas() {
 	texDims = 1;
 	while (texDims < (uint32_t)dimEstimate) texDims <<= 1;
 
-	uint8_t* pixelDataRaw = (uint8_t*)calloc(texDims * texDims, 1);
 	m_atlas.resize(texDims, texDims);
-	m_atlas.setData(pixelDataRaw);
+	m_atlas.allocate();
 
 	// The position of the current character within the atlas
 	int charX = 0;
@@ -100,7 +99,7 @@ Texture Font::getTexture() {
 		createAtlas();
 	}
 	m_atlasTexture.setChannels(GL_RED);
-	m_atlasTexture.fromByteData((uint32_t)m_atlas.width, (uint32_t)m_atlas.height, m_atlas.getData());
+	m_atlasTexture.fromByteData((uint32_t)m_atlas.width, (uint32_t)m_atlas.height, m_atlas.getData(), (uint32_t)m_atlas.pitch);
 	m_atlasTexture.setFiltering(GL_LINEAR, GL_LINEAR);
 	return m_atlasTexture;
 }
@@ -255,11 +254,12 @@ void Text::draw(const glm::vec3& p_textColor, DrawSurface& p_target, DrawStates&
 	}
 
 	p_drawStates.attachShader(&gs.textShader);
-	gs.textShader.setVec3Uniform(gs.text_textColUniformLoc, p_textColor);
+	p_drawStates.setUniform(gs.text_textColUniformLoc, p_textColor);
 	Texture fontTex = m_font.getTexture();
 	p_drawStates.attachTexture(fontTex);
 	p_target.draw(m_textMesh, GL_TRIANGLES, p_drawStates);
 	// don't corrupt the state
+	p_drawStates.removeUniform(gs.text_textColUniformLoc);
 	p_drawStates.setTransform(p_drawStates.m_transform * glm::inverse(getObjectTransform()));
 }
 // position is in screen coordinates, -1...0...1
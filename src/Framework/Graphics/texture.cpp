@@ -1,6 +1,7 @@
 #include "Framework/Graphics/Texture.hpp"
 #include "util/utils.hpp"
 #include "Framework/Graphics/GlCheck.hpp"
+#include "Framework/Graphics/GlStateCache.hpp"
 
 #include "Framework/Log.hpp"
 #include "Framework/Graphics/GlCheck.hpp"
@@ -33,19 +34,17 @@ void Texture::setFiltering(GLenum p_min, GLenum p_mag) {
 	m_filteringMin = p_min;
 
 	if (initialized) {
-		glBindTexture(type, glID->ID);
+		GLStateCache::Get().bindTexture(type, glID->ID);
 		glTexParameteri(type, GL_TEXTURE_MIN_FILTER, m_filteringMin);
 		glTexParameteri(type, GL_TEXTURE_MAG_FILTER, m_filteringMag);
-		glBindTexture(type, 0);
 	}
 }
 void Texture::setWrapping(GLint p_mode) {
 	m_wrappingMode = p_mode;
 	if (initialized) {
-		glBindTexture(type, glID->ID);
+		GLStateCache::Get().bindTexture(type, glID->ID);
 		glTexParameteri(type, GL_TEXTURE_WRAP_S, m_wrappingMode);
 		glTexParameteri(type, GL_TEXTURE_WRAP_T, m_wrappingMode);
-		glBindTexture(type, 0);
 	}
 }
 
@@ -57,7 +56,7 @@ void Texture::setType(GLenum p_type)
 void Texture::setChannels(GLenum p_channels)
 {
 	if (!initialized) glGenTextures(1, &glID->ID);
-	glBindTexture(type, glID->ID); // into the main texture buffer
+	GLStateCache::Get().bindTexture(type, glID->ID); // into the main texture buffer
 	channels = p_channels;
 	glTexImage2D( // actually put the image data into the texture buffer
 		type,
@@ -69,18 +68,18 @@ void Texture::setChannels(GLenum p_channels)
 		channels,
 		GL_UNSIGNED_BYTE,
 		nullptr);
-	glBindTexture(type, 0);
 }
 
-void Texture::fromByteData(uint32_t p_width, uint32_t p_height, unsigned char* p_data)
+void Texture::fromByteData(uint32_t p_width, uint32_t p_height, unsigned char* p_data, uint32_t p_rowLength)
 {
 	width = p_width;
 	height = p_height;
 	if (!initialized) glGenTextures(1, &glID->ID);
-	glBindTexture(type, glID->ID); // into the main texture buffer
+	GLStateCache::Get().bindTexture(type, glID->ID); // into the main texture buffer
 
 	// set the texture wrapping/filtering options (on the currently bound texture object)
 	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, p_rowLength);
 	glTexParameteri(type, GL_TEXTURE_WRAP_S, m_wrappingMode);
 	glTexParameteri(type, GL_TEXTURE_WRAP_T, m_wrappingMode);
 	glTexParameteri(type, GL_TEXTURE_MIN_FILTER, m_filteringMin);
@@ -96,7 +95,7 @@ void Texture::fromByteData(uint32_t p_width, uint32_t p_height, unsigned char* p
 		channels,
 		GL_UNSIGNED_BYTE,
 		p_data);
-	glBindTexture(type, 0);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
 	initialized = true;
 }
 
@@ -105,7 +104,7 @@ void Texture::fromVec4Data(uint32_t p_width, uint32_t p_height, glm::vec4* p_dat
 	width = p_width;
 	height = p_height;
 	if (!initialized) glGenTextures(1, &glID->ID);
-	glBindTexture(type, glID->ID); // into the main texture buffer
+	GLStateCache::Get().bindTexture(type, glID->ID); // into the main texture buffer
 
 	// set the texture wrapping/filtering options (on the currently bound texture object)
 	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
@@ -124,7 +123,6 @@ void Texture::fromVec4Data(uint32_t p_width, uint32_t p_height, glm::vec4* p_dat
 		channels,
 		GL_FLOAT,
 		p_data);
-	glBindTexture(type, 0);
 	initialized = true;
 }
 
@@ -133,10 +131,9 @@ void Texture::useMipmaps(int p_count)
 	if (!initialized) {
 		changeDimensions(0, 0);
 	}
-	glCheck(glBindTexture(type, glID->ID)); // into the main texture buffer
+	GLStateCache::Get().bindTexture(type, glID->ID); // into the main texture buffer
 	glCheck(glGenerateMipmap(type));
 	glCheck(glTexParameteri(type, GL_TEXTURE_MAX_LEVEL, p_count));
-	glCheck(glBindTexture(type, 0));
 
 }
 
@@ -148,7 +145,7 @@ void Texture::genMipMapsBytes(uint8_t p_level, uint32_t p_width, uint32_t p_heig
 	width = p_width;
 	height = p_height;
 	if (!initialized) glGenTextures(1, &glID->ID);
-	glBindTexture(type, glID->ID); // into the main texture buffer
+	GLStateCache::Get().bindTexture(type, glID->ID); // into the main texture buffer
 
 	// set the texture wrapping/filtering options (on the currently bound texture object)
 	glCheck(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
@@ -175,7 +172,6 @@ void Texture::genMipMapsBytes(uint8_t p_level, uint32_t p_width, uint32_t p_heig
 
 	initialized = true;
 
-	glBindTexture(type, 0);
 }
 void Texture::genMipMapsFloat(uint8_t p_level, uint32_t p_width, uint32_t p_height, float* p_data) {
 	if (channels != GL_RGBA) {
@@ -185,7 +181,7 @@ void Texture::genMipMapsFloat(uint8_t p_level, uint32_t p_width, uint32_t p_heig
 	width = p_width;
 	height = p_height;
 	if (!initialized) glGenTextures(1, &glID->ID);
-	glBindTexture(type, glID->ID); // into the main texture buffer
+	GLStateCache::Get().bindTexture(type, glID->ID); // into the main texture buffer
 
 	// set the texture wrapping/filtering options (on the currently bound texture object)
 	glCheck(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
@@ -209,7 +205,6 @@ void Texture::genMipMapsFloat(uint8_t p_level, uint32_t p_width, uint32_t p_heig
 
 	initialized = true;
 
-	glBindTexture(type, 0);
 }
 
 void Texture::changeDimensions(uint32_t p_width, uint32_t p_height)
@@ -226,7 +221,7 @@ void Texture::changeDimensions(uint32_t p_width, uint32_t p_height)
 		glCheck(glTexParameteri(type, GL_TEXTURE_MIN_FILTER, m_filteringMin));
 		glCheck(glTexParameteri(type, GL_TEXTURE_MAG_FILTER, m_filteringMag));
 	}
-	glCheck(glBindTexture(type, glID->ID)); // into the main texture buffer
+	GLStateCache::Get().bindTexture(type, glID->ID); // into the main texture buffer
 
 	glCheck(glTexImage2D( // actually put the image data into the texture buffer
 		type,
@@ -240,16 +235,14 @@ void Texture::changeDimensions(uint32_t p_width, uint32_t p_height)
 		NULL));
 
 	// WARNING:: very picky about if an image in in RGB format or RBGA format. Try to keep them all RGBA with a bit depth of 8
-	glBindTexture(type, 0);
 	initialized = true; // data is allocated, so we'll just say it's initialized even if the data is undefined. Solves a bug.
 }
 
 void Texture::subVec4Data(glm::vec4* p_data) {
 	CONDITIONAL_LOG(!initialized, "Texture not initialized, so data cannot be substituted.");
 	if (!initialized) return;
-	glBindTexture(type, glID->ID);
+	GLStateCache::Get().bindTexture(type, glID->ID);
 	glTexSubImage2D(type, 0, 0, 0, width, height, channels, GL_FLOAT, p_data);
-	glBindTexture(type, 0);
 }
 
 void Texture::remove() {
@@ -6,7 +6,7 @@
 const float fwrapUnsigned(float x, float r) {
 	float aR = std::fabs(r); // The wrapping point should always be positive or else weird things happen
 	// Piecewise fmod transformation function
-	return x < 0 ? (std::fmodf(x, aR) + r) : std::fmodf(x, aR);
+	return x < 0 ? (std::fmod(x, aR) + r) : std::fmod(x, aR);
 }
 // wraps float values to the range [-r, r] 
 const float fwrapSigned(float x, float r) {
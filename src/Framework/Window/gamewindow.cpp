@@ -1,4 +1,8 @@
 #include "Framework/Window/GameWindow.hpp"
+#include "util/FrameArena.hpp"
+#include "Framework/Graphics/Shader.hpp"
+#include "Framework/Graphics/GlStateCache.hpp"
+#include "Framework/Graphics/StreamBuffer.hpp"
 
 GameWindow::GameWindow() 
 	: m_window(NULL),
@@ -65,6 +69,7 @@ void GameWindow::create(const char* p_title, uint32_t p_w, uint32_t p_h, int p_f
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	glEnable(GL_DEPTH_TEST);
+	GLStateCache::Get().invalidate(); // fresh context, nothing we think is bound actually is
 	m_DrawBuffers[0] = GL_BACK_LEFT; // Back of double buffer
 	setViewport(0, 0, p_w, p_h);
 	//GameWindow::initGL();
@@ -101,6 +106,7 @@ void GameWindow::initGL() {
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	glEnable(GL_DEPTH_TEST);
+	GLStateCache::Get().invalidate(); // fresh context, nothing we think is bound actually is
 
 	// init inherited class's variables
 	m_DrawBuffers[0] = GL_BACK_LEFT; // Back of double buffer
@@ -120,6 +126,10 @@ void GameWindow::setVSync(bool p_enabled)
 void GameWindow::displayNewFrame()
 {
 	SDL_GL_SwapWindow(m_window); // Swap the back of the double buffer with the front.
+	FrameArena::endFrame(); // Everything allocated for the last frame is gone now.
+	Shader::endFrame();
+	GLStateCache::Get().endFrame();
+	StreamBuffer::endFrame();
 }
 void GameWindow::toggleFullscreen() {
 	static bool isFullscreen = false;
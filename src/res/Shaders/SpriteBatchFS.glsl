@@ -0,0 +1,11 @@
+#version 330 core
+layout(location = 0) out vec4 FragColor;
+in vec2 TexCoord;
+in float Opacity;
+
+uniform sampler2D imageTexture;
+void main()
+{
+    vec4 col = texture(imageTexture, TexCoord);
+    FragColor = col - vec4(0.f, 0.f, 0.f, Opacity);
+}
\ No newline at end of file
@@ -0,0 +1,18 @@
+#version 330 core
+layout(location = 0) in vec2 aCorner;
+// one per sprite, takes up locations 1 to 4
+layout(location = 1) in mat4 aTransform;
+layout(location = 5) in vec4 aUVRect;
+layout(location = 6) in float aOpacity;
+out vec2 TexCoord;
+out float Opacity;
+
+uniform mat4 transform;
+
+void main()
+{
+    gl_Position = transform * aTransform * vec4(aCorner, 0.0, 1.0);
+    // texture rows go top down
+    TexCoord = aUVRect.xy + vec2(aCorner.x, 1.0 - aCorner.y) * aUVRect.zw;
+    Opacity = aOpacity;
+}
\ No newline at end of file
@@ -0,0 +1,95 @@
+#pragma once
+#include <queue>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <optional>
+#include <stdint.h>
+
+// The ThreadPool and SharedQueue from before the work-stealing and allocation-free changes, as they were, so the
+// benchmarks have something to compare against. Only the names, the unused bits and m_stopping being atomic are different.
+// Its waitUntilIdle() could return early, so it's left out and the benchmarks count their tasks down instead.
+
+template<typename T>
+class BaselineSharedQueue {
+public:
+	void push(const T& p_value) {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_queue.push(p_value);
+		m_cv.notify_one();
+	}
+	auto pop() {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_cv.wait(lock, [&]() { return !m_queue.empty() || m_terminateWaiting; });
+		if (m_terminateWaiting) return T();
+		T out = m_queue.front();
+		m_queue.pop();
+		return out;
+	}
+	bool empty() {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		return m_queue.empty();
+	}
+	std::optional<T> tryPop() {
+		if (!empty()) {
+			std::unique_lock<std::mutex> lock(m_mutex);
+			T out = m_queue.front();
+			m_queue.pop();
+			return out;
+		}
+		return std::nullopt;
+	}
+	void forceAllThreadsToPop() {
+		m_terminateWaiting = true;
+		m_cv.notify_all();
+	}
+	void clear() {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		std::queue<T> empty;
+		m_queue.swap(empty);
+	}
+private:
+	std::mutex m_mutex;
+	std::queue<T> m_queue;
+	std::condition_variable m_cv;
+	std::atomic<bool> m_terminateWaiting = false;
+};
+
+class BaselinePool {
+public:
+	BaselinePool(uint16_t numThreads) {
+		for (uint16_t i = 0; i < numThreads; i++) {
+			m_workers.emplace_back([this] {
+				while (true) {
+					std::function<void()> task;
+					task = std::move(m_tasks.pop());
+					if (m_stopping) return;
+					task();
+				}
+			});
+		}
+	}
+	~BaselinePool() {
+		m_stopping = true;
+		m_tasks.clear();
+		m_tasks.forceAllThreadsToPop();
+		for (auto& worker : m_workers) worker.join();
+	}
+
+	template <typename F, typename... Args>
+	auto assign(F&& f, Args&&... args) -> std::future<typename std::invoke_result_t<F, Args...>> {
+		using return_type = typename std::invoke_result_t<F, Args...>;
+		auto task = std::make_shared<std::packaged_task<return_type()>>(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+		std::future<return_type> result = task->get_future();
+		m_tasks.push([task] {(*task)(); });
+		return result;
+	}
+private:
+	BaselineSharedQueue<std::function<void()>> m_tasks;
+	std::atomic<bool> m_stopping = false;
+	std::vector<std::thread> m_workers;
+};
@@ -0,0 +1,68 @@
+#pragma once
+#include <SDL.h>
+#include <GL/glew.h>
+#include <filesystem>
+#include <stdexcept>
+#include <stdio.h>
+#include "Framework/Graphics/DrawSurface.hpp"
+#include "Framework/Graphics/GlStateCache.hpp"
+#include "Framework/Graphics/StreamBuffer.hpp"
+#include "Framework/Graphics/Shader.hpp"
+#include "util/FrameArena.hpp"
+
+// A window that's never shown, with the same GL 4.6 core context GameWindow::initGL() makes, for the benchmarks that
+// need real GL. Draws go to its back buffer like they would to a GameWindow.
+// GenericShaders loads from ./src/Shaders, so this moves into the directory the program is in, where the Makefile
+// copies them. Pass it argv[0].
+class HiddenGLContext : public DrawSurface {
+public:
+	HiddenGLContext(const char* p_argv0, int p_width = 1280, int p_height = 720) {
+		std::filesystem::path dir = std::filesystem::path(p_argv0).parent_path();
+		if (!dir.empty()) std::filesystem::current_path(dir);
+
+		if (SDL_Init(SDL_INIT_VIDEO) != 0) fail("SDL_Init failed");
+		SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 6);
+		m_window = SDL_CreateWindow("bench", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, p_width, p_height, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+		if (!m_window) fail("Couldn't make a window");
+		m_context = SDL_GL_CreateContext(m_window);
+		if (!m_context) fail("Couldn't make a GL 4.6 context");
+		SDL_GL_MakeCurrent(m_window, m_context);
+		// timing the work, not the display
+		SDL_GL_SetSwapInterval(0);
+
+		glewExperimental = GL_TRUE;
+		if (glewInit() != GLEW_OK) fail("glewInit failed");
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		GLStateCache::Get().invalidate();
+		m_DrawBuffers[0] = GL_BACK_LEFT;
+		setViewport(0, 0, p_width, p_height);
+	}
+	HiddenGLContext(const HiddenGLContext& other) = delete;
+	HiddenGLContext& operator=(const HiddenGLContext& other) = delete;
+	~HiddenGLContext() {
+		SDL_GL_DeleteContext(m_context);
+		SDL_DestroyWindow(m_window);
+		SDL_Quit();
+	}
+
+	// Same per frame bookkeeping as GameWindow::displayNewFrame().
+	void displayNewFrame() {
+		SDL_GL_SwapWindow(m_window);
+		FrameArena::endFrame();
+		Shader::endFrame();
+		GLStateCache::Get().endFrame();
+		StreamBuffer::endFrame();
+	}
+private:
+	[[noreturn]] static void fail(const char* p_what) {
+		printf("%s: %s\n", p_what, SDL_GetError());
+		throw std::runtime_error(p_what);
+	}
+
+	SDL_Window* m_window = nullptr;
+	SDL_GLContext m_context = nullptr;
+};
@@ -0,0 +1,85 @@
+#pragma once
+#include <span>
+#include <stdint.h>
+#include <stddef.h>
+
+// A connected pair of stream sockets, one end for writing and one for reading, so the message frame programs can push
+// bytes through a real kernel socket and get them back in whatever sized pieces it feels like.
+// Windows has no socketpair(), so there it's a locked in-memory byte queue with the same interface instead.
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdexcept>
+
+class SocketPipe {
+public:
+	SocketPipe() {
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, m_fds) != 0) throw std::runtime_error("socketpair() failed");
+	}
+	SocketPipe(const SocketPipe& other) = delete;
+	SocketPipe& operator=(const SocketPipe& other) = delete;
+	~SocketPipe() {
+		closeWriter();
+		if (m_fds[1] >= 0) close(m_fds[1]);
+	}
+
+	void sendAll(std::span<const uint8_t> p_data) {
+		while (!p_data.empty()) {
+			ssize_t sent = write(m_fds[0], p_data.data(), p_data.size());
+			if (sent < 0) {
+				if (errno == EINTR) continue;
+				throw std::runtime_error("socket write failed");
+			}
+			p_data = p_data.subspan((size_t)sent);
+		}
+	}
+	// The reader sees the end of the stream once everything sent before this has been read.
+	void closeWriter() {
+		if (m_fds[0] >= 0) close(m_fds[0]);
+		m_fds[0] = -1;
+	}
+	// Blocks until there's something. Returns 0 once the writer is closed and everything's been read.
+	size_t receive(uint8_t* o_data, size_t p_max) {
+		while (true) {
+			ssize_t got = read(m_fds[1], o_data, p_max);
+			if (got >= 0) return (size_t)got;
+			if (errno != EINTR) throw std::runtime_error("socket read failed");
+		}
+	}
+private:
+	int m_fds[2] = { -1, -1 };
+};
+#else
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+
+class SocketPipe {
+public:
+	void sendAll(std::span<const uint8_t> p_data) {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_bytes.insert(m_bytes.end(), p_data.begin(), p_data.end());
+		m_cv.notify_one();
+	}
+	void closeWriter() {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_closed = true;
+		m_cv.notify_one();
+	}
+	size_t receive(uint8_t* o_data, size_t p_max) {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_cv.wait(lock, [&] { return !m_bytes.empty() || m_closed; });
+		size_t count = std::min(p_max, m_bytes.size());
+		std::copy(m_bytes.begin(), m_bytes.begin() + count, o_data);
+		m_bytes.erase(m_bytes.begin(), m_bytes.begin() + count);
+		return count;
+	}
+private:
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	std::deque<uint8_t> m_bytes;
+	bool m_closed = false;
+};
+#endif
@@ -0,0 +1,39 @@
+#pragma once
+#include <stdio.h>
+#include <stdint.h>
+#include <chrono>
+
+// Just enough to write the programs in this folder without pulling in a test framework.
+// Tests return the number of failed checks from main(), so a nonzero exit is a failure.
+
+inline int g_failedChecks = 0;
+
+#define CHECK(expr) do { \
+	if (!(expr)) { \
+		printf("FAILED: %s (%s:%d)\n", #expr, __FILE__, __LINE__); \
+		g_failedChecks++; \
+	} \
+} while (0)
+
+inline int finishTest(const char* p_name) {
+	if (g_failedChecks == 0) printf("%s: passed\n", p_name);
+	else printf("%s: %d checks failed\n", p_name, g_failedChecks);
+	return g_failedChecks;
+}
+
+// Seconds taken by one call of p_fn.
+template<typename F>
+double timeIt(F&& p_fn) {
+	auto start = std::chrono::steady_clock::now();
+	p_fn();
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Stops the compiler throwing away work whose result is never used. Only for plain values, like a checksum.
+// The sink lives at namespace scope, a function static that's only ever written trips -Wunused-but-set-variable.
+template<typename T>
+inline volatile T g_keepAliveSink{};
+template<typename T>
+void keepAlive(T p_value) {
+	g_keepAliveSink<T> = p_value;
+}
@@ -0,0 +1,74 @@
+// 3x3x3 box blur over an Array3D<float> under each layout, two ways:
+//   loops:   plain z/y/x loops reading all 27 neighbors through operator(), what existing code does
+//   walk:    forEachCell in memory order with forEachNeighbor, what the layouts are built for
+// Every variant has to come out with the same total, otherwise it says so.
+// Usage: bench_arraylayout [side length] [sweep count], 192 and 3 by default.
+#include "TestCommon.hpp"
+#include "util/Array3D.hpp"
+#include <stdlib.h>
+
+template<typename Layout>
+static void run(const char* p_name, int p_side, int p_sweeps, double& io_expected) {
+	Array3D<float, Layout> src(p_side, p_side, p_side);
+	Array3D<float, Layout> dst(p_side, p_side, p_side);
+	for (int z = 0; z < p_side; z++)
+		for (int y = 0; y < p_side; y++)
+			for (int x = 0; x < p_side; x++) src(x, y, z) = float((x * 7 + y * 13 + z * 29) % 64);
+
+	auto total = [&] {
+		double sum = 0;
+		for (float value : dst.getData()) sum += value;
+		return sum;
+	};
+	size_t cells = size_t(p_side) * p_side * p_side;
+
+	double loops = timeIt([&] {
+		for (int sweep = 0; sweep < p_sweeps; sweep++) {
+			for (int z = 0; z < p_side; z++)
+				for (int y = 0; y < p_side; y++)
+					for (int x = 0; x < p_side; x++) {
+						float sum = 0;
+						for (int dz = -1; dz <= 1; dz++) for (int dy = -1; dy <= 1; dy++) for (int dx = -1; dx <= 1; dx++) {
+							if (src.bounded(x + dx, y + dy, z + dz)) sum += src(x + dx, y + dy, z + dz);
+						}
+						dst(x, y, z) = sum * (1.f / 27.f);
+					}
+		}
+	});
+	double loopsTotal = total();
+
+	double walk = timeIt([&] {
+		for (int sweep = 0; sweep < p_sweeps; sweep++) {
+			src.forEachCell([&](size_t x, size_t y, size_t z, float&) {
+				float sum = 0;
+				src.forEachNeighbor((int)x, (int)y, (int)z, [&](float& p_value, int, int, int) { sum += p_value; });
+				dst(x, y, z) = sum * (1.f / 27.f);
+			});
+		}
+	});
+	double walkTotal = total();
+
+	if (io_expected < 0) io_expected = loopsTotal;
+	if (loopsTotal != io_expected || walkTotal != io_expected) printf("%s came out different!\n", p_name);
+	printf("%-12s loops %6.2f ns/cell   walk %6.2f ns/cell   %6.1f MB\n", p_name,
+		loops * 1e9 / (cells * p_sweeps), walk * 1e9 / (cells * p_sweeps), src.getData().size() * sizeof(float) / 1048576.0);
+}
+
+int main(int argc, char** argv) {
+	int side = argc > 1 ? atoi(argv[1]) : 192;
+	int sweeps = argc > 2 ? atoi(argv[2]) : 3;
+#ifdef DERG_MORTON_BMI2
+	const char* morton = "pdep/pext";
+#else
+	const char* morton = "portable";
+#endif
+	printf("%d^3 floats, %d sweeps, %s Morton\n", side, sweeps, morton);
+
+	double expected = -1;
+	run<RowMajorLayout>("row major", side, sweeps, expected);
+	run<TiledLayout<4>>("tiled 4", side, sweeps, expected);
+	run<TiledLayout<8>>("tiled 8", side, sweeps, expected);
+	run<MortonLayout<3>>("morton 8", side, sweeps, expected);
+	run<MortonLayout<5>>("morton 32", side, sweeps, expected);
+	return 0;
+}
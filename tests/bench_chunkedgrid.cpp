@@ -0,0 +1,90 @@
+// Memory use and random read cost of ChunkedGrid against Array3D, on a world that's mostly air:
+// a few layers of ground with some columns sticking up out of it. ChunkedGrid runs with both 32^3 and 16^3 chunks.
+// Usage: bench_chunkedgrid [width height depth] [read count], 1024 1024 64 and 4M reads by default.
+#include "TestCommon.hpp"
+#include "util/Array3D.hpp"
+#include "util/ChunkedGrid.hpp"
+#include <vector>
+#include <stdlib.h>
+
+struct Rng {
+	uint64_t state;
+	uint64_t next() {
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		return state;
+	}
+};
+
+// 0 is air
+static uint8_t terrain(uint32_t x, uint32_t y, uint32_t z) {
+	uint32_t ground = 2 + ((x / 16 + y / 16) % 3);
+	if (z < ground) return 1;
+	// a column every so often
+	if (x % 37 == 0 && y % 41 == 0 && z < ground + 12) return 2;
+	return 0;
+}
+
+template<typename Grid, typename Write>
+static double build(Grid& p_grid, uint32_t p_width, uint32_t p_height, uint32_t p_depth, Write p_write) {
+	return timeIt([&] {
+		for (uint32_t z = 0; z < p_depth; z++)
+			for (uint32_t y = 0; y < p_height; y++)
+				for (uint32_t x = 0; x < p_width; x++) {
+					uint8_t value = terrain(x, y, z);
+					if (value) p_write(p_grid, x, y, z, value);
+				}
+	});
+}
+
+template<uint32_t ChunkBits>
+static uint64_t runChunked(uint32_t p_width, uint32_t p_height, uint32_t p_depth, const std::vector<uint32_t>& p_coords) {
+	ChunkedGrid<uint8_t, ChunkBits> chunked(p_width, p_height, p_depth);
+	double buildTime = build(chunked, p_width, p_height, p_depth, [](auto& g, uint32_t x, uint32_t y, uint32_t z, uint8_t v) { g.set(x, y, z, v); });
+	size_t freed = chunked.collapseUniform();
+	size_t reads = p_coords.size() / 3;
+	uint64_t sum = 0;
+	double readTime = timeIt([&] {
+		for (size_t i = 0; i < reads; i++) sum += chunked.get(p_coords[i * 3], p_coords[i * 3 + 1], p_coords[i * 3 + 2]);
+	});
+	printf("ChunkedGrid %-2u %7.1f MB   build %6.1f ms   %6.2f ns/read   %zu of %zu chunks allocated (%zu collapsed)\n",
+		1u << ChunkBits, chunked.memoryUsage() / 1048576.0, buildTime * 1e3, readTime * 1e9 / reads,
+		chunked.allocatedChunkCount(), chunked.chunkCount(), freed);
+	return sum;
+}
+
+int main(int argc, char** argv) {
+	uint32_t width = 1024, height = 1024, depth = 64;
+	if (argc > 3) {
+		width = (uint32_t)atoi(argv[1]);
+		height = (uint32_t)atoi(argv[2]);
+		depth = (uint32_t)atoi(argv[3]);
+	}
+	size_t reads = argc > 4 ? strtoull(argv[4], nullptr, 10) : 4000000;
+	printf("%ux%ux%u world, %zu random reads\n", width, height, depth, reads);
+
+	std::vector<uint32_t> coords(reads * 3);
+	Rng rng{ 0x2545F4914F6CDD1Dull };
+	for (size_t i = 0; i < reads; i++) {
+		coords[i * 3 + 0] = (uint32_t)(rng.next() % width);
+		coords[i * 3 + 1] = (uint32_t)(rng.next() % height);
+		coords[i * 3 + 2] = (uint32_t)(rng.next() % depth);
+	}
+
+	uint64_t denseSum = 0;
+	{
+		Array3D<uint8_t> dense(width, height, depth);
+		double buildTime = build(dense, width, height, depth, [](auto& g, uint32_t x, uint32_t y, uint32_t z, uint8_t v) { g((size_t)x, (size_t)y, (size_t)z) = v; });
+		double readTime = timeIt([&] {
+			for (size_t i = 0; i < reads; i++) denseSum += dense((size_t)coords[i * 3], (size_t)coords[i * 3 + 1], (size_t)coords[i * 3 + 2]);
+		});
+		printf("Array3D        %7.1f MB   build %6.1f ms   %6.2f ns/read\n", dense.getData().size() / 1048576.0,
+			buildTime * 1e3, readTime * 1e9 / reads);
+	}
+	uint64_t chunked32Sum = runChunked<5>(width, height, depth, coords);
+	uint64_t chunked16Sum = runChunked<4>(width, height, depth, coords);
+	if (denseSum != chunked32Sum || denseSum != chunked16Sum) printf("the grids disagree!\n");
+	keepAlive(denseSum);
+	return 0;
+}
@@ -0,0 +1,77 @@
+// 90% reads and 10% writes on random keys, SharedMap against ConcurrentMap, at 1, 4 and 16 threads.
+// Half the writes insert and half erase, so the map stays about as full as it started. SharedMap's reads use contains(),
+// since find() hands back an iterator that isn't safe to touch once its lock is gone.
+// Usage: bench_concurrentmap [total op count], 4M by default.
+#include "TestCommon.hpp"
+#include "util/SharedMap.hpp"
+#include "util/ConcurrentMap.hpp"
+#include <thread>
+#include <vector>
+#include <stdlib.h>
+
+static constexpr uint64_t KEY_COUNT = 1 << 16;
+
+struct Rng {
+	uint64_t state;
+	uint64_t next() {
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		return state;
+	}
+};
+
+struct SharedMapOps {
+	SharedMap<uint64_t, uint64_t, std::hash<uint64_t>> map;
+	bool read(uint64_t p_key) { return map.contains(p_key); }
+	void insert(uint64_t p_key) { map.insert({ p_key, p_key }); }
+	void erase(uint64_t p_key) { map.erase(p_key); }
+};
+
+struct ConcurrentMapOps {
+	ConcurrentMap<uint64_t, uint64_t> map;
+	bool read(uint64_t p_key) { return map.find(p_key).has_value(); }
+	void insert(uint64_t p_key) { map.insert(p_key, p_key); }
+	void erase(uint64_t p_key) { map.erase(p_key); }
+};
+
+template<typename Ops>
+static void run(const char* p_name, unsigned p_threads, size_t p_ops) {
+	Ops ops;
+	// every other key to start with
+	for (uint64_t key = 0; key < KEY_COUNT; key += 2) ops.insert(key);
+
+	size_t perThread = p_ops / p_threads;
+	std::atomic<size_t> hits{ 0 };
+	double seconds = timeIt([&] {
+		std::vector<std::thread> threads;
+		for (unsigned t = 0; t < p_threads; t++) {
+			threads.emplace_back([&, t] {
+				Rng rng{ 0x9E3779B97F4A7C15ull * (t + 1) };
+				size_t localHits = 0;
+				for (size_t i = 0; i < perThread; i++) {
+					uint64_t random = rng.next();
+					uint64_t key = (random >> 8) & (KEY_COUNT - 1);
+					uint64_t roll = random % 20;
+					if (roll >= 2) localHits += ops.read(key);
+					else if (roll == 1) ops.insert(key);
+					else ops.erase(key);
+				}
+				hits += localHits;
+			});
+		}
+		for (auto& thread : threads) thread.join();
+	});
+	keepAlive(hits.load());
+	printf("%-14s %2u threads   %7.2f M ops/s\n", p_name, p_threads, perThread * p_threads / seconds / 1e6);
+}
+
+int main(int argc, char** argv) {
+	size_t ops = argc > 1 ? strtoull(argv[1], nullptr, 10) : 4000000;
+	printf("%zu ops, 90%% reads\n", ops);
+	for (unsigned threads : { 1, 4, 16 }) {
+		run<SharedMapOps>("SharedMap", threads, ops);
+		run<ConcurrentMapOps>("ConcurrentMap", threads, ops);
+	}
+	return 0;
+}
@@ -0,0 +1,76 @@
+// Instance upload cost per frame for a big instanced Mesh, with only part of it edited each frame:
+//   dirty:  subCurrentInstanceData() sending the dirty ranges, the default
+//   full:   setFullUploadRatio(0), so any edit sends the whole buffer like it used to
+// The instances are a mat4 each, 64 bytes. "frame" is the edits, the upload and a glFinish() so the copy is counted.
+// Past DirtyRanges::MAX_RANGES scattered edits the ranges collapse into one, so those rows end up close to full.
+// Needs a GL 4.6 capable driver, see HiddenGLContext.
+// Usage: bench_meshupload [instance count] [frame count], 100000 and 200 by default.
+#include "TestCommon.hpp"
+#include "HiddenGLContext.hpp"
+#include "Framework/Graphics/Mesh.hpp"
+#include "util/ext/glm/glm.hpp"
+#include <random>
+#include <vector>
+#include <stdlib.h>
+
+using InstanceMesh = Mesh<GLfloat, glm::mat4>;
+
+static void makeMesh(InstanceMesh& o_mesh, size_t p_count) {
+	o_mesh.setStreamType(GL_DYNAMIC_DRAW);
+	o_mesh.addFloatAttrib(2);
+	for (int column = 0; column < 4; column++) o_mesh.addFloatAttrib(4, true);
+	o_mesh.pushVertices({ 0.f, 0.f, 1.f, 0.f, 0.f, 1.f });
+	for (size_t i = 0; i < p_count; i++) o_mesh.pushInstance(glm::mat4(float(i)));
+	o_mesh.pushVBOToGPU();
+	o_mesh.pushInstancesToGPU();
+}
+
+// p_edit(frame) makes that frame's changes through setInstance()/editInstances()
+template<typename Edit>
+static void run(const char* p_name, HiddenGLContext& p_context, size_t p_count, int p_frames, Edit p_edit) {
+	for (float ratio : { 0.5f, 0.f }) {
+		InstanceMesh mesh;
+		makeMesh(mesh, p_count);
+		mesh.setFullUploadRatio(ratio);
+		glFinish();
+		mesh.resetUploadStats();
+		double seconds = 0;
+		for (int f = 0; f < p_frames; f++) {
+			seconds += timeIt([&] {
+				p_edit(mesh, f);
+				mesh.subCurrentInstanceData();
+				glFinish();
+			});
+			p_context.displayNewFrame();
+		}
+		InstanceMesh::UploadStats stats = mesh.getUploadStats();
+		printf("%-16s %-5s %8.3f ms/frame   %9.1f KB/frame   %6.1f calls/frame\n", p_name, ratio > 0.f ? "dirty" : "full",
+			seconds * 1e3 / p_frames, stats.bytesUploaded / 1024.0 / p_frames, double(stats.uploadCalls) / p_frames);
+	}
+}
+
+int main(int argc, char** argv) {
+	size_t count = argc > 1 ? strtoull(argv[1], nullptr, 10) : 100000;
+	int frames = argc > 2 ? atoi(argv[2]) : 200;
+	HiddenGLContext context(argv[0]);
+	printf("%zu instances of %zu bytes, %d frames\n", count, sizeof(glm::mat4), frames);
+
+	for (size_t scattered : { size_t(1), size_t(32), size_t(1024) }) {
+		char name[32];
+		snprintf(name, sizeof(name), "%zu scattered", scattered);
+		run(name, context, count, frames, [&](InstanceMesh& p_mesh, int p_frame) {
+			// seeded by the frame, so dirty and full edit the same spots
+			std::mt19937 rng(p_frame);
+			for (size_t k = 0; k < scattered; k++) p_mesh.setInstance(rng() % count, glm::mat4(float(p_frame)));
+		});
+	}
+	size_t block = std::min<size_t>(count, 1000);
+	run("block of 1000", context, count, frames, [&](InstanceMesh& p_mesh, int p_frame) {
+		size_t first = size_t(p_frame) * block % (count - block + 1);
+		for (glm::mat4& instance : p_mesh.editInstances(first, block)) instance[3][0] += 1.f;
+	});
+	run("everything", context, count, frames, [&](InstanceMesh& p_mesh, int) {
+		for (glm::mat4& instance : p_mesh.editInstances(0, count)) instance[3][0] += 1.f;
+	});
+	return 0;
+}
@@ -0,0 +1,120 @@
+// Messages per second through a socketpair, sender thread to receiver, three ways:
+//   per message:  the old way, a write for each header and body, read back into a fresh Message each
+//   frames:       FrameEncoder batches of 256 messages, FrameDecoder views on the other end
+//   compressed:   same, with FastCompress on every frame
+// The messages look like replication traffic: an entity id, a position, and a small run of mostly repeating state.
+// Usage: bench_messageframe [message count], 1M by default.
+#include "TestCommon.hpp"
+#include "SocketPipe.hpp"
+#include "util/MessageFrame.hpp"
+#include <thread>
+#include <vector>
+#include <stdlib.h>
+
+enum class BenchMsg : uint32_t {
+	EntityUpdate
+};
+
+static constexpr size_t FRAME_MESSAGES = 256;
+
+static net::Message<BenchMsg> makeMessage(uint64_t p_seq) {
+	net::Message<BenchMsg> msg;
+	msg.header.ID = BenchMsg::EntityUpdate;
+	net::MessageWriter<BenchMsg> writer(msg, 64);
+	writer.writeVarint(p_seq % 5000);
+	float position[3] = { float(p_seq % 97), 12.5f, float(p_seq % 31) };
+	writer.write(position);
+	uint8_t flags[24] = {};
+	flags[p_seq % 24] = 1;
+	writer.writeArray(std::span<const uint8_t>(flags));
+	return msg;
+}
+
+// what the receiver does with each message, so decoding can't be skipped
+static uint64_t consume(net::MessageReader p_reader) {
+	uint64_t id = p_reader.readVarint();
+	float position[3];
+	p_reader.read(position);
+	return id + (uint64_t)position[0];
+}
+
+static void report(const char* p_name, uint64_t p_count, double p_seconds, uint64_t p_wireBytes) {
+	printf("%-14s %7.2f M messages/s   %7.1f MB/s on the wire   %5.1f bytes/message\n", p_name,
+		p_count / p_seconds / 1e6, p_wireBytes / p_seconds / 1048576.0, double(p_wireBytes) / p_count);
+}
+
+static void perMessage(uint64_t p_count) {
+	SocketPipe pipe;
+	uint64_t wireBytes = 0, sum = 0;
+	double seconds = timeIt([&] {
+		std::thread sender([&] {
+			for (uint64_t seq = 0; seq < p_count; seq++) {
+				net::Message<BenchMsg> msg = makeMessage(seq);
+				pipe.sendAll({ (const uint8_t*)&msg.header, sizeof(msg.header) });
+				pipe.sendAll(msg.body);
+				wireBytes += msg.size();
+			}
+			pipe.closeWriter();
+		});
+		// read exactly a header, then exactly its body
+		auto readExactly = [&](uint8_t* o_data, size_t p_bytes) {
+			while (p_bytes > 0) {
+				size_t got = pipe.receive(o_data, p_bytes);
+				if (got == 0) return false;
+				o_data += got;
+				p_bytes -= got;
+			}
+			return true;
+		};
+		while (true) {
+			net::Message<BenchMsg> msg;
+			if (!readExactly((uint8_t*)&msg.header, sizeof(msg.header))) break;
+			msg.body.resize(msg.header.size - sizeof(msg.header));
+			readExactly(msg.body.data(), msg.body.size());
+			sum += consume(net::MessageReader(msg));
+		}
+		sender.join();
+	});
+	keepAlive(sum);
+	report("per message", p_count, seconds, wireBytes);
+}
+
+static void framed(const char* p_name, uint64_t p_count, size_t p_compressAbove) {
+	SocketPipe pipe;
+	uint64_t wireBytes = 0, sum = 0, received = 0;
+	double seconds = timeIt([&] {
+		std::thread sender([&] {
+			net::FrameEncoder<BenchMsg> encoder(p_compressAbove);
+			for (uint64_t seq = 0; seq < p_count;) {
+				for (size_t i = 0; i < FRAME_MESSAGES && seq < p_count; i++) encoder.add(makeMessage(seq++));
+				std::span<const uint8_t> frame = encoder.finish();
+				pipe.sendAll(frame);
+				wireBytes += frame.size();
+			}
+			pipe.closeWriter();
+		});
+		net::FrameDecoder<BenchMsg> decoder;
+		net::MessageView<BenchMsg> view;
+		std::vector<uint8_t> chunk(64 * 1024);
+		while (size_t got = pipe.receive(chunk.data(), chunk.size())) {
+			decoder.feed({ chunk.data(), got });
+			while (decoder.next(view)) {
+				sum += consume(view.reader());
+				received++;
+			}
+		}
+		sender.join();
+	});
+	if (received != p_count) printf("%s lost messages!\n", p_name);
+	keepAlive(sum);
+	report(p_name, p_count, seconds, wireBytes);
+}
+
+int main(int argc, char** argv) {
+	uint64_t count = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1000000;
+	printf("%llu messages of about %zu bytes\n", (unsigned long long)count, makeMessage(0).size());
+	perMessage(count);
+	framed("frames", count, net::FrameEncoder<BenchMsg>::NO_COMPRESSION);
+	framed("compressed", count, 0);
+	return 0;
+}
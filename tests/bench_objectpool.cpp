@@ -0,0 +1,99 @@
+// Small object churn on 8 threads, new/delete against ObjectPool.
+//   local:    each thread keeps a window of live objects and keeps replacing random ones
+//   handoff:  each round every thread fills a batch, then frees the batch its neighbor made, so blocks move between threads
+// Usage: bench_objectpool [ops per thread], 2M by default.
+#include "TestCommon.hpp"
+#include "util/ObjectPool.hpp"
+#include <thread>
+#include <vector>
+#include <barrier>
+#include <stdlib.h>
+
+static constexpr unsigned THREADS = 8;
+static constexpr size_t WINDOW = 256;
+static constexpr size_t BATCH = 1024;
+
+// about the size of a Uniform or a task closure
+struct Thing {
+	uint64_t payload[6];
+	Thing(uint64_t p_seed) {
+		for (uint64_t& value : payload) value = p_seed++;
+	}
+};
+
+struct HeapAlloc {
+	Thing* make(uint64_t p_seed) { return new Thing(p_seed); }
+	void free(Thing* p_thing) { delete p_thing; }
+};
+
+struct PoolAlloc {
+	ObjectPool<Thing> pool;
+	Thing* make(uint64_t p_seed) { return pool.create(p_seed); }
+	void free(Thing* p_thing) { pool.destroy(p_thing); }
+};
+
+template<typename Alloc>
+static double localChurn(Alloc& p_alloc, size_t p_ops) {
+	return timeIt([&] {
+		std::vector<std::thread> threads;
+		for (unsigned t = 0; t < THREADS; t++) {
+			threads.emplace_back([&, t] {
+				Thing* window[WINDOW];
+				for (size_t i = 0; i < WINDOW; i++) window[i] = p_alloc.make(i);
+				uint64_t rng = 0x9E3779B97F4A7C15ull * (t + 1);
+				for (size_t i = 0; i < p_ops; i++) {
+					rng ^= rng << 13;
+					rng ^= rng >> 7;
+					rng ^= rng << 17;
+					Thing*& slot = window[rng % WINDOW];
+					p_alloc.free(slot);
+					slot = p_alloc.make(i);
+				}
+				for (Thing* thing : window) p_alloc.free(thing);
+			});
+		}
+		for (auto& thread : threads) thread.join();
+	});
+}
+
+template<typename Alloc>
+static double handoff(Alloc& p_alloc, size_t p_ops) {
+	std::vector<std::vector<Thing*>> batches(THREADS, std::vector<Thing*>(BATCH));
+	std::barrier sync(THREADS);
+	size_t rounds = std::max<size_t>(p_ops / BATCH, 1);
+	return timeIt([&] {
+		std::vector<std::thread> threads;
+		for (unsigned t = 0; t < THREADS; t++) {
+			threads.emplace_back([&, t] {
+				for (size_t round = 0; round < rounds; round++) {
+					for (size_t i = 0; i < BATCH; i++) batches[t][i] = p_alloc.make(i);
+					sync.arrive_and_wait();
+					for (Thing* thing : batches[(t + 1) % THREADS]) p_alloc.free(thing);
+					sync.arrive_and_wait();
+				}
+			});
+		}
+		for (auto& thread : threads) thread.join();
+	});
+}
+
+int main(int argc, char** argv) {
+	size_t ops = argc > 1 ? strtoull(argv[1], nullptr, 10) : 2000000;
+	// wall time over every thread's ops put together
+	size_t totalOps = ops * THREADS;
+	size_t handoffOps = std::max<size_t>(ops / BATCH, 1) * BATCH * THREADS;
+	printf("%u threads, %zu ops per thread, %zu byte objects\n", THREADS, ops, sizeof(Thing));
+
+	HeapAlloc heap;
+	// a fresh pool for each pattern, so their depot traffic can be told apart
+	PoolAlloc localPool, handoffPool;
+	double heapLocal = localChurn(heap, ops);
+	double poolLocal = localChurn(localPool, ops);
+	double heapHandoff = handoff(heap, ops);
+	double poolHandoff = handoff(handoffPool, ops);
+	printf("new/delete    local %6.1f ns/op   handoff %6.1f ns/op\n", heapLocal * 1e9 / totalOps, heapHandoff * 1e9 / handoffOps);
+	printf("ObjectPool    local %6.1f ns/op   handoff %6.1f ns/op\n", poolLocal * 1e9 / totalOps, poolHandoff * 1e9 / handoffOps);
+	printf("depot transfers: local %llu, handoff %llu\n", (unsigned long long)localPool.pool.blocks().depotTransfers(),
+		(unsigned long long)handoffPool.pool.blocks().depotTransfers());
+	return 0;
+}
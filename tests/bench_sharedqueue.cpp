@@ -0,0 +1,78 @@
+// Queue throughput at 1, 4 and 16 producer/consumer pairs, for the old SharedQueue and both backends of the current one.
+// Every producer pushes the same number of ints and every consumer pops that many, so nobody has to be told to stop.
+// The batched runs move 32 at a time with pushN/popN.
+// Usage: bench_sharedqueue [total element count], 2M by default.
+#include "TestCommon.hpp"
+#include "BaselinePool.hpp"
+#include "util/SharedQueue.hpp"
+#include <stdlib.h>
+
+static constexpr size_t BATCH = 32;
+
+template<bool Batched, typename Queue>
+static void producer(Queue& p_queue, size_t p_count) {
+	if constexpr (!Batched) {
+		for (size_t i = 0; i < p_count; i++) p_queue.push((int)i);
+	}
+	else {
+		int batch[BATCH];
+		for (size_t i = 0; i < p_count; i += BATCH) {
+			size_t n = std::min(BATCH, p_count - i);
+			for (size_t j = 0; j < n; j++) batch[j] = (int)(i + j);
+			p_queue.pushN(batch, batch + n);
+		}
+	}
+}
+
+template<bool Batched, typename Queue>
+static int64_t consumer(Queue& p_queue, size_t p_count) {
+	int64_t sum = 0;
+	if constexpr (!Batched) {
+		for (size_t i = 0; i < p_count; i++) sum += p_queue.pop();
+	}
+	else {
+		int batch[BATCH];
+		for (size_t got = 0; got < p_count;) {
+			size_t n = p_queue.popN(batch, std::min(BATCH, p_count - got));
+			for (size_t j = 0; j < n; j++) sum += batch[j];
+			got += n;
+		}
+	}
+	return sum;
+}
+
+template<typename Queue, bool Batched = false>
+static void run(const char* p_name, size_t p_pairs, size_t p_total) {
+	Queue queue;
+	size_t perThread = p_total / p_pairs;
+	std::atomic<int64_t> sum{ 0 };
+	double seconds = timeIt([&] {
+		std::vector<std::thread> threads;
+		for (size_t i = 0; i < p_pairs; i++) {
+			threads.emplace_back([&] { producer<Batched>(queue, perThread); });
+			threads.emplace_back([&] { sum += consumer<Batched>(queue, perThread); });
+		}
+		for (auto& thread : threads) thread.join();
+	});
+	int64_t expected = (int64_t)p_pairs * (int64_t)perThread * ((int64_t)perThread - 1) / 2;
+	if (sum != expected) printf("%s lost elements!\n", p_name);
+	char shape[16];
+	snprintf(shape, sizeof(shape), "%zuP%zuC", p_pairs, p_pairs);
+	printf("%-24s %-7s %7.2f M elements/s\n", p_name, shape, p_pairs * perThread / seconds / 1e6);
+}
+
+int main(int argc, char** argv) {
+	size_t total = argc > 1 ? strtoull(argv[1], nullptr, 10) : 2000000;
+	printf("%zu elements\n", total);
+
+	using Locked = SharedQueue<int, SharedQueueBackend::LOCKED>;
+	using Ring = SharedQueue<int, SharedQueueBackend::LOCK_FREE_RING>;
+	for (size_t pairs : { 1, 4, 16 }) {
+		run<BaselineSharedQueue<int>>("old queue", pairs, total);
+		run<Locked>("locked", pairs, total);
+		run<Ring>("lock-free ring", pairs, total);
+		run<Locked, true>("locked, batched", pairs, total);
+		run<Ring, true>("lock-free ring, batched", pairs, total);
+	}
+	return 0;
+}
@@ -0,0 +1,54 @@
+// Read throughput of SnapshotMap::find against SharedMap::find at 1 to 32 threads, on a table that's filled once up front,
+// like a resource registry after loading. Nothing writes during the timed part, so SharedMap's iterators stay valid.
+// Usage: bench_snapshotmap [reads per thread], 1M by default.
+#include "TestCommon.hpp"
+#include "util/SharedMap.hpp"
+#include "util/SnapshotContainer.hpp"
+#include <thread>
+#include <vector>
+#include <stdlib.h>
+
+static constexpr uint64_t KEY_COUNT = 4096;
+
+template<typename Lookup>
+static void run(const char* p_name, unsigned p_threads, size_t p_reads, Lookup p_lookup) {
+	std::atomic<uint64_t> total{ 0 };
+	double seconds = timeIt([&] {
+		std::vector<std::thread> threads;
+		for (unsigned t = 0; t < p_threads; t++) {
+			threads.emplace_back([&, t] {
+				uint64_t sum = 0;
+				// misses on every other lookup, the table only has even keys
+				for (size_t i = 0; i < p_reads; i++) sum += p_lookup((i * 7 + t) & (2 * KEY_COUNT - 1));
+				total += sum;
+			});
+		}
+		for (auto& thread : threads) thread.join();
+	});
+	keepAlive(total.load());
+	printf("%-12s %2u threads   %8.2f M reads/s\n", p_name, p_threads, p_reads * p_threads / seconds / 1e6);
+}
+
+int main(int argc, char** argv) {
+	size_t reads = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1000000;
+	printf("%zu reads per thread\n", reads);
+
+	SharedMap<uint64_t, uint64_t, std::hash<uint64_t>> shared;
+	SnapshotMap<uint64_t, uint64_t> snapshot;
+	snapshot.update([](auto& p_map) {
+		for (uint64_t key = 0; key < 2 * KEY_COUNT; key += 2) p_map.emplace(key, key);
+	});
+	for (uint64_t key = 0; key < 2 * KEY_COUNT; key += 2) shared.insert({ key, key });
+	auto sharedEnd = shared.end();
+
+	for (unsigned threads : { 1, 2, 4, 8, 16, 32 }) {
+		run("SharedMap", threads, reads, [&](uint64_t p_key) -> uint64_t {
+			auto itr = shared.find(p_key);
+			return itr == sharedEnd ? 0 : itr->second;
+		});
+		run("SnapshotMap", threads, reads, [&](uint64_t p_key) -> uint64_t {
+			return snapshot.find(p_key).value_or(0);
+		});
+	}
+	return 0;
+}
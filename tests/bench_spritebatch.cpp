@@ -0,0 +1,90 @@
+// Frame time for a lot of moving sprites spread over a few textures: one Sprite::draw each, against SpriteBatch on
+// one thread and SpriteBatch building its instances across a thread pool.
+// "cpu" is how long the draw calls took to return, "frame" is that plus glFinish(), so it includes the GPU.
+// Needs a GL 4.6 capable driver, see HiddenGLContext.
+// Usage: bench_spritebatch [sprite count] [frame count], 20000 and 200 by default.
+#include "TestCommon.hpp"
+#include "HiddenGLContext.hpp"
+#include "Framework/Graphics/Sprite.hpp"
+#include "Framework/Graphics/SpriteBatch.hpp"
+#include "util/Threadpool.hpp"
+#include "util/ext/glm/gtc/matrix_transform.hpp"
+#include <vector>
+#include <memory>
+#include <stdlib.h>
+
+static constexpr int TEXTURE_COUNT = 4;
+
+struct Scene {
+	std::vector<std::unique_ptr<Sprite>> sprites;
+	std::vector<Sprite*> pointers;
+	std::vector<Texture> textures;
+	glm::mat4 projection;
+	DrawStates states;
+
+	Scene(size_t p_count, HiddenGLContext& p_context) {
+		for (int t = 0; t < TEXTURE_COUNT; t++) {
+			glm::vec4 pixels[16 * 16];
+			for (glm::vec4& pixel : pixels) pixel = glm::vec4(t / float(TEXTURE_COUNT), 0.5f, 1.f, 1.f);
+			textures.emplace_back(16, 16, pixels);
+		}
+		for (size_t i = 0; i < p_count; i++) {
+			auto sprite = std::make_unique<Sprite>(glm::vec3(float(i % 1280), float(i / 1280 * 4 % 720), 0.f), Rect(0.f, 0.f, 8.f, 8.f));
+			sprite->attachTexture(textures[i % TEXTURE_COUNT]);
+			pointers.push_back(sprite.get());
+			sprites.push_back(std::move(sprite));
+		}
+		projection = glm::ortho(0.f, p_context.getViewportWidth(), 0.f, p_context.getViewportHeight());
+		states.setTransform(projection);
+	}
+	// everything moves every frame, so every transform gets rebuilt
+	void animate(int p_frame) {
+		for (size_t i = 0; i < sprites.size(); i++) {
+			sprites[i]->setRotation(float(p_frame + i) * 0.01f);
+		}
+	}
+};
+
+template<typename Draw>
+static void run(const char* p_name, HiddenGLContext& p_context, Scene& p_scene, int p_frames, Draw p_draw) {
+	double cpu = 0, frame = 0;
+	size_t drawCalls = 0;
+	for (int f = 0; f < p_frames; f++) {
+		p_scene.animate(f);
+		p_context.clear();
+		frame += timeIt([&] {
+			cpu += timeIt([&] { drawCalls = p_draw(); });
+			glFinish();
+		});
+		p_context.displayNewFrame();
+	}
+	printf("%-18s cpu %7.2f ms   frame %7.2f ms   %6zu draw calls\n", p_name, cpu * 1e3 / p_frames, frame * 1e3 / p_frames, drawCalls);
+}
+
+int main(int argc, char** argv) {
+	size_t count = argc > 1 ? strtoull(argv[1], nullptr, 10) : 20000;
+	int frames = argc > 2 ? atoi(argv[2]) : 200;
+	HiddenGLContext context(argv[0]);
+	Scene scene(count, context);
+	printf("%zu sprites over %d textures, %d frames\n", count, TEXTURE_COUNT, frames);
+
+	run("Sprite::draw", context, scene, frames, [&] {
+		for (Sprite* sprite : scene.pointers) sprite->draw(context, scene.states);
+		return scene.pointers.size();
+	});
+
+	SpriteBatch batch;
+	run("SpriteBatch", context, scene, frames, [&] {
+		batch.add(scene.pointers, scene.states);
+		batch.draw();
+		return batch.getLastDrawCalls();
+	});
+
+	ThreadPool pool(4);
+	run("SpriteBatch, pool", context, scene, frames, [&] {
+		batch.add(scene.pointers, scene.states);
+		batch.draw(&pool);
+		return batch.getLastDrawCalls();
+	});
+	return 0;
+}
@@ -0,0 +1,75 @@
+// Heap allocations per task for the old pool's assign(), the current assign() and submit().
+// Every operator new in the program is counted, so a regression anywhere on the submission path shows up as a
+// higher number here. Each case is warmed up first, so slabs and caches are already there, which is the steady state.
+// Usage: bench_taskalloc [task count], 200k by default.
+#include "TestCommon.hpp"
+#include "BaselinePool.hpp"
+#include "util/Threadpool.hpp"
+#include <stdlib.h>
+#include <new>
+
+static std::atomic<uint64_t> s_allocations{ 0 };
+
+void* operator new(size_t p_bytes) {
+	s_allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* memory = malloc(p_bytes ? p_bytes : 1)) return memory;
+	throw std::bad_alloc();
+}
+void operator delete(void* p_memory) noexcept {
+	free(p_memory);
+}
+void operator delete(void* p_memory, size_t) noexcept {
+	free(p_memory);
+}
+
+static std::atomic<int64_t> s_remaining{ 0 };
+
+// a closure about the size of a real one: a pointer and a couple of values
+struct Work {
+	int* target;
+	int a, b;
+	void operator()() const {
+		*target = a + b;
+		s_remaining.fetch_sub(1, std::memory_order_relaxed);
+	}
+};
+
+template<typename Submit>
+static void measure(const char* p_name, size_t p_tasks, Submit p_submit) {
+	static int target = 0;
+	auto batch = [&](size_t p_count) {
+		s_remaining = (int64_t)p_count;
+		for (size_t i = 0; i < p_count; i++) p_submit(Work{ &target, (int)i, 1 });
+		while (s_remaining.load(std::memory_order_acquire) > 0) std::this_thread::yield();
+	};
+	batch(p_tasks);
+
+	uint64_t before = s_allocations.load();
+	double seconds = timeIt([&] { batch(p_tasks); });
+	uint64_t allocations = s_allocations.load() - before;
+	printf("%-20s %6.2f allocations/task   %7.1f ns/task\n", p_name, double(allocations) / p_tasks, seconds * 1e9 / p_tasks);
+}
+
+int main(int argc, char** argv) {
+	size_t tasks = argc > 1 ? strtoull(argv[1], nullptr, 10) : 200000;
+	const uint16_t threads = 4;
+	printf("%zu tasks on %u workers\n", tasks, threads);
+	{
+		BaselinePool pool(threads);
+		// the future is thrown away straight off, same as the others
+		measure("old assign()", tasks, [&](Work w) { pool.assign(w); });
+	}
+	for (ThreadPoolMode mode : { ThreadPoolMode::SHARED_QUEUE, ThreadPoolMode::WORK_STEALING }) {
+		const char* modeName = mode == ThreadPoolMode::SHARED_QUEUE ? "shared queue" : "work stealing";
+		ThreadPool pool(threads, mode);
+		printf("%s:\n", modeName);
+		measure("  assign()", tasks, [&](Work w) { pool.assign(w); });
+		measure("  submit()", tasks, [&](Work w) { pool.submit(w); });
+
+		ThreadPoolAllocStats stats = pool.getAllocStats();
+		printf("  pool stats: %llu tasks, %llu node slabs, %llu closure heap spills, %llu future slabs, %llu future fallbacks, %llu future depot locks\n",
+			(unsigned long long)stats.tasksSubmitted, (unsigned long long)stats.nodeSlabAllocs, (unsigned long long)stats.taskHeapSpills,
+			(unsigned long long)stats.futureSlabAllocs, (unsigned long long)stats.futureFallbackAllocs, (unsigned long long)stats.futureDepotTrips);
+	}
+	return 0;
+}
@@ -0,0 +1,68 @@
+// Fan-out of a lot of trivial tasks through the old pool and both modes of the current one, at 1, 4 and 16 workers.
+//   outside: the main thread hands out every task
+//   nested:  the main thread hands out one task per worker, and each of those hands out its share of the rest,
+//            which is where work stealing is meant to pay off
+// Usage: bench_threadpool [task count], 1M by default.
+#include "TestCommon.hpp"
+#include "BaselinePool.hpp"
+#include "util/Threadpool.hpp"
+#include <stdlib.h>
+
+static std::atomic<int64_t> s_remaining{ 0 };
+
+static void trivialTask() {
+	s_remaining.fetch_sub(1, std::memory_order_relaxed);
+}
+
+static void waitForAll() {
+	while (s_remaining.load(std::memory_order_acquire) > 0) std::this_thread::yield();
+}
+
+// Pool is either BaselinePool or ThreadPool, Spawn hands one task to it
+template<typename Pool, typename Spawn>
+static void run(const char* p_name, Pool& p_pool, uint16_t p_threads, size_t p_tasks, Spawn p_spawn) {
+	double outside = timeIt([&] {
+		s_remaining = (int64_t)p_tasks;
+		for (size_t i = 0; i < p_tasks; i++) p_spawn(p_pool, trivialTask);
+		waitForAll();
+	});
+
+	double nested = timeIt([&] {
+		size_t share = p_tasks / p_threads;
+		s_remaining = (int64_t)(share * p_threads + p_threads);
+		for (uint16_t t = 0; t < p_threads; t++) {
+			p_spawn(p_pool, [&p_pool, &p_spawn, share] {
+				for (size_t i = 0; i < share; i++) p_spawn(p_pool, trivialTask);
+				trivialTask();
+			});
+		}
+		waitForAll();
+	});
+
+	printf("%-14s %2u threads   outside %8.1f ns/task   nested %8.1f ns/task\n", p_name, p_threads,
+		outside * 1e9 / p_tasks, nested * 1e9 / p_tasks);
+}
+
+int main(int argc, char** argv) {
+	size_t tasks = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1000000;
+	printf("%zu trivial tasks\n", tasks);
+
+	auto baselineSpawn = [](BaselinePool& p_pool, auto&& p_fn) { p_pool.assign(p_fn); };
+	auto poolSpawn = [](ThreadPool& p_pool, auto&& p_fn) { p_pool.submit(p_fn); };
+
+	for (uint16_t threads : { 1, 4, 16 }) {
+		{
+			BaselinePool pool(threads);
+			run("old pool", pool, threads, tasks, baselineSpawn);
+		}
+		{
+			ThreadPool pool(threads, ThreadPoolMode::SHARED_QUEUE);
+			run("shared queue", pool, threads, tasks, poolSpawn);
+		}
+		{
+			ThreadPool pool(threads, ThreadPoolMode::WORK_STEALING);
+			run("work stealing", pool, threads, tasks, poolSpawn);
+		}
+	}
+	return 0;
+}
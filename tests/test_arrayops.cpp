@@ -0,0 +1,54 @@
+// ArrayOps::reduce and the array reduce()s take their starting value once, whether they run serially or split over a
+// pool, so a seed that isn't an identity gives the same answer either way. Also checks the other reductions agree
+// between the two.
+#include "TestCommon.hpp"
+#include "util/ArrayOps.hpp"
+#include "util/Array2D.hpp"
+#include "util/Threadpool.hpp"
+#include <vector>
+
+int main() {
+	ThreadPool pool(4);
+	// well past PARALLEL_MIN_BYTES, so the pool actually gets used
+	const size_t count = 1 << 20;
+	std::vector<int64_t> values(count);
+	int64_t expected = 0;
+	for (size_t i = 0; i < count; i++) {
+		values[i] = int64_t(i % 1000);
+		expected += values[i];
+	}
+	auto add = [](int64_t a, int64_t b) { return a + b; };
+
+	CHECK(ArrayOps::reduce(values.data(), count, int64_t(0), add) == expected);
+	CHECK(ArrayOps::reduce(values.data(), count, int64_t(100), add) == expected + 100);
+	CHECK(ArrayOps::reduce(values.data(), count, int64_t(100), add, &pool) == expected + 100);
+	CHECK(ArrayOps::reduce(values.data(), 0, int64_t(100), add, &pool) == 100);
+	CHECK(ArrayOps::reduce(values.data(), 1, int64_t(100), add) == 100 + values[0]);
+	// a seed bigger than everything has to win a max no matter how it's split up
+	auto biggest = [](int64_t a, int64_t b) { return a < b ? b : a; };
+	CHECK(ArrayOps::reduce(values.data(), count, int64_t(5000), biggest, &pool) == 5000);
+	CHECK(ArrayOps::reduce(values.data(), count, int64_t(-1), biggest, &pool) == 999);
+
+	CHECK(ArrayOps::sum(values.data(), count) == ArrayOps::sum(values.data(), count, &pool));
+	CHECK(ArrayOps::min(values.data(), count, &pool) == 0);
+	CHECK(ArrayOps::max(values.data(), count, &pool) == 999);
+	auto odd = [](int64_t v) { return (v & 1) != 0; };
+	CHECK(ArrayOps::countIf(values.data(), count, odd) == ArrayOps::countIf(values.data(), count, odd, &pool));
+
+	Array2D<int64_t> grid(1024, 1024);
+	Array2D<int64_t, TiledLayout<8>> tiled(1000, 1000);
+	int64_t gridSum = 0, tiledSum = 0;
+	for (size_t y = 0; y < 1024; y++) for (size_t x = 0; x < 1024; x++) {
+		grid(x, y) = int64_t(x + y);
+		gridSum += int64_t(x + y);
+		if (x < 1000 && y < 1000) {
+			tiled(x, y) = int64_t(x ^ y);
+			tiledSum += int64_t(x ^ y);
+		}
+	}
+	CHECK(grid.reduce(int64_t(7), add, &pool) == gridSum + 7);
+	CHECK(grid.reduce(int64_t(7), add) == gridSum + 7);
+	CHECK(tiled.reduce(int64_t(7), add, &pool) == tiledSum + 7);
+
+	return finishTest("test_arrayops");
+}
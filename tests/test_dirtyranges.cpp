@@ -0,0 +1,99 @@
+// DirtyRanges merging, clipping and overflow, then a pile of random marks that all have to be covered afterwards,
+// since an upload that misses a dirty element leaves stale data on the GPU.
+#include "TestCommon.hpp"
+#include "util/DirtyRanges.hpp"
+#include <vector>
+#include <random>
+
+// sorted, not overlapping, and every element marked in p_marked is inside one
+static bool covers(std::span<const DirtyRanges::Range> p_ranges, const std::vector<bool>& p_marked) {
+	for (size_t i = 1; i < p_ranges.size(); i++) {
+		if (p_ranges[i].begin <= p_ranges[i - 1].end) return false;
+	}
+	for (size_t element = 0; element < p_marked.size(); element++) {
+		if (!p_marked[element]) continue;
+		bool found = false;
+		for (const DirtyRanges::Range& range : p_ranges) found = found || (element >= range.begin && element < range.end);
+		if (!found) return false;
+	}
+	return true;
+}
+
+int main() {
+	DirtyRanges dirty;
+	CHECK(dirty.empty());
+
+	// edits in order just grow the one range
+	dirty.mark(0, 4);
+	dirty.mark(4, 8);
+	auto ranges = dirty.coalesce(100);
+	CHECK(ranges.size() == 1 && ranges[0].begin == 0 && ranges[0].end == 8);
+	dirty.clear();
+	CHECK(dirty.empty());
+
+	// out of order, no gap
+	dirty.mark(20, 22);
+	dirty.mark(0, 2);
+	dirty.mark(10, 12);
+	ranges = dirty.coalesce(100);
+	CHECK(ranges.size() == 3 && ranges[0].begin == 0 && ranges[1].begin == 10 && ranges[2].begin == 20);
+	CHECK(dirty.dirtyCount(100) == 6);
+	dirty.clear();
+
+	// ranges within the gap of each other get joined
+	dirty.setMergeGap(2);
+	dirty.mark(0, 2);
+	dirty.mark(4, 6);
+	dirty.mark(10, 12);
+	ranges = dirty.coalesce(100);
+	CHECK(ranges.size() == 2 && ranges[0].end == 6 && ranges[1].begin == 10);
+	dirty.clear();
+	dirty.setMergeGap(0);
+
+	// clipped to the array, and ranges past the end dropped
+	dirty.mark(60, 70);
+	dirty.mark(5, 100);
+	ranges = dirty.coalesce(50);
+	CHECK(ranges.size() == 1 && ranges[0].begin == 5 && ranges[0].end == 50);
+	dirty.clear();
+
+	// untracked edits mean everything
+	dirty.markAll();
+	dirty.mark(3, 4);
+	ranges = dirty.coalesce(30);
+	CHECK(ranges.size() == 1 && ranges[0].begin == 0 && ranges[0].end == 30);
+	dirty.clear();
+
+	// too many separate ranges collapse into one that still covers them all
+	std::vector<bool> marked(1000, false);
+	for (size_t i = 400; i-- > 0;) {
+		if (i % 2) continue;
+		dirty.mark(i * 2, i * 2 + 1);
+		marked[i * 2] = true;
+	}
+	ranges = dirty.coalesce(marked.size());
+	CHECK(ranges.size() <= DirtyRanges::MAX_RANGES);
+	CHECK(covers(ranges, marked));
+	dirty.clear();
+
+	// random marks with random gaps
+	std::mt19937 rng(42);
+	bool allCovered = true;
+	for (int round = 0; round < 500; round++) {
+		size_t size = 1 + rng() % 2000;
+		std::vector<bool> roundMarked(size, false);
+		dirty.setMergeGap(rng() % 8);
+		size_t marks = rng() % 300;
+		for (size_t m = 0; m < marks; m++) {
+			size_t begin = rng() % (size + 20);
+			size_t end = begin + rng() % 16;
+			dirty.mark(begin, end);
+			for (size_t element = begin; element < std::min(end, size); element++) roundMarked[element] = true;
+		}
+		allCovered = allCovered && covers(dirty.coalesce(size), roundMarked);
+		dirty.clear();
+	}
+	CHECK(allCovered);
+
+	return finishTest("test_dirtyranges");
+}
@@ -0,0 +1,57 @@
+// A pool task that's still running when the frame ends has to keep its memory, and the worker's arena has to be
+// reset before the next task instead.
+#include "TestCommon.hpp"
+#include "util/FrameArena.hpp"
+#include "util/Threadpool.hpp"
+#include <atomic>
+#include <thread>
+#include <string.h>
+
+int main() {
+	ThreadPool pool(1);
+	std::atomic<int> step{ 0 };
+	bool intact = false;
+	bool overlaps = true;
+
+	pool.assign([&] {
+		unsigned char* first = FrameArena::local().allocateArray<unsigned char>(64);
+		memset(first, 0x5A, 64);
+		step = 1;
+		while (step != 2) std::this_thread::yield();
+
+		// the frame ended under us, but this task's arena hasn't moved on
+		unsigned char* second = FrameArena::local().allocateArray<unsigned char>(64);
+		memset(second, 0xA5, 64);
+		overlaps = second < first + 64 && first < second + 64;
+		intact = true;
+		for (int i = 0; i < 64; i++) intact = intact && first[i] == 0x5A;
+	});
+	while (step != 1) std::this_thread::yield();
+	FrameArena::endFrame();
+	step = 2;
+	pool.waitUntilIdle();
+	CHECK(intact);
+	CHECK(!overlaps);
+
+	// the next task on the worker starts off a fresh frame
+	size_t usedAtStart = pool.assign([] { return FrameArena::local().bytesUsed(); }).get();
+	CHECK(usedAtStart == 0);
+
+	// nested scopes don't reset anything
+	{
+		FrameArena::Scope outer;
+		void* a = FrameArena::local().allocate(16);
+		FrameArena::endFrame();
+		{
+			FrameArena::Scope inner;
+			void* b = FrameArena::local().allocate(16);
+			CHECK(a != b);
+		}
+		CHECK(FrameArena::local().bytesUsed() > 0);
+	}
+	// and once they're closed, the next allocation catches up
+	FrameArena::local().allocate(16);
+	CHECK(FrameArena::local().bytesUsed() <= 64);
+
+	return finishTest("test_framearena");
+}
@@ -0,0 +1,152 @@
+// Messages go through FrameEncoder, down a socketpair, get read back in random sized pieces and through FrameDecoder,
+// and every one of them has to come out the other end intact and in order. Runs once raw and once compressed.
+// Then a couple of malformed frames, which have to throw rather than read out of bounds.
+#include "TestCommon.hpp"
+#include "SocketPipe.hpp"
+#include "util/MessageFrame.hpp"
+#include <thread>
+#include <vector>
+#include <random>
+
+enum class TestMsg : uint32_t {
+	Position,
+	Chat,
+	Blob
+};
+
+static constexpr uint64_t MESSAGE_COUNT = 20000;
+
+// Everything about message p_seq comes from p_seq, so the receiving side can work out what it should have gotten.
+// The ramps compress well, the blobs don't.
+struct Expected {
+	std::vector<uint16_t> ramp;
+	std::vector<uint8_t> blob;
+};
+static Expected expectedFor(uint64_t p_seq) {
+	std::mt19937 rng((uint32_t)p_seq);
+	Expected out;
+	out.ramp.resize(rng() % 200);
+	for (size_t k = 0; k < out.ramp.size(); k++) out.ramp[k] = uint16_t(p_seq + k / 8);
+	if (p_seq % 3 == uint64_t(TestMsg::Blob)) {
+		out.blob.resize(rng() % 64);
+		for (uint8_t& byte : out.blob) byte = uint8_t(rng());
+	}
+	return out;
+}
+
+static net::Message<TestMsg> makeMessage(uint64_t p_seq) {
+	Expected expected = expectedFor(p_seq);
+	net::Message<TestMsg> msg;
+	msg.header.ID = TestMsg(p_seq % 3);
+	net::MessageWriter<TestMsg> writer(msg);
+	writer.writeVarint(p_seq);
+	writer.writeZigzag(-(int64_t)p_seq * 3);
+	writer.writeArray(expected.ramp);
+	writer.writeVarint(expected.blob.size());
+	writer.writeBytes(expected.blob.data(), expected.blob.size());
+	return msg;
+}
+
+static bool matches(const net::MessageView<TestMsg>& p_view, uint64_t p_seq) {
+	Expected expected = expectedFor(p_seq);
+	if (p_view.header.ID != TestMsg(p_seq % 3)) return false;
+	net::MessageReader reader = p_view.reader();
+	if (reader.readVarint() != p_seq) return false;
+	if (reader.readZigzag() != -(int64_t)p_seq * 3) return false;
+	std::vector<uint16_t> ramp;
+	reader.readArray(ramp);
+	if (ramp != expected.ramp) return false;
+	std::span<const uint8_t> blob = reader.readBytes(reader.readVarint());
+	if (!std::equal(blob.begin(), blob.end(), expected.blob.begin(), expected.blob.end())) return false;
+	return reader.atEnd();
+}
+
+static void roundTrip(size_t p_compressAbove) {
+	SocketPipe pipe;
+	size_t compressedFrames = 0;
+
+	std::thread sender([&] {
+		net::FrameEncoder<TestMsg> encoder(p_compressAbove);
+		std::mt19937 rng(1234);
+		std::vector<net::Message<TestMsg>> batch;
+		for (uint64_t seq = 0; seq < MESSAGE_COUNT;) {
+			size_t count = std::min<uint64_t>(1 + rng() % 64, MESSAGE_COUNT - seq);
+			// both ways of adding
+			if (rng() % 2) {
+				batch.clear();
+				for (size_t i = 0; i < count; i++) batch.push_back(makeMessage(seq++));
+				encoder.add(std::span<const net::Message<TestMsg>>(batch));
+			}
+			else {
+				for (size_t i = 0; i < count; i++) encoder.add(makeMessage(seq++));
+			}
+			std::span<const uint8_t> frame = encoder.finish();
+			net::FrameHeader header;
+			memcpy(&header, frame.data(), sizeof(header));
+			if (header.length != header.rawLength) compressedFrames++;
+			pipe.sendAll(frame);
+		}
+		pipe.closeWriter();
+	});
+
+	net::FrameDecoder<TestMsg> decoder;
+	net::MessageView<TestMsg> view;
+	std::mt19937 rng(5678);
+	std::vector<uint8_t> chunk(8192);
+	uint64_t received = 0;
+	bool intact = true;
+	while (true) {
+		size_t got = pipe.receive(chunk.data(), 1 + rng() % chunk.size());
+		if (got == 0) break;
+		decoder.feed({ chunk.data(), got });
+		while (decoder.next(view)) {
+			intact = intact && matches(view, received);
+			received++;
+		}
+	}
+	sender.join();
+
+	CHECK(intact);
+	CHECK(received == MESSAGE_COUNT);
+	CHECK(decoder.bufferedBytes() == 0);
+	if (p_compressAbove == net::FrameEncoder<TestMsg>::NO_COMPRESSION) CHECK(compressedFrames == 0);
+	else CHECK(compressedFrames > 0);
+}
+
+// true if decoding p_bytes threw like it should
+static bool rejects(std::vector<uint8_t> p_bytes, size_t p_maxFrameSize) {
+	net::FrameDecoder<TestMsg> decoder(p_maxFrameSize);
+	net::MessageView<TestMsg> view;
+	decoder.feed(p_bytes);
+	try {
+		while (decoder.next(view)) {}
+	}
+	catch (std::runtime_error&) {
+		return true;
+	}
+	return false;
+}
+
+static std::vector<uint8_t> frameBytes(net::FrameHeader p_header, std::vector<uint8_t> p_payload) {
+	std::vector<uint8_t> out(sizeof(p_header));
+	memcpy(out.data(), &p_header, sizeof(p_header));
+	out.insert(out.end(), p_payload.begin(), p_payload.end());
+	return out;
+}
+
+int main() {
+	roundTrip(net::FrameEncoder<TestMsg>::NO_COMPRESSION);
+	roundTrip(256);
+
+	// over the size limit
+	CHECK(rejects(frameBytes({ 4096, 4096 }, std::vector<uint8_t>(16)), 1024));
+	// a message claiming to be bigger than its frame
+	net::MessageHeader<TestMsg> header{ TestMsg::Chat, 1000 };
+	std::vector<uint8_t> payload(sizeof(header) + 8);
+	memcpy(payload.data(), &header, sizeof(header));
+	CHECK(rejects(frameBytes({ (uint32_t)payload.size(), (uint32_t)payload.size() }, payload), 1024));
+	// compressed garbage
+	CHECK(rejects(frameBytes({ 6, 100 }, { 0xF0, 0xFF, 0xFF, 0xFF, 0x01, 0x02 }), 1024));
+
+	return finishTest("test_messageframe");
+}
@@ -0,0 +1,76 @@
+// MPMCRing's batch calls have to wake every thread they made room for: a pushN of several elements with consumers
+// asleep in pop() should get all of them running, not just one, and the same for popN and producers stuck in push().
+// Also the basics: order, the batch calls stopping at full or empty, and values surviving the trip.
+#include "TestCommon.hpp"
+#include "util/MPMCRing.hpp"
+#include <thread>
+#include <vector>
+#include <chrono>
+
+static constexpr int SLEEPERS = 4;
+
+// true if every thread finished within a couple of seconds. Otherwise kicks them loose so they can be joined.
+static bool allFinish(MPMCRing<int>& p_ring, std::vector<std::thread>& p_threads, std::atomic<int>& p_finished) {
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+	while (p_finished.load() < (int)p_threads.size() && std::chrono::steady_clock::now() < deadline) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	bool finished = p_finished.load() == (int)p_threads.size();
+	p_ring.forceAllThreadsToPop();
+	for (std::thread& thread : p_threads) thread.join();
+	p_ring.resetTermination();
+	return finished;
+}
+
+int main() {
+	MPMCRing<int> ring(8);
+	for (int i = 0; i < 5; i++) CHECK(ring.tryPush(i));
+	int batch[8] = { 5, 6, 7, 8, 9 };
+	// only three more fit
+	CHECK(ring.tryPushN(batch, batch + 5) == 3);
+	int popped[16] = {};
+	CHECK(ring.tryPopN(popped, 16) == 8);
+	bool inOrder = true;
+	for (int i = 0; i < 8; i++) inOrder = inOrder && popped[i] == i;
+	CHECK(inOrder);
+	CHECK(ring.empty());
+	CHECK(ring.tryPopN(popped, 16) == 0);
+	CHECK(!ring.tryPop().has_value());
+
+	// consumers asleep in pop(), then one pushN for all of them
+	{
+		std::atomic<int> finished = 0;
+		std::vector<std::thread> consumers;
+		for (int i = 0; i < SLEEPERS; i++) {
+			consumers.emplace_back([&] {
+				ring.pop();
+				finished++;
+			});
+		}
+		// long enough to get past the spinning and into the wait
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+		int values[SLEEPERS] = { 1, 2, 3, 4 };
+		CHECK(ring.pushN(values, values + SLEEPERS) == SLEEPERS);
+		CHECK(allFinish(ring, consumers, finished));
+		CHECK(ring.empty());
+	}
+
+	// producers asleep in push() on a full ring, then one popN frees room for all of them
+	{
+		for (int i = 0; i < 8; i++) ring.tryPush(i);
+		std::atomic<int> finished = 0;
+		std::vector<std::thread> producers;
+		for (int i = 0; i < SLEEPERS; i++) {
+			producers.emplace_back([&, i] {
+				ring.push(100 + i);
+				finished++;
+			});
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+		CHECK(ring.popN(popped, SLEEPERS) == SLEEPERS);
+		CHECK(allFinish(ring, producers, finished));
+		CHECK(ring.tryPopN(popped, 16) == 8);
+	}
+
+	return finishTest("test_mpmcring");
+}
@@ -0,0 +1,135 @@
+// Checks the command stream a deferred pass records, without a GL context. Nothing here calls into GL: recording
+// only copies states, and sort() only looks at the keys.
+#include "TestCommon.hpp"
+#include "Framework/Graphics/RenderQueue.hpp"
+#include <vector>
+
+static uint64_t field(uint64_t p_key, int p_shift, uint64_t p_max) {
+	return (p_key >> p_shift) & p_max;
+}
+
+// What a GUI does: a run of widgets drawn back to front with the same shader, each with its own colour and opacity,
+// on two layers. Submission order has to keep them exactly in order, with each command holding its own values.
+static void testSubmissionOrder() {
+	Mesh<GLfloat> quad(NO_VAO_INIT);
+	Shader solid, text;
+	RenderQueue queue;
+	queue.begin(SubmitOrder::Submission);
+
+	const GLint colorLoc = 1, opacityLoc = 2;
+	const uint8_t layers[] = { 1, 0, 0, 1, 0, 1 };
+	const size_t count = sizeof(layers);
+	for (size_t i = 0; i < count; i++) {
+		DrawStates states;
+		states.attachShader(i % 2 ? &text : &solid);
+		states.m_layer = layers[i];
+		states.setUniform(colorLoc, glm::vec3((float)i));
+		states.setUniform(opacityLoc, i / 10.f);
+		queue.record(quad, GL_TRIANGLES, states);
+	}
+	CHECK(queue.size() == count);
+
+	for (uint32_t i = 0; i < count; i++) {
+		const RenderCommand& command = queue[i];
+		CHECK(command.key == ((uint64_t)layers[i] << RenderQueue::LAYER_SHIFT | i));
+		CHECK(command.mesh == &quad);
+		CHECK(command.shader == (i % 2 ? &text : &solid));
+
+		auto uniforms = queue.uniforms(command);
+		CHECK(uniforms.size() == 2);
+		CHECK(uniforms[0].loc == colorLoc && uniforms[0].components == 3 && uniforms[0].value.x == (float)i);
+		CHECK(uniforms[1].loc == opacityLoc && uniforms[1].components == 1 && uniforms[1].value.x == i / 10.f);
+	}
+
+	// layer 0 first, then layer 1, each in the order they were drawn
+	std::span<const RenderQueue::Entry> sorted = queue.sort();
+	const uint32_t expected[] = { 1, 2, 4, 0, 3, 5 };
+	CHECK(sorted.size() == count);
+	for (size_t i = 0; i < sorted.size() && i < count; i++) {
+		CHECK(sorted[i].index == expected[i]);
+		CHECK(sorted[i].key == queue[sorted[i].index].key);
+	}
+}
+
+// State order groups by shader, then texture set, then blend mode, then depth, keeping draw order within a group.
+static void testStateOrder() {
+	Mesh<GLfloat> mesh(NO_VAO_INIT);
+	Shader a, b;
+	Texture t1, t2;
+	// never bound, just different names for the key
+	t1.glID->ID = 11;
+	t2.glID->ID = 12;
+	BlendMode opaque;
+	opaque.disable();
+
+	struct Draw {
+		Shader* shader;
+		Texture* texture;
+		bool blend;
+		float depth;
+		uint8_t layer;
+	};
+	const Draw draws[] = {
+		{ &b, &t1, true, 0.5f, 0 },  // 0
+		{ &a, &t2, true, 0.2f, 0 },  // 1
+		{ &a, &t1, true, 0.9f, 0 },  // 2
+		{ &b, &t1, false, 0.1f, 0 }, // 3
+		{ &a, &t2, true, 0.1f, 0 },  // 4
+		{ &a, &t1, true, 0.9f, 0 },  // 5, same key as 2
+		{ &a, &t1, true, 0.0f, 1 },  // 6
+		{ &b, &t1, true, 0.5f, 0 },  // 7, same key as 0
+	};
+	const size_t count = sizeof(draws) / sizeof(draws[0]);
+
+	RenderQueue queue;
+	queue.begin(SubmitOrder::State);
+	for (const Draw& draw : draws) {
+		DrawStates states;
+		states.attachShader(draw.shader);
+		states.attachTexture(*draw.texture);
+		if (!draw.blend) states.setBlendMode(opaque);
+		states.m_depth = draw.depth;
+		states.m_layer = draw.layer;
+		queue.record(mesh, GL_TRIANGLES, states);
+	}
+
+	// shaders, texture sets and blend modes are numbered in the order they're first seen
+	const RenderCommand& first = queue[0];
+	CHECK(field(first.key, RenderQueue::LAYER_SHIFT, 0xFF) == 0);
+	CHECK(field(first.key, RenderQueue::SHADER_SHIFT, RenderQueue::MAX_SHADER_ID) == 0);
+	CHECK(field(first.key, RenderQueue::TEXTURE_SET_SHIFT, RenderQueue::MAX_TEXTURE_SET_ID) == 0);
+	CHECK(field(first.key, RenderQueue::BLEND_SHIFT, RenderQueue::MAX_BLEND_ID) == 0);
+	CHECK(field(first.key, 0, RenderQueue::MAX_DEPTH) == (uint64_t)(0.5f * RenderQueue::MAX_DEPTH));
+	CHECK(field(queue[1].key, RenderQueue::SHADER_SHIFT, RenderQueue::MAX_SHADER_ID) == 1);
+	CHECK(field(queue[1].key, RenderQueue::TEXTURE_SET_SHIFT, RenderQueue::MAX_TEXTURE_SET_ID) == 1);
+	CHECK(field(queue[3].key, RenderQueue::BLEND_SHIFT, RenderQueue::MAX_BLEND_ID) == 1);
+	CHECK(field(queue[6].key, RenderQueue::LAYER_SHIFT, 0xFF) == 1);
+	CHECK(queue[5].key == queue[2].key);
+	CHECK(queue[7].key == queue[0].key);
+	CHECK(queue.textures(queue[1]).size() == 1 && queue.textures(queue[1])[0].ID == 12);
+
+	std::span<const RenderQueue::Entry> sorted = queue.sort();
+	// b/t1 (0, 7 then the opaque 3), then a/t1 (2, 5), then a/t2 by depth (4, 1), then layer 1
+	const uint32_t expected[] = { 0, 7, 3, 2, 5, 4, 1, 6 };
+	CHECK(sorted.size() == count);
+	for (size_t i = 0; i < sorted.size() && i < count; i++) {
+		CHECK(sorted[i].index == expected[i]);
+	}
+	int shaderChanges = 0;
+	for (size_t i = 1; i < sorted.size(); i++) {
+		CHECK(sorted[i - 1].key <= sorted[i].key);
+		if (queue[sorted[i].index].shader != queue[sorted[i - 1].index].shader) shaderChanges++;
+	}
+	// b, a, then layer 1's a
+	CHECK(shaderChanges == 1);
+
+	// there's no context to delete them in
+	t1.glID->ID = 0;
+	t2.glID->ID = 0;
+}
+
+int main() {
+	testSubmissionOrder();
+	testStateOrder();
+	return finishTest("test_renderqueue");
+}
@@ -0,0 +1,90 @@
+// SizeClassArena's per-thread caches: blocks never handed out twice, blocks freed on a different thread than they came
+// from, caches going back to the depot when their thread exits, the lock only being taken once per batch, and a
+// thread outliving the arena its cache belongs to.
+#include "TestCommon.hpp"
+#include "util/SizeClassArena.hpp"
+#include <thread>
+#include <vector>
+#include <set>
+#include <mutex>
+#include <string.h>
+
+static constexpr int THREADS = 4;
+static constexpr size_t ROUNDS = 20000;
+
+int main() {
+	auto arena = std::make_shared<SizeClassArena>();
+
+	// every thread stamps its blocks and checks nobody else wrote over them while it held them
+	std::atomic<int> overwritten = 0;
+	std::vector<std::thread> threads;
+	for (int t = 0; t < THREADS; t++) {
+		threads.emplace_back([&, t] {
+			std::vector<unsigned char*> held;
+			for (size_t round = 0; round < ROUNDS; round++) {
+				size_t bytes = 16 << (round % 4);
+				unsigned char* block = (unsigned char*)arena->allocate(bytes, 8);
+				memset(block, t + 1, bytes);
+				held.push_back(block);
+				if (held.size() > 100) {
+					for (size_t i = 0; i < held.size(); i++) {
+						size_t heldBytes = 16 << ((round - held.size() + 1 + i) % 4);
+						for (size_t b = 0; b < heldBytes; b++) {
+							if (held[i][b] != t + 1) {
+								overwritten++;
+								break;
+							}
+						}
+						arena->deallocate(held[i], heldBytes, 8);
+					}
+					held.clear();
+				}
+			}
+			for (size_t i = 0; i < held.size(); i++) arena->deallocate(held[i], 16 << ((ROUNDS - held.size() + i) % 4), 8);
+		});
+	}
+	for (std::thread& thread : threads) thread.join();
+	CHECK(overwritten == 0);
+	uint64_t operations = THREADS * ROUNDS * 2;
+	// a trip moves half a cache, so it should be a small fraction of the calls
+	CHECK(arena->depotTrips.load() * 8 < operations);
+
+	// allocated on one thread, freed on another
+	std::vector<void*> handoff;
+	std::thread producer([&] {
+		for (int i = 0; i < 1000; i++) handoff.push_back(arena->allocate(48, 8));
+	});
+	producer.join();
+	std::thread consumer([&] {
+		for (void* block : handoff) arena->deallocate(block, 48, 8);
+	});
+	consumer.join();
+
+	// everything went back to the depot when those threads exited, so this doesn't need any more slabs
+	uint64_t slabs = arena->slabAllocs.load();
+	std::thread again([&] {
+		std::vector<void*> blocks;
+		for (int i = 0; i < 1000; i++) blocks.push_back(arena->allocate(48, 8));
+		std::set<void*> unique(blocks.begin(), blocks.end());
+		CHECK(unique.size() == blocks.size());
+		for (void* block : blocks) arena->deallocate(block, 48, 8);
+	});
+	again.join();
+	CHECK(arena->slabAllocs.load() == slabs);
+
+	// too big goes to the heap
+	void* big = arena->allocate(1000, 8);
+	arena->deallocate(big, 1000, 8);
+	CHECK(arena->fallbackAllocs.load() == 1);
+
+	// this thread's cache still holds blocks from the first arena when it goes away, then switches to a second one
+	void* cached = arena->allocate(32, 8);
+	arena->deallocate(cached, 32, 8);
+	arena.reset();
+	auto second = std::make_shared<SizeClassArena>();
+	void* fresh = second->allocate(32, 8);
+	CHECK(fresh != nullptr);
+	second->deallocate(fresh, 32, 8);
+
+	return finishTest("test_sizeclassarena");
+}
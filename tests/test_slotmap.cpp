@@ -0,0 +1,71 @@
+// Handles going stale, slots getting reused, a throwing constructor not leaking a slot, and inserts staying O(1).
+#include "TestCommon.hpp"
+#include "util/SlotMap.hpp"
+#include "util/ConcurrentSlotMap.hpp"
+#include <stdexcept>
+#include <algorithm>
+
+struct Picky {
+	int value;
+	Picky(int p_value) : value(p_value) {
+		if (p_value < 0) throw std::runtime_error("negative");
+	}
+};
+
+int main() {
+	SlotMap<Picky> map;
+	SlotHandle a = map.emplace(1);
+	SlotHandle b = map.emplace(2);
+	CHECK(map.erase(a));
+	CHECK(!map.contains(a));
+	CHECK(map.get(b) && map.get(b)->value == 2);
+	SlotHandle c = map.emplace(3);
+	// reuses a's slot, with a newer generation
+	CHECK(c.index == a.index && c != a);
+	CHECK(!map.get(a));
+
+	bool threw = false;
+	try {
+		map.emplace(-1);
+	}
+	catch (std::runtime_error&) {
+		threw = true;
+	}
+	CHECK(threw);
+	CHECK(map.size() == 2);
+	// nothing was lost, so the next insert gets a brand new slot rather than a leaked one being skipped
+	SlotHandle d = map.emplace(4);
+	CHECK(d.index == 2);
+	CHECK(map.size() == 3);
+	for (size_t i = 0; i < map.size(); i++) CHECK(map.get(map.handleAt(i)) == map.data() + i);
+
+	// 8x the inserts should take about 8x as long, quadratic growth would be 64x. Best of a few runs to keep the noise down.
+	auto fill = [](size_t p_count) {
+		double best = 1e9;
+		for (int run = 0; run < 3; run++) {
+			SlotMap<int> big;
+			best = std::min(best, timeIt([&] {
+				for (size_t i = 0; i < p_count; i++) big.emplace((int)i);
+			}));
+			keepAlive(big.size());
+		}
+		return best;
+	};
+	double small = fill(20000), large = fill(160000);
+	CHECK(large < small * 24);
+
+	ConcurrentSlotMap<Picky> concurrent;
+	threw = false;
+	try {
+		concurrent.emplace(-1);
+	}
+	catch (std::runtime_error&) {
+		threw = true;
+	}
+	CHECK(threw);
+	SlotHandle e = concurrent.emplace(5);
+	CHECK(e.index == 0);
+	CHECK(concurrent.contains(e));
+
+	return finishTest("test_slotmap");
+}